@@ -0,0 +1,137 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cell_kernel.h>
+
+// a grid as large as a 4k window at a small font size
+#define BENCH_COLS 480
+#define BENCH_ROWS 135
+// passes over the grid per kernel, the best one is reported
+#define BENCH_PASSES 200
+// variants compared, the ones this cpu lacks are skipped
+static const char *bench_variants[] = { "scalar", "sse2", "avx2", "neon" };
+
+typedef struct BenchGrid {
+    Cell *cells;
+    Cell *other;
+    uint8_t *text;
+    uint32_t *codepoints;
+    size_t count;
+} BenchGrid;
+
+static double bench_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// keep results alive so the kernels are not optimized away
+static volatile uint64_t bench_sink;
+
+// run one kernel over every row of the grid
+static void bench_pass(BenchGrid *grid, int kernel) {
+    uint64_t sink = 0;
+    for (size_t row = 0; row < BENCH_ROWS; row++) {
+        Cell *cells = grid->cells + row * BENCH_COLS;
+        const Cell *other = grid->other + row * BENCH_COLS;
+        switch (kernel) {
+        case 0:
+            cell_fill(cells, BENCH_COLS, (Cell){ ' ', STYLE_DEFAULT_ID });
+            break;
+        case 1:
+            cell_copy(cells, other, BENCH_COLS);
+            break;
+        case 2:
+            sink += cell_diff(cells, other, BENCH_COLS);
+            break;
+        case 3:
+            sink += cell_style_run(other, BENCH_COLS, other[0].style);
+            break;
+        case 4:
+            cell_store_bytes(cells, grid->text + row * BENCH_COLS, BENCH_COLS, 1);
+            break;
+        case 5:
+            cell_store_codepoints(cells, grid->codepoints + row * BENCH_COLS, BENCH_COLS, 1);
+            break;
+        case 6:
+            sink += cell_hash(other, BENCH_COLS);
+            break;
+        case 7:
+            sink += cell_scan_printable(grid->text + row * BENCH_COLS, BENCH_COLS);
+            break;
+        default:
+            for (size_t col = 0; col + UTF8_BLOCK <= BENCH_COLS; col += UTF8_BLOCK) {
+                Utf8Masks masks;
+                cell_classify_utf8(grid->text + row * BENCH_COLS + col, &masks);
+                sink += masks.high ^ masks.control;
+            }
+            break;
+        }
+    }
+    bench_sink += sink;
+}
+
+// best time of a kernel over the whole grid in microseconds
+static double bench_kernel(BenchGrid *grid, int kernel) {
+    double best = 0.0;
+    for (int pass = 0; pass <= BENCH_PASSES; pass++) {
+        // diffs and style runs scan whole rows when the grids match
+        memcpy(grid->cells, grid->other, grid->count * sizeof(Cell));
+        double start = bench_now_ms();
+        bench_pass(grid, kernel);
+        double elapsed = bench_now_ms() - start;
+        // the first pass warms the caches
+        if (pass == 1 || (pass > 1 && elapsed < best))
+            best = elapsed;
+    }
+    return best * 1e3;
+}
+
+int main(void) {
+    static const char *kernels[] = { "fill", "copy", "diff", "style_run", "store_bytes", "store_codepoints", "hash",
+                                    "scan_printable", "classify_utf8" };
+    size_t kernel_count = sizeof(kernels) / sizeof(kernels[0]);
+
+    BenchGrid grid = { .count = (size_t)BENCH_COLS * BENCH_ROWS };
+    grid.cells = malloc(grid.count * sizeof(Cell));
+    grid.other = malloc(grid.count * sizeof(Cell));
+    grid.text = malloc(grid.count);
+    grid.codepoints = malloc(grid.count * sizeof(uint32_t));
+    if (!grid.cells || !grid.other || !grid.text || !grid.codepoints) {
+        printf("Failed to allocate the grid\n");
+        return 1;
+    }
+    // one style per row so style runs cover whole rows
+    for (size_t i = 0; i < grid.count; i++) {
+        grid.text[i] = (uint8_t)(0x20 + i % 95);
+        grid.codepoints[i] = 0x20 + (uint32_t)(i % 0x2000);
+        grid.other[i] = (Cell){ grid.text[i], (uint32_t)(i / BENCH_COLS % 4) };
+    }
+
+    printf("grid %dx%d, best of %d passes in us\n", BENCH_COLS, BENCH_ROWS, BENCH_PASSES);
+    printf("%-18s", "kernel");
+    for (size_t v = 0; v < sizeof(bench_variants) / sizeof(bench_variants[0]); v++) {
+        if (cell_kernel_init(bench_variants[v]) == 0)
+            printf(" %10s", bench_variants[v]);
+    }
+    printf("\n");
+
+    for (size_t k = 0; k < kernel_count; k++) {
+        printf("%-18s", kernels[k]);
+        for (size_t v = 0; v < sizeof(bench_variants) / sizeof(bench_variants[0]); v++) {
+            if (cell_kernel_init(bench_variants[v]) == 0)
+                printf(" %10.2f", bench_kernel(&grid, (int)k));
+        }
+        printf("\n");
+    }
+
+    free(grid.cells);
+    free(grid.other);
+    free(grid.text);
+    free(grid.codepoints);
+    return 0;
+}
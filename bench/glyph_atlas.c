@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glyph_cache.h>
+
+// sizes a window resize sweeps the cell height through
+#define BENCH_MIN_SIZE 12
+#define BENCH_MAX_SIZE 64
+#define BENCH_SIZE_STEP 2
+// size distance fields are rasterized at, as text.c does
+#define BENCH_SDF_SIZE 48
+
+typedef struct BenchResult {
+    double first_ms;    // building the atlas for the first size
+    double rebuild_ms;  // every later size of the sweep
+    size_t glyph_bytes; // texels held by the printable ascii set at the last size
+    size_t gpu_bytes;
+} BenchResult;
+
+static double bench_now_ms(void) {
+    return glfwGetTime() * 1e3;
+}
+
+// look up printable ascii and return the texels it occupies
+static size_t bench_load_ascii(GlyphCache *cache, int face, uint32_t pixel_size) {
+    size_t bytes = 0;
+    for (uint32_t codepoint = 0x20; codepoint < 0x7f; codepoint++) {
+        GlyphKey key = { codepoint, (uint16_t)face, 0, pixel_size };
+        const Glyph *glyph = glyph_cache_lookup(cache, key);
+        if (glyph && glyph->width > 0)
+            bytes += (size_t)(glyph->width + GLYPH_PADDING) * (glyph->height + GLYPH_PADDING);
+    }
+    return bytes;
+}
+
+// resize through every size of the sweep the way text.c switches glyph buckets
+static int bench_sweep(const char *font_path, GlyphMode mode, BenchResult *result) {
+    GlyphCache cache;
+    if (glyph_cache_init(&cache, GLYPH_CACHE_DEFAULT_BUDGET, NULL) != 0)
+        return -1;
+    cache.mode = mode;
+    int face = glyph_cache_add_face(&cache, font_path);
+    if (face < 0) {
+        glyph_cache_free(&cache);
+        return -1;
+    }
+
+    *result = (BenchResult){0};
+    uint32_t previous = 0;
+    for (uint32_t size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size += BENCH_SIZE_STEP) {
+        uint32_t pixel_size = mode == GLYPH_MODE_SDF ? BENCH_SDF_SIZE : size;
+        double start = bench_now_ms();
+        glyph_cache_begin_frame(&cache);
+        result->glyph_bytes = bench_load_ascii(&cache, face, pixel_size);
+        if (previous != 0 && previous != pixel_size)
+            glyph_cache_release_size(&cache, previous);
+        glFinish();
+        double elapsed = bench_now_ms() - start;
+
+        if (previous == 0)
+            result->first_ms = elapsed;
+        else
+            result->rebuild_ms += elapsed;
+        previous = pixel_size;
+    }
+    result->gpu_bytes = cache.stats.gpu_bytes;
+    glyph_cache_free(&cache);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *font_path = argc > 1 ? argv[1] : "../fonts/JetBrainsMono-Bold.ttf";
+
+    // the atlas lives in a texture so a hidden window provides the context
+    if (!glfwInit())
+        return 1;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "glyph_atlas", NULL, NULL);
+    if (!window) {
+        printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        printf("Failed to initialize GLAD\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    size_t steps = (BENCH_MAX_SIZE - BENCH_MIN_SIZE) / BENCH_SIZE_STEP;
+    printf("resize sweep %dpx to %dpx, %zu rebuilds\n", BENCH_MIN_SIZE, BENCH_MAX_SIZE, steps);
+    printf("%-8s %10s %12s %12s %12s\n", "mode", "first ms", "rebuild ms", "ascii bytes", "gpu bytes");
+
+    const char *names[] = { "bitmap", "sdf" };
+    for (int mode = GLYPH_MODE_BITMAP; mode <= GLYPH_MODE_SDF; mode++) {
+        BenchResult result;
+        if (bench_sweep(font_path, (GlyphMode)mode, &result) != 0) {
+            printf("%-8s failed to load %s\n", names[mode], font_path);
+            continue;
+        }
+        printf("%-8s %10.2f %12.2f %12zu %12zu\n", names[mode], result.first_ms, result.rebuild_ms,
+               result.glyph_bytes, result.gpu_bytes);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,93 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cell_kernel.h>
+#include <esc_seq.h>
+#include <screen.h>
+
+// plain text fed per pass, a build log without escapes
+#define BENCH_BYTES (16 * 1024 * 1024)
+// span handed to the parser at once, as the drain loop does
+#define BENCH_CHUNK (64 * 1024)
+// bytes fed one at a time for the per byte baseline
+#define BENCH_BYTE_BYTES (1024 * 1024)
+#define BENCH_COLS 200
+#define BENCH_ROWS 50
+#define BENCH_PASSES 5
+// variants compared, the ones this cpu lacks are skipped
+static const char *bench_variants[] = { "scalar", "sse2", "avx2", "neon" };
+
+static double bench_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// lines of 40 to 120 printable bytes ending in crlf
+static void bench_text(uint8_t *text, size_t size) {
+    size_t at = 0;
+    unsigned seed = 1;
+    while (at < size) {
+        seed = seed * 1103515245u + 12345u;
+        size_t length = 40 + (seed >> 16) % 81;
+        for (size_t i = 0; i < length && at < size; i++)
+            text[at++] = (uint8_t)(0x20 + (i * 7 + (seed >> 8)) % 95);
+        if (at < size)
+            text[at++] = '\r';
+        if (at < size)
+            text[at++] = '\n';
+    }
+}
+
+// best throughput in MB/s of parsing size bytes step bytes at a time
+// the screen is flushed after every chunk like a frame would
+static double bench_parse(const uint8_t *text, size_t size, size_t step) {
+    double best = 0.0;
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        Screen screen;
+        esc_parser_t parser;
+        if (screen_init(&screen, BENCH_COLS, BENCH_ROWS) != 0)
+            return 0.0;
+        esc_parser_init(&parser);
+
+        double start = bench_now_ms();
+        for (size_t chunk = 0; chunk < size; chunk += BENCH_CHUNK) {
+            size_t end = chunk + BENCH_CHUNK < size ? chunk + BENCH_CHUNK : size;
+            for (size_t at = chunk; at < end; at += step)
+                esc_parser_feed(&parser, text + at, end - at < step ? end - at : step, &screen);
+            screen_flush(&screen);
+        }
+        double elapsed = bench_now_ms() - start;
+        screen_free(&screen);
+
+        double rate = (double)size / (elapsed * 1e3);
+        if (rate > best)
+            best = rate;
+    }
+    return best;
+}
+
+int main(void) {
+    uint8_t *text = malloc(BENCH_BYTES);
+    if (!text) {
+        printf("Failed to allocate the text\n");
+        return 1;
+    }
+    bench_text(text, BENCH_BYTES);
+
+    printf("plain text on a %dx%d screen, best of %d passes in MB/s\n", BENCH_COLS, BENCH_ROWS, BENCH_PASSES);
+    for (size_t v = 0; v < sizeof(bench_variants) / sizeof(bench_variants[0]); v++) {
+        if (cell_kernel_init(bench_variants[v]) != 0)
+            continue;
+        // a byte per call runs the table for every byte as the parser did before runs were scanned
+        double bytes = bench_parse(text, BENCH_BYTE_BYTES, 1);
+        double runs = bench_parse(text, BENCH_BYTES, BENCH_CHUNK);
+        printf("%-8s per byte %8.1f  runs %8.1f  x%.1f\n", bench_variants[v], bytes, runs, runs / bytes);
+    }
+    free(text);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cell_kernel.h>
+#include <renderer.h>
+#include <shader.h>
+#include <terminal.h>
+#include <text.h>
+
+// small cells give a grid as large as a 4k window at a normal font size
+#define BENCH_TEXT_SCALE 0.1f
+// full redraws timed per thread count, the best one is reported
+#define BENCH_FRAMES 20
+// thread counts compared, the caller comes on top of each
+static const size_t bench_threads[] = { 0, 1, 2, 3, 5, 7 };
+
+static double bench_now_ms(void) {
+    return glfwGetTime() * 1e3;
+}
+
+// fill every row with styled text so each cell yields a glyph and many a background
+static void bench_fill(TerminalState *term) {
+    char line[64];
+    for (int row = 0; row < term->screen.rows * 2; row++) {
+        for (int col = 0; col + 22 <= term->screen.cols; col += 22) {
+            int length = snprintf(line, sizeof(line), "\x1b[3%dm%-12d\x1b[4%dmtext run \x1b[0m ", row % 7 + 1, col,
+                                  col % 7);
+            terminal_process_data(term, (const uint8_t *)line, (size_t)length);
+        }
+        terminal_process_data(term, (const uint8_t *)"\r\n", 2);
+    }
+}
+
+// best wall time of building and queueing a full redraw
+static double bench_redraw(TerminalState *term, Renderer *renderer, size_t threads) {
+    vec3 fg = { 0.9f, 0.9f, 1.0f };
+    vec3 bg = { 0.02f, 0.02f, 0.1f };
+    renderer_set_threads(renderer, threads);
+
+    double best = 0.0;
+    for (int frame = 0; frame <= BENCH_FRAMES; frame++) {
+        renderer->frame_valid = false;
+        glFinish();
+        double start = bench_now_ms();
+        terminal_render(term, renderer, fg, bg);
+        double elapsed = bench_now_ms() - start;
+        // the first frame rasterizes glyphs and warms the pool
+        if (frame == 1 || (frame > 1 && elapsed < best))
+            best = elapsed;
+    }
+    glFinish();
+    return best;
+}
+
+int main(void) {
+    // the renderer needs a context so a hidden window provides one
+    if (!glfwInit())
+        return 1;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow *window = glfwCreateWindow(x_resolution, y_resolution, "render_threads", NULL, NULL);
+    if (!window) {
+        printf("Failed to create GLFW window\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        printf("Failed to initialize GLAD\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    cell_kernel_init(NULL);
+    TerminalState term = {0};
+    Renderer renderer = {0};
+    GLuint program = 0;
+    if (text_setup_characters(NULL) != 0 || (program = initialize_shader()) == 0 ||
+        renderer_init(&renderer, program) != 0 || terminal_init(&term, BENCH_TEXT_SCALE) != 0) {
+        printf("Failed to set up the renderer\n");
+        glfwTerminate();
+        return 1;
+    }
+    bench_fill(&term);
+
+    printf("grid %dx%d, %d full redraws per count\n", term.screen.cols, term.screen.rows, BENCH_FRAMES);
+    printf("%-8s %8s %10s %10s %8s\n", "threads", "jobs", "instances", "best ms", "speedup");
+    double serial = 0.0;
+    for (size_t i = 0; i < sizeof(bench_threads) / sizeof(bench_threads[0]); i++) {
+        double best = bench_redraw(&term, &renderer, bench_threads[i]);
+        if (i == 0)
+            serial = best;
+        printf("%-8zu %8zu %10zu %10.3f %8.2f\n", renderer.stats.threads, renderer.stats.jobs, renderer.instance_count,
+               best, best > 0.0 ? serial / best : 0.0);
+    }
+
+    terminal_free(&term);
+    renderer_free(&renderer);
+    glDeleteProgram(program);
+    text_free_characters();
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,170 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cell_kernel.h>
+#include <scrollback.h>
+
+// rows pushed and kept, a long build log
+#define BENCH_LINES 1000000
+// memory cap of the run that stays in memory and of the one that spills
+#define BENCH_MAX_BYTES ((size_t)64 << 20)
+#define BENCH_SPILL_BYTES ((size_t)8 << 20)
+// newest bytes left uncompressed
+#define BENCH_HOT_BYTES ((size_t)1 << 20)
+// widest row of the synthetic build log
+#define BENCH_COLS 160
+// rows read per viewport when scrolling back
+#define BENCH_VIEW 50
+// lines behind the resize drag, stored soft wrapped at the width they were printed at
+#define BENCH_REWRAP_LINES 100000
+#define BENCH_REWRAP_COLS 80
+
+static double bench_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// build log row of varying width with a coloured tag on some of them
+static size_t bench_row(Cell *cells, size_t index, uint32_t tag) {
+    char text[BENCH_COLS + 1];
+    int length = snprintf(text, sizeof(text), "[%6zu/%6d] cc -O2 -c src/module_%03zu.c -o build/module_%03zu.o%s",
+                          index, BENCH_LINES, index % 997, index % 997, index % 5 == 0 ? " -Wall -Wextra -pedantic" : "");
+    if (index % 9 == 0)
+        length = 0;
+    for (int col = 0; col < length; col++)
+        cells[col] = (Cell){ (uint8_t)text[col], col < 15 && index % 4 == 0 ? tag : STYLE_DEFAULT_ID };
+    return (size_t)length;
+}
+
+// push the log and scroll back through all of it, newest viewport first
+static void bench_run(const char *name, StyleTable *styles, const Cell *rows, const size_t *lengths, size_t row_count,
+                      size_t max_bytes, bool spill) {
+    Scrollback history;
+    if (scrollback_init(&history, styles, BENCH_LINES, max_bytes) != 0 ||
+        scrollback_start_cold(&history, BENCH_HOT_BYTES, spill) != 0) {
+        printf("Failed to set up the history\n");
+        scrollback_free(&history);
+        return;
+    }
+
+    double start = bench_now_ms();
+    for (size_t i = 0; i < BENCH_LINES; i++) {
+        size_t row = i % row_count;
+        scrollback_push(&history, rows + row * BENCH_COLS, lengths[row], false);
+    }
+    double push_ms = bench_now_ms() - start;
+
+    // the newest rows are still hot, everything older inflates on the way
+    ScrollbackLine view[BENCH_VIEW];
+    uint64_t sink = 0;
+    size_t lines = scrollback_lines(&history);
+    size_t hot = 0;
+    double hot_ms = 0.0;
+    start = bench_now_ms();
+    for (size_t first = lines; first >= BENCH_VIEW; first -= BENCH_VIEW) {
+        size_t read = scrollback_read(&history, first - BENCH_VIEW, BENCH_VIEW, view);
+        for (size_t i = 0; i < read; i++)
+            sink += view[i].length;
+        if (lines - first < BENCH_HOT_BYTES / (64 * sizeof(Cell))) {
+            hot += BENCH_VIEW;
+            hot_ms = bench_now_ms() - start;
+        }
+    }
+    double read_ms = bench_now_ms() - start;
+
+    size_t memory = scrollback_memory(&history);
+    printf("%s: kept %zu rows (%llu cells read)\n", name, lines, (unsigned long long)sink);
+    printf("  push      %8.1f ns per row\n", push_ms * 1e6 / BENCH_LINES);
+    printf("  read hot  %8.1f ns per row\n", hot ? hot_ms * 1e6 / (double)hot : 0.0);
+    printf("  read cold %8.1f ns per row\n", (read_ms - hot_ms) * 1e6 / (double)(lines - hot));
+    printf("  memory %.2f MiB, spilled %.2f MiB, %.1f bytes per row\n", (double)memory / (1024.0 * 1024.0),
+           (double)scrollback_spilled(&history) / (1024.0 * 1024.0),
+           (double)(memory + scrollback_spilled(&history)) / (double)lines);
+    scrollback_free(&history);
+}
+
+// drag the window from narrow to wide and back, laying out one viewport per width
+// at the bottom and half way up the history, where every block below has to be measured again
+static void bench_rewrap(StyleTable *styles, const Cell *rows, const size_t *lengths, size_t row_count) {
+    Scrollback history;
+    if (scrollback_init(&history, styles, BENCH_LINES, BENCH_MAX_BYTES) != 0 ||
+        scrollback_start_cold(&history, BENCH_HOT_BYTES, false) != 0) {
+        printf("Failed to set up the history\n");
+        scrollback_free(&history);
+        return;
+    }
+    for (size_t i = 0; i < BENCH_REWRAP_LINES; i++) {
+        size_t row = i % row_count;
+        size_t length = lengths[row];
+        for (size_t col = 0; col == 0 || col < length; col += BENCH_REWRAP_COLS) {
+            bool wrapped = col + BENCH_REWRAP_COLS < length;
+            scrollback_push(&history, rows + row * BENCH_COLS + col, wrapped ? BENCH_REWRAP_COLS : length - col, wrapped);
+        }
+    }
+
+    ScrollbackLine view[BENCH_VIEW];
+    size_t back = scrollback_lines(&history) / 2;
+    double bottom_ms = 0.0, bottom_worst = 0.0, middle_ms = 0.0, middle_worst = 0.0;
+    size_t widths = 0, short_reads = 0;
+    for (size_t step = 0; step < 2 * (BENCH_COLS - 40); step++) {
+        size_t width = step < BENCH_COLS - 40 ? 40 + step : 2 * BENCH_COLS - 40 - step;
+        double start = bench_now_ms();
+        short_reads += scrollback_read_width(&history, width, 0, BENCH_VIEW, view) != BENCH_VIEW;
+        double bottom = bench_now_ms() - start;
+        start = bench_now_ms();
+        short_reads += scrollback_read_width(&history, width, back, BENCH_VIEW, view) != BENCH_VIEW;
+        double middle = bench_now_ms() - start;
+        bottom_ms += bottom;
+        middle_ms += middle;
+        bottom_worst = bottom > bottom_worst ? bottom : bottom_worst;
+        middle_worst = middle > middle_worst ? middle : middle_worst;
+        widths++;
+    }
+
+    printf("rewrap: %zu rows over %d lines, %zu widths dragged, %zu short reads\n", scrollback_lines(&history),
+           BENCH_REWRAP_LINES, widths, short_reads);
+    printf("  bottom    %8.3f ms per width, worst %.3f ms\n", bottom_ms / (double)widths, bottom_worst);
+    printf("  half way  %8.3f ms per width, worst %.3f ms\n", middle_ms / (double)widths, middle_worst);
+    scrollback_free(&history);
+}
+
+int main(void) {
+    cell_kernel_init(NULL);
+
+    StyleTable styles;
+    Style warning = { .fg = STYLE_COLOR(STYLE_COLOR_INDEXED, 3), .bg = 0, .attrs = STYLE_BOLD };
+    if (style_table_init(&styles) != 0) {
+        printf("Failed to set up the style table\n");
+        return 1;
+    }
+    uint32_t tag = style_table_intern(&styles, &warning);
+
+    // rows are built ahead so only pushes are timed
+    size_t row_count = 4096;
+    Cell *rows = malloc(row_count * BENCH_COLS * sizeof(Cell));
+    size_t *lengths = malloc(row_count * sizeof(size_t));
+    if (!rows || !lengths) {
+        printf("Failed to allocate the rows\n");
+        return 1;
+    }
+    size_t cells = 0;
+    for (size_t i = 0; i < row_count; i++) {
+        lengths[i] = bench_row(rows + i * BENCH_COLS, i, tag);
+        cells += lengths[i];
+    }
+    printf("pushing %d rows averaging %.1f cells\n", BENCH_LINES, (double)cells / (double)row_count);
+
+    bench_run("in memory", &styles, rows, lengths, row_count, BENCH_MAX_BYTES, false);
+    bench_run("spilling", &styles, rows, lengths, row_count, BENCH_SPILL_BYTES, true);
+    bench_rewrap(&styles, rows, lengths, row_count);
+
+    style_table_free(&styles);
+    free(rows);
+    free(lengths);
+    return 0;
+}
@@ -1,8 +1,8 @@
-#ifndef APP_H
-#define APP_H
-
-// run main application loop and return status code
-int app_run(void);
-
-#endif // APP_H
-
+#ifndef APP_H
+#define APP_H
+
+// run main application loop and return status code
+int app_run(int argc, char **argv);
+
+#endif // APP_H
+
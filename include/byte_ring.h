@@ -0,0 +1,33 @@
+#ifndef BYTE_RING_H
+#define BYTE_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// lock free single producer single consumer byte ring
+// head and tail grow monotonically and are masked into the buffer
+typedef struct ByteRing {
+    uint8_t *data;
+    size_t capacity;   // power of two
+    _Alignas(64) atomic_size_t head;   // written by producer
+    _Alignas(64) atomic_size_t tail;   // written by consumer
+} ByteRing;
+
+// allocate ring rounded up to a power of two capacity
+int byte_ring_init(ByteRing *ring, size_t capacity);
+// release ring storage
+void byte_ring_free(ByteRing *ring);
+// producer: return contiguous writable span and its length
+size_t byte_ring_write_span(ByteRing *ring, uint8_t **out);
+// producer: publish bytes written into the span
+void byte_ring_commit(ByteRing *ring, size_t n);
+// consumer: return contiguous readable span and its length
+size_t byte_ring_read_span(ByteRing *ring, const uint8_t **out);
+// consumer: release bytes that were processed
+void byte_ring_consume(ByteRing *ring, size_t n);
+// number of bytes currently buffered
+size_t byte_ring_size(ByteRing *ring);
+
+#endif // BYTE_RING_H
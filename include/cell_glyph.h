@@ -0,0 +1,16 @@
+#ifndef CELL_GLYPH_H
+#define CELL_GLYPH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// box drawing, block elements and braille are drawn to fill the cell
+// instead of coming from the font so neighbouring cells join exactly
+static inline bool cell_glyph_covers(uint32_t codepoint) {
+    return (codepoint >= 0x2500 && codepoint <= 0x259F) || (codepoint >= 0x2800 && codepoint <= 0x28FF);
+}
+
+// draw a covered codepoint as width * height coverage bytes
+void cell_glyph_render(uint32_t codepoint, int width, int height, uint8_t *pixels);
+
+#endif // CELL_GLYPH_H
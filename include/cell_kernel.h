@@ -0,0 +1,81 @@
+#ifndef CELL_KERNEL_H
+#define CELL_KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <screen.h>
+
+// grid cell primitives with one implementation per instruction set
+// every variant returns the same results so they can be swapped at runtime
+typedef struct CellKernels {
+    const char *name;
+    // set count cells to value
+    void (*fill)(Cell *cells, size_t count, Cell value);
+    // copy count cells, the spans may overlap
+    void (*copy)(Cell *dst, const Cell *src, size_t count);
+    // return the index of the first cell that differs or count
+    size_t (*diff)(const Cell *a, const Cell *b, size_t count);
+    // return the index of the first cell not in style or count
+    size_t (*style_run)(const Cell *cells, size_t count, uint32_t style);
+    // write ascii bytes or codepoints as cells of one style
+    void (*store_bytes)(Cell *dst, const uint8_t *text, size_t count, uint32_t style);
+    void (*store_codepoints)(Cell *dst, const uint32_t *codepoints, size_t count, uint32_t style);
+    // hash codepoints and style ids of count cells
+    uint64_t (*hash)(const Cell *cells, size_t count);
+    // return the length of the leading run of printable ascii bytes
+    size_t (*scan_printable)(const uint8_t *text, size_t count);
+    // fill masks for the UTF8_BLOCK bytes at text
+    void (*classify_utf8)(const uint8_t *text, Utf8Masks *masks);
+} CellKernels;
+
+// variant in use, scalar until cell_kernel_init picks one
+extern CellKernels cell_kernels;
+
+// select the variant called name (scalar, sse2, avx2 or neon) or the best one this cpu runs when NULL
+// an unknown or unsupported name selects the best one and returns -1
+int cell_kernel_init(const char *name);
+
+static inline void cell_fill(Cell *cells, size_t count, Cell value) {
+    cell_kernels.fill(cells, count, value);
+}
+
+static inline void cell_copy(Cell *dst, const Cell *src, size_t count) {
+    cell_kernels.copy(dst, src, count);
+}
+
+static inline size_t cell_diff(const Cell *a, const Cell *b, size_t count) {
+    return cell_kernels.diff(a, b, count);
+}
+
+// return true when both spans hold the same cells
+static inline bool cell_equal(const Cell *a, const Cell *b, size_t count) {
+    return cell_kernels.diff(a, b, count) == count;
+}
+
+static inline size_t cell_style_run(const Cell *cells, size_t count, uint32_t style) {
+    return cell_kernels.style_run(cells, count, style);
+}
+
+static inline void cell_store_bytes(Cell *dst, const uint8_t *text, size_t count, uint32_t style) {
+    cell_kernels.store_bytes(dst, text, count, style);
+}
+
+static inline void cell_store_codepoints(Cell *dst, const uint32_t *codepoints, size_t count, uint32_t style) {
+    cell_kernels.store_codepoints(dst, codepoints, count, style);
+}
+
+static inline uint64_t cell_hash(const Cell *cells, size_t count) {
+    return cell_kernels.hash(cells, count);
+}
+
+static inline size_t cell_scan_printable(const uint8_t *text, size_t count) {
+    return cell_kernels.scan_printable(text, count);
+}
+
+static inline void cell_classify_utf8(const uint8_t *text, Utf8Masks *masks) {
+    cell_kernels.classify_utf8(text, masks);
+}
+
+#endif // CELL_KERNEL_H
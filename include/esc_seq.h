@@ -1,37 +1,50 @@
-#ifndef ESC_SEQ_H
-#define ESC_SEQ_H
-
-#include <stdint.h>
-#include <stddef.h>
-#include <stdbool.h>
-
-// track escape sequence parser state
-typedef enum {
-    ESC_STATE_NORMAL,
-    ESC_STATE_ESC,
-    ESC_STATE_CSI,
-    ESC_STATE_CSI_PARAM,
-    ESC_STATE_OSC
-} esc_state_t;
-
-// aggregate parser buffers and parameters
-typedef struct {
-    esc_state_t state;
-    char buf[256];
-    size_t buf_pos;
-    int params[16];
-    int param_count;
-    bool osc_waiting_backslash;
-    bool params_present;
-} esc_parser_t;
-
-// reset parser to default state
-void esc_parser_init(esc_parser_t *parser);
-// process byte and apply control effects
-int esc_parser_process(esc_parser_t *parser, uint8_t byte, int *cursor_row, int *cursor_col, int *grid, int grid_x_size, int grid_y_size, int *scroll_top, int *scroll_bottom);
-// scroll region upward by one line
-void term_scroll_region_up(int *grid, int grid_x_size, int scroll_top, int scroll_bottom);
-// scroll region downward by one line
-void term_scroll_region_down(int *grid, int grid_x_size, int scroll_top, int scroll_bottom);
-
-#endif
+#ifndef ESC_SEQ_H
+#define ESC_SEQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <screen.h>
+#include <utf8.h>
+
+#define ESC_MAX_PARAMS 16
+#define ESC_MAX_INTERMEDIATES 4
+
+// track escape sequence parser state following the dec vt500 model
+typedef enum {
+    ESC_STATE_GROUND,
+    ESC_STATE_ESCAPE,
+    ESC_STATE_ESCAPE_INTERMEDIATE,
+    ESC_STATE_CSI_ENTRY,
+    ESC_STATE_CSI_PARAM,
+    ESC_STATE_CSI_INTERMEDIATE,
+    ESC_STATE_CSI_IGNORE,
+    ESC_STATE_DCS_ENTRY,
+    ESC_STATE_DCS_PARAM,
+    ESC_STATE_DCS_INTERMEDIATE,
+    ESC_STATE_DCS_PASSTHROUGH,
+    ESC_STATE_DCS_IGNORE,
+    ESC_STATE_OSC_STRING,
+    ESC_STATE_SOS_PM_APC_STRING,
+    ESC_STATE_COUNT
+} esc_state_t;
+
+// aggregate parser state and incrementally parsed parameters
+typedef struct {
+    esc_state_t state;
+    int params[ESC_MAX_PARAMS];      // zero means default
+    int param_count;
+    uint32_t param_colons;           // bit i set when params[i] followed a colon
+    uint8_t intermediates[ESC_MAX_INTERMEDIATES];  // includes private markers
+    int intermediate_count;
+    bool intermediates_overflow;
+    Utf8Decoder utf8;                // text sequence split across reads
+} esc_parser_t;
+
+// reset parser to default state
+void esc_parser_init(esc_parser_t *parser);
+// run a block of bytes through the state machine and apply them to screen
+void esc_parser_feed(esc_parser_t *parser, const uint8_t *data, size_t len, Screen *screen);
+
+#endif
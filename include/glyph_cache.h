@@ -0,0 +1,154 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glad/glad.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+// side of one square atlas page in texels
+#define GLYPH_PAGE_SIZE 1024
+// gap kept around glyphs so filtering never samples a neighbour
+#define GLYPH_PADDING 2
+// faces a cache can rasterize from
+#define GLYPH_CACHE_MAX_FACES 4
+// face index of glyphs drawn by the caller instead of a font
+#define GLYPH_FACE_CUSTOM UINT16_MAX
+// entry id standing for no entry
+#define GLYPH_ENTRY_NONE UINT32_MAX
+// atlas memory used when no budget is configured
+#define GLYPH_CACHE_DEFAULT_BUDGET ((size_t)8 * GLYPH_PAGE_SIZE * GLYPH_PAGE_SIZE)
+
+// how glyph bitmaps are stored in the atlas
+typedef enum GlyphMode {
+    GLYPH_MODE_BITMAP,   // coverage rasterized per pixel size
+    GLYPH_MODE_SDF,      // distance field rasterized once and scaled in the shader
+} GlyphMode;
+
+// identify one rasterization of a codepoint
+typedef struct GlyphKey {
+    uint32_t codepoint;
+    uint16_t face;       // index returned by glyph_cache_add_face
+    uint16_t style;      // style attribute bits the glyph was drawn for
+    uint32_t pixel_size;
+} GlyphKey;
+
+// placement and metrics of a cached glyph
+typedef struct Glyph {
+    uint16_t page;       // texture array layer
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;      // zero for glyphs without a bitmap
+    uint16_t height;
+    int16_t bearing_x;   // offset from pen to left edge
+    int16_t bearing_y;   // offset from baseline to top edge
+    int32_t advance;     // 26.6 fixed point
+} Glyph;
+
+// counters reported for diagnostics
+typedef struct GlyphCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t compactions; // pages repacked to reclaim evicted space
+    size_t glyphs;
+    size_t pages;
+    size_t gpu_bytes;
+} GlyphCacheStats;
+
+// one run of the skyline packer
+typedef struct GlyphSkyline {
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+} GlyphSkyline;
+
+// atlas page with a cpu copy used to repack it
+typedef struct GlyphPage {
+    uint8_t *pixels;
+    GlyphSkyline *skyline;
+    size_t skyline_count;
+    size_t dead_area;    // texels held by evicted glyphs
+    uint64_t frame;      // last frame that drew from the page
+    uint32_t pixel_size; // size bucket the page belongs to, zero while unused
+} GlyphPage;
+
+// cached glyph linked into the lru list by entry index
+typedef struct GlyphEntry {
+    GlyphKey key;
+    Glyph glyph;
+    uint64_t frame;
+    uint32_t prev;
+    uint32_t next;       // also links free entries
+} GlyphEntry;
+
+struct GlyphRaster;
+
+// glyphs rasterized on first use and packed into texture array pages
+// each pixel size packs into its own pages so a whole size can be dropped
+// glyphs drawn in the current frame are never moved or evicted
+// so instances built from earlier lookups stay valid until the draw
+typedef struct GlyphCache {
+    FT_Library library;
+    FT_Face faces[GLYPH_CACHE_MAX_FACES];
+    uint32_t face_sizes[GLYPH_CACHE_MAX_FACES];
+    char *face_paths[GLYPH_CACHE_MAX_FACES];
+    size_t face_count;
+    GlyphMode mode;      // chosen before the first lookup
+    struct GlyphRaster *raster; // background rasterizer started on first prepare
+    void (*wake)(void);  // called from the rasterizer when bitmaps are ready
+    uint32_t prepare_size; // size being rasterized in the background
+    uint32_t prepare_generation;
+    size_t prepare_pending;
+    GLuint texture;      // 2d array with one layer per page
+    size_t texture_layers;
+    GlyphPage *pages;
+    size_t page_count;
+    size_t max_pages;    // pages allowed by the budget
+    GlyphEntry *entries;
+    size_t entry_count;  // entries handed out so far
+    size_t entry_capacity;
+    uint32_t free_entry;
+    uint32_t *slots;     // open addressing hash holding entry + 1
+    size_t slot_mask;
+    uint32_t lru_head;   // most recently used
+    uint32_t lru_tail;
+    uint64_t frame;
+    GlyphCacheStats stats;
+} GlyphCache;
+
+// create an empty cache whose pages stay within budget_bytes
+// wake is called from another thread when background glyphs are ready
+int glyph_cache_init(GlyphCache *cache, size_t budget_bytes, void (*wake)(void));
+// release pages textures and faces
+void glyph_cache_free(GlyphCache *cache);
+// open a font file and return its face index
+int glyph_cache_add_face(GlyphCache *cache, const char *path);
+// start a frame so glyphs drawn by the previous one may be evicted
+void glyph_cache_begin_frame(GlyphCache *cache);
+// return a glyph rasterizing it on a miss or NULL when it cannot be loaded
+const Glyph *glyph_cache_lookup(GlyphCache *cache, GlyphKey key);
+// return a cached glyph without rasterizing it or NULL on a miss
+const Glyph *glyph_cache_peek(GlyphCache *cache, GlyphKey key);
+// return the entry id under key or GLYPH_ENTRY_NONE without changing the cache
+// any number of threads may find while nothing modifies the cache
+uint32_t glyph_cache_find(const GlyphCache *cache, const GlyphKey *key);
+// mark an entry found earlier as drawn by the current frame and return its glyph
+const Glyph *glyph_cache_use(GlyphCache *cache, uint32_t id);
+// pack width * height bytes drawn by the caller with the metrics in glyph
+const Glyph *glyph_cache_put(GlyphCache *cache, GlyphKey key, Glyph glyph, const uint8_t *pixels);
+// rasterize in the background the glyphs recently drawn at from_size at to_size
+void glyph_cache_prepare_size(GlyphCache *cache, uint32_t from_size, uint32_t to_size);
+// pack finished background glyphs and return true when any were added
+bool glyph_cache_poll(GlyphCache *cache);
+// return true once every glyph prepared for pixel_size is packed
+bool glyph_cache_size_ready(const GlyphCache *cache, uint32_t pixel_size);
+// evict every glyph of a pixel size and return its pages to the pool
+void glyph_cache_release_size(GlyphCache *cache, uint32_t pixel_size);
+// return the face metrics for a pixel size
+const FT_Size_Metrics *glyph_cache_metrics(GlyphCache *cache, uint16_t face, uint32_t pixel_size);
+
+#endif // GLYPH_CACHE_H
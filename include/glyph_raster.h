@@ -0,0 +1,55 @@
+#ifndef GLYPH_RASTER_H
+#define GLYPH_RASTER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glyph_cache.h>
+
+// callback used to wake the event loop when bitmaps are ready
+typedef void (*glyph_raster_wake_fn)(void);
+
+// glyph rendered off the main thread waiting to be packed
+typedef struct GlyphBitmap {
+    GlyphKey key;
+    uint32_t generation; // submission the bitmap belongs to
+    uint8_t *pixels;     // width * height bytes without row padding
+    Glyph glyph;         // metrics, placement is filled in when packed
+    bool loaded;         // false when the face could not render the glyph
+} GlyphBitmap;
+
+// worker thread with its own freetype library rasterizing queued keys
+// freetype objects are not shared so the main thread keeps its faces
+typedef struct GlyphRaster {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    glyph_raster_wake_fn wake;
+    char *paths[GLYPH_CACHE_MAX_FACES];
+    size_t face_count;
+    GlyphKey *jobs;
+    size_t job_next;     // first job not taken by the worker
+    size_t job_count;
+    uint32_t generation;
+    GlyphBitmap *done;
+    size_t done_count;
+    size_t done_capacity;
+    size_t failed;       // keys of the current generation whose bitmap found no room in done
+    bool stop;
+    bool running;
+} GlyphRaster;
+
+// start the worker for the given font files
+int glyph_raster_start(GlyphRaster *raster, char *const *paths, size_t face_count, glyph_raster_wake_fn wake);
+// replace queued work with keys and return the new generation
+// out_queued is set to the keys actually queued, none when the queue could not grow
+uint32_t glyph_raster_submit(GlyphRaster *raster, const GlyphKey *keys, size_t count, size_t *out_queued);
+// move finished bitmaps to the caller which frees their pixels
+// out_failed is set to the keys of the current generation that finished without a bitmap to hand over
+size_t glyph_raster_take(GlyphRaster *raster, GlyphBitmap **out, size_t *out_failed);
+// stop the worker and drop unfinished work
+void glyph_raster_stop(GlyphRaster *raster);
+
+#endif // GLYPH_RASTER_H
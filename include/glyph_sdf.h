@@ -0,0 +1,20 @@
+#ifndef GLYPH_SDF_H
+#define GLYPH_SDF_H
+
+#include <stdint.h>
+
+#include <glyph_cache.h>
+
+// coverage is rendered this many times larger than the distance field
+#define GLYPH_SDF_UPSCALE 4
+// distance in field texels that maps to the full value range around an edge
+#define GLYPH_SDF_SPREAD 4
+
+// build a distance field from a coverage bitmap rendered GLYPH_SDF_UPSCALE times larger
+// left and top place the bitmap relative to the pen like freetype bitmap_left and bitmap_top
+// on success *out holds width * height bytes with 128 on the outline and glyph metrics
+// describe the padded field, the caller frees *out
+int glyph_sdf_build(const uint8_t *coverage, int width, int height, int pitch, int left, int top, uint8_t **out,
+                    Glyph *glyph);
+
+#endif // GLYPH_SDF_H
@@ -1,14 +1,44 @@
-#pragma once
-#include <sys/types.h>
-#include <stdint.h>
-#include <stddef.h>
-
-// spawn child process attached to pty and return descriptors
-int  pty_spawn(const char* shell, int* out_master_fd, int* out_child_pid);
-// update terminal window size for child process
-int  pty_set_winsize(int master_fd, int rows, int cols);
-// write bytes to pty master
-ssize_t pty_write(int master_fd, const void* buf, size_t n);
-// read bytes from pty master
-ssize_t pty_read(int master_fd, uint8_t* buf, size_t cap);
-
+#pragma once
+#include <sys/types.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include <byte_ring.h>
+
+// spawn child process attached to pty and return descriptors
+int  pty_spawn(const char* shell, int* out_master_fd, int* out_child_pid);
+// update terminal window size for child process
+int  pty_set_winsize(int master_fd, int rows, int cols);
+// write bytes to pty master
+ssize_t pty_write(int master_fd, const void* buf, size_t n);
+// read bytes from pty master
+ssize_t pty_read(int master_fd, uint8_t* buf, size_t cap);
+
+// callback used to wake the event loop from another thread
+typedef void (*pty_wake_fn)(void);
+
+// background thread reading the master fd into a byte ring
+typedef struct PtyReader {
+    int master_fd;
+    int control_pipe[2];
+    pthread_t thread;
+    pty_wake_fn wake;
+    ByteRing ring;
+    atomic_bool wake_pending;    // consumer has not seen the last wake yet
+    atomic_bool space_waiting;   // producer is parked on a full ring
+    bool running;
+} PtyReader;
+
+// allocate ring and start reading master fd on its own thread
+int  pty_reader_start(PtyReader* reader, int master_fd, size_t ring_capacity, pty_wake_fn wake);
+// consumer: return contiguous span of buffered output
+size_t pty_reader_peek(PtyReader* reader, const uint8_t** out);
+// consumer: release processed bytes and resume a parked reader
+void pty_reader_consume(PtyReader* reader, size_t n);
+// consumer: acknowledge wake before draining so new output wakes again
+void pty_reader_begin_drain(PtyReader* reader);
+// stop reader thread and free its ring
+void pty_reader_stop(PtyReader* reader);
@@ -0,0 +1,190 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glad/glad.h>
+#include <cglm/cglm.h>
+
+#include <screen.h>
+#include <stream_buffer.h>
+#include <work_pool.h>
+
+// instance flag drawing a solid block instead of a glyph
+// solid blocks cover atlas_w cells starting at col
+#define GLYPH_INSTANCE_SOLID 0x1u
+// glyph flag slanting the quad for italic text
+#define GLYPH_INSTANCE_ITALIC 0x2u
+// solid flags shrinking the block to a line decoration
+#define GLYPH_INSTANCE_UNDERLINE 0x4u
+#define GLYPH_INSTANCE_DOUBLE_UNDERLINE 0x8u
+#define GLYPH_INSTANCE_UNDERCURL 0x10u
+#define GLYPH_INSTANCE_STRIKE 0x20u
+// glyph flag stretching a procedural glyph over the whole cell
+#define GLYPH_INSTANCE_CELL 0x40u
+// glyph flags carry the atlas page from this bit upward
+#define GLYPH_INSTANCE_PAGE_SHIFT 16
+
+// describe one quad of the instanced grid draw
+typedef struct GlyphInstance {
+    uint16_t col;
+    uint16_t row;
+    uint16_t atlas_x;
+    uint16_t atlas_y;
+    uint16_t atlas_w;
+    uint16_t atlas_h;
+    int16_t bearing_x;
+    int16_t bearing_y;
+    uint8_t color[4];
+    uint32_t flags;
+} GlyphInstance;
+
+// how the cell grid reaches the screen
+typedef enum RendererBackend {
+    RENDERER_BACKEND_INSTANCED, // one quad per glyph into a retained frame
+    RENDERER_BACKEND_GRID,      // one fullscreen triangle shading cells from textures
+} RendererBackend;
+
+// colors and flags resolved from a cell style
+typedef struct CellPaint {
+    uint8_t fg[4];
+    uint8_t bg[4];
+    bool has_bg;       // background differs from the cleared framebuffer
+    uint32_t attrs;
+} CellPaint;
+
+// placement of the grid shared by both backends, in window pixels
+typedef struct RendererLayout {
+    float origin_x;      // left edge of the first column
+    float origin_y;      // bottom of the lowest row
+    float baseline;      // baseline height above the bottom of a row
+    float glyph_scale;
+    float underline[2];  // bottom offset from the baseline and height
+    float strike[2];
+} RendererLayout;
+
+// scissored region of the retained frame redrawn from a run of instances
+typedef struct RendererBand {
+    GLint x;
+    GLint y;
+    GLsizei width;
+    GLsizei height;
+    size_t first;        // first instance drawn into the band
+    size_t count;
+    size_t first_job;    // jobs building the instances, in draw order
+    size_t job_count;
+} RendererBand;
+
+// rows of one band whose instances are built in one piece, possibly on a worker
+// each job fills its own worst case slice of the staging array
+typedef struct RendererJob {
+    int top;
+    int bottom;
+    int left;
+    int right;
+    bool backgrounds;    // background runs, otherwise glyphs and decorations
+    size_t first;        // slice of the staging array
+    size_t count;
+    size_t offset;       // position in the upload once jobs are packed
+    size_t touch_first;  // slice of glyph entries found by the job
+    size_t touch_count;
+    size_t misses;       // instances waiting for glyphs the cache lacked
+} RendererJob;
+
+// everything besides cell contents that the retained frame depends on
+typedef struct RendererFrameKey {
+    int width;
+    int height;
+    float cell_width;
+    float cell_height;
+    float origin_x;
+    float origin_y;
+    float glyph_scale;
+    uint32_t glyph_mode;
+    uint8_t fg[4];
+    uint8_t bg[4];
+} RendererFrameKey;
+
+// counters of the last frame and totals for diagnostics
+typedef struct RendererStats {
+    size_t cells_redrawn;  // cells inside the scissored bands of the last frame
+    size_t rows_redrawn;
+    size_t bands;
+    size_t rows_scrolled;  // rows moved by the frame blit of the last frame
+    uint64_t frames;
+    uint64_t full_redraws;
+    uint64_t scroll_blits;
+    uint64_t scroll_guesses; // blits found by matching row hashes
+    size_t jobs;           // pieces the instances of the last frame were built in
+    size_t threads;        // threads that built them, the caller included
+} RendererStats;
+
+struct RendererGrid;
+
+// own gpu buffers and cpu staging for grid instances
+// the grid is kept in an offscreen frame and only damaged rows are redrawn
+// large redraws build their instances on a pool of workers
+// scrolled content is moved inside the frame by a blit through a scratch copy
+// and row hashes of what the frame shows skip rows that already match
+typedef struct Renderer {
+    RendererBackend backend;
+    struct RendererGrid *grid; // created when the grid backend is chosen
+    GLuint shader_program;
+    GLuint vao;
+    StreamBuffer stream;   // instances of each frame are streamed through this ring
+    GlyphInstance *instances;
+    size_t instance_count;
+    size_t instance_capacity;
+    RendererJob *jobs;
+    size_t job_count;
+    size_t job_capacity;
+    uint32_t *touched;     // glyph entries found by jobs, marked used once they finish
+    size_t touch_capacity;
+    WorkPool pool;         // started the first time a grid is large enough
+    size_t threads;        // workers the pool runs besides the caller
+    RendererBand *bands;
+    size_t band_count;
+    size_t band_capacity;
+    GLuint frame_fbo;      // zero when offscreen rendering is unavailable
+    GLuint frame_texture;
+    GLuint scratch_fbo;    // blit source for shifting the frame, zero when unavailable
+    GLuint scratch_texture;
+    uint64_t *row_hashes;  // content drawn into each row of the frame, zero when unknown
+    uint64_t *next_hashes;
+    int hash_rows;
+    RendererFrameKey frame_key;
+    bool frame_valid;      // the retained frame matches frame_key
+    RendererStats stats;
+    GLint origin_location;
+    GLint cell_size_location;
+    GLint scale_location;
+    GLint grid_rows_location;
+    GLint solid_span_location;
+    GLint underline_location;
+    GLint strike_location;
+    GLint distance_field_location;
+} Renderer;
+
+// create vertex array and instance buffer for program
+int renderer_init(Renderer *renderer, GLuint shader_program);
+// release gpu buffers and staging memory
+void renderer_free(Renderer *renderer);
+// switch backends, keeping the current one when the new one cannot be set up
+int renderer_set_backend(Renderer *renderer, RendererBackend backend);
+// parse a backend name as given on the command line
+int renderer_backend_parse(const char *name, RendererBackend *backend);
+// set the workers building instances of large redraws, zero builds them on the caller
+void renderer_set_threads(Renderer *renderer, size_t threads);
+// redraw damaged rows of the retained frame and copy it to the window
+void renderer_draw_grid(Renderer *renderer, const Screen *screen, bool cursor_visible, float text_scale, const vec3 fg_color,
+                        const vec3 bg_color);
+// move frame pixels in rows [y0, y1) by dy pixels upward, false when the frame cannot be shifted
+bool renderer_shift_frame(Renderer *renderer, int y0, int y1, int dy);
+// resolve a style against the default colors
+void renderer_resolve(const Style *style, const uint8_t fg[4], const uint8_t bg[4], CellPaint *paint);
+// return the instance flag drawing the underline kind in attrs
+uint32_t renderer_underline_flag(uint32_t attrs);
+
+#endif // RENDERER_H
@@ -0,0 +1,71 @@
+#ifndef RENDERER_GRID_H
+#define RENDERER_GRID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glad/glad.h>
+
+#include <glyph_cache.h>
+#include <renderer.h>
+#include <screen.h>
+
+// columns of the style texture, ids wrap onto further rows
+#define RENDERER_GRID_STYLE_WIDTH 256
+
+// texel flags describing the glyph of a cell
+#define RENDERER_GRID_GLYPH 0x1u
+#define RENDERER_GRID_CELL_GLYPH 0x2u
+
+// everything besides cell contents the uploaded cells depend on
+typedef struct RendererGridKey {
+    int cols;
+    int rows;
+    int pool_rows;
+    float cell_width;
+    float cell_height;
+    float glyph_scale;
+    uint32_t glyph_pixel_size;
+    uint32_t glyph_mode;
+    uint64_t glyph_moves;  // evictions and compactions the placements survived
+} RendererGridKey;
+
+// cell grid kept on the gpu and shaded by one fullscreen triangle
+// cells hold atlas placement and style id and are indexed by pool row
+// so scrolls only upload the row map and the rows they expose
+typedef struct RendererGrid {
+    GLuint program;
+    GLuint vao;            // empty, the triangle comes from gl_VertexID
+    GLuint cell_texture;   // rgba32ui, cols by pool rows
+    GLuint style_texture;  // rgba32ui, fg bg and flags per style id
+    GLuint row_texture;    // r32ui, pool row of each logical row
+    uint32_t *texels;      // staging for one row of cells
+    uint32_t *styles;      // resolved styles as last uploaded
+    size_t style_count;
+    size_t style_capacity; // ids the style texture holds
+    uint32_t *row_map;
+    RendererGridKey key;
+    bool valid;            // uploaded cells match key
+    GLint origin_location;
+    GLint cell_size_location;
+    GLint grid_size_location;
+    GLint baseline_location;
+    GLint scale_location;
+    GLint underline_location;
+    GLint strike_location;
+    GLint cursor_location;
+    GLint default_fg_location;
+    GLint default_bg_location;
+    GLint distance_field_location;
+} RendererGrid;
+
+// compile the grid program and create its textures
+int renderer_grid_init(RendererGrid *grid);
+// release textures and staging memory
+void renderer_grid_free(RendererGrid *grid);
+// upload damaged rows and shade the whole window
+void renderer_grid_draw(RendererGrid *grid, const Screen *screen, bool cursor_visible, const RendererLayout *layout,
+                        const uint8_t fg[4], const uint8_t bg[4], RendererStats *stats);
+
+#endif // RENDERER_GRID_H
@@ -0,0 +1,124 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <screen_damage.h>
+#include <screen_ops.h>
+#include <style.h>
+#include <utf8.h>
+
+struct Scrollback;
+
+// one grid cell, the style id indexes the screen style table
+typedef struct Cell {
+    uint32_t codepoint;
+    uint32_t style;
+} Cell;
+
+// blank value of a row whose cells may differ
+#define SCREEN_LINE_MIXED UINT32_MAX
+
+// one row of the line ring
+typedef struct Line {
+    Cell *cells;
+    uint32_t blank;     // style of a row erased as a whole or SCREEN_LINE_MIXED
+    bool wrapped;       // text ran past the last column onto the next row
+} Line;
+
+// visible cell grid with cursor and scroll margins
+// cursor and margins update immediately while grid writes are queued
+// rows live in a pool and are reached through a ring of row pointers
+// so scrolling moves pointers instead of cells
+// pools hold spare rows and columns so most resizes reuse them in place
+typedef struct Screen {
+    Cell *cells;        // row pool of pool_rows rows of stride cells
+    Line *lines;        // logical row r is lines[(line_base + r) % rows], spare rows follow
+    Cell *back_cells;   // pool a rewrapping resize writes into, kept once allocated
+    Line *back_lines;
+    int line_base;
+    int cols;
+    int rows;
+    int stride;         // cells per pool row, the widest the grid gets in place
+    int pool_rows;      // rows each pool holds
+    int cursor_row;
+    int cursor_col;
+    int scroll_top;
+    int scroll_bottom;
+    StyleTable styles;  // styles referenced by cells and the pen
+    Style pen;          // attributes applied to printed text
+    uint32_t pen_style;
+    uint32_t erase_style; // pen background used by erases and scrolls
+    ScreenOpList ops;   // pending grid operations
+    uint32_t *text;     // decoded codepoints referenced by queued prints
+    size_t text_used;
+    size_t text_capacity;
+    ScreenDamage damage; // cells changed since the last drawn frame
+    FILE *trace;        // optional sink for the raw operation stream
+    struct Scrollback *history; // optional sink for rows leaving the top of the screen
+} Screen;
+
+// return the ring entry of a logical row
+static inline Line *screen_line(const Screen *screen, int row) {
+    int slot = screen->line_base + row;
+    if (slot >= screen->rows)
+        slot -= screen->rows;
+    return &screen->lines[slot];
+}
+
+// return cells of a logical row
+static inline Cell *screen_row(const Screen *screen, int row) {
+    return screen_line(screen, row)->cells;
+}
+
+// return the pool row holding a logical row
+static inline int screen_pool_row(const Screen *screen, int row) {
+    return (int)((screen_row(screen, row) - screen->cells) / screen->stride);
+}
+
+// allocate a blank screen with full screen margins
+int screen_init(Screen *screen, int cols, int rows);
+// resize in place when the pool has room and nothing needs rewrapping
+// otherwise rewrap soft wrapped lines to the new width into the back pool
+// rows that no longer fit leave from the top into history while the cursor line stays
+int screen_resize(Screen *screen, int cols, int rows);
+// release row storage and queued operations
+void screen_free(Screen *screen);
+// coalesce queued operations and apply them to the grid and damage
+void screen_flush(Screen *screen);
+// write printable run at the cursor wrapping once per filled line
+// text must stay valid until the next screen_flush
+void screen_print_run(Screen *screen, const uint8_t *data, size_t len);
+// decode utf-8 text at the cursor and return bytes consumed
+// stops before controls and where plain ascii resumes
+size_t screen_print_utf8(Screen *screen, Utf8Decoder *decoder, const uint8_t *data, size_t len);
+// execute a c0 control function
+void screen_execute(Screen *screen, uint8_t byte);
+// move cursor down one line scrolling at the bottom margin
+void screen_line_feed(Screen *screen);
+// move cursor down scrolling only inside the margins
+void screen_index(Screen *screen);
+// move cursor up scrolling only inside the margins
+void screen_reverse_index(Screen *screen);
+// move cursor to a clamped absolute position
+void screen_move_to(Screen *screen, int row, int col);
+// erase part or all of the display around the cursor, mode 3 clears history
+void screen_erase_display(Screen *screen, int mode);
+// erase part or all of the cursor line
+void screen_erase_line(Screen *screen, int mode);
+// insert or delete lines at the cursor inside the margins
+void screen_insert_lines(Screen *screen, int count);
+void screen_delete_lines(Screen *screen, int count);
+// scroll the margin region by count lines
+// rows scrolled up from the top row go to history
+void screen_scroll_up(Screen *screen, int count);
+void screen_scroll_down(Screen *screen, int count);
+// select attributes for printed text and the erase background
+void screen_set_pen(Screen *screen, const Style *pen);
+// set scroll margins and home the cursor into them
+void screen_set_region(Screen *screen, int top, int bottom);
+
+#endif // SCREEN_H
@@ -0,0 +1,66 @@
+#ifndef SCREEN_DAMAGE_H
+#define SCREEN_DAMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// rows and column spans changed since the renderer last cleared them
+// a scroll hint tells the renderer it may shift the previous frame
+// by scroll_lines inside [scroll_top, scroll_bottom] before redrawing
+// dirty rows, which are already expressed in post scroll positions
+typedef struct ScreenDamage {
+    uint64_t *row_bits;     // one bit per logical row
+    uint16_t *span_start;   // first dirty column of each dirty row
+    uint16_t *span_end;     // one past the last dirty column
+    int cols;
+    int rows;
+    int capacity;           // rows the storage holds
+    int scroll_top;
+    int scroll_bottom;
+    int scroll_lines;       // rows scrolled up, negative for down
+    int cursor_row;         // cursor cell as of the last clear
+    int cursor_col;
+    bool all;               // every cell must be redrawn
+} ScreenDamage;
+
+// allocate damage state for a grid with everything dirty
+int screen_damage_init(ScreenDamage *damage, int cols, int rows);
+// change the grid size with everything dirty, storage grows to hold capacity rows
+int screen_damage_resize(ScreenDamage *damage, int cols, int rows, int capacity);
+// release damage storage
+void screen_damage_free(ScreenDamage *damage);
+// mark columns [start, end) of a row dirty
+void screen_damage_mark(ScreenDamage *damage, int row, int start, int end);
+// mark whole rows [first, first + count) dirty
+void screen_damage_mark_rows(ScreenDamage *damage, int first, int count);
+// mark the whole grid dirty and drop the scroll hint
+void screen_damage_mark_all(ScreenDamage *damage);
+// shift damage of rows [top, bottom] by lines (positive up) and record the hint
+void screen_damage_scroll(ScreenDamage *damage, int top, int bottom, int lines);
+// mark the old and new cursor cells when the cursor moved
+void screen_damage_cursor(ScreenDamage *damage, int row, int col);
+// forget all damage once a frame has been drawn
+void screen_damage_clear(ScreenDamage *damage);
+// return true when anything needs to be redrawn
+bool screen_damage_any(const ScreenDamage *damage);
+// return the first dirty row at or after row or -1
+int screen_damage_next_row(const ScreenDamage *damage, int row);
+
+// return true when a row has any dirty columns
+static inline bool screen_damage_row_dirty(const ScreenDamage *damage, int row) {
+    return damage->all || (damage->row_bits[row >> 6] >> (row & 63) & 1u);
+}
+
+// return the dirty column span of a dirty row
+static inline void screen_damage_span(const ScreenDamage *damage, int row, int *start, int *end) {
+    if (damage->all) {
+        *start = 0;
+        *end = damage->cols;
+    } else {
+        *start = damage->span_start[row];
+        *end = damage->span_end[row];
+    }
+}
+
+#endif // SCREEN_DAMAGE_H
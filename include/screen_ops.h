@@ -0,0 +1,56 @@
+#ifndef SCREEN_OPS_H
+#define SCREEN_OPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// grid operations emitted by the parser before they reach the grid
+typedef enum {
+    SCREEN_OP_PRINT,         // write text at row col
+    SCREEN_OP_PRINT_CODEPOINTS, // write decoded codepoints at row col
+    SCREEN_OP_ERASE,         // blank columns [col, end) of row
+    SCREEN_OP_ERASE_ROWS,    // blank whole rows [row, end)
+    SCREEN_OP_SCROLL_UP,     // shift rows [row, end] up by count
+    SCREEN_OP_SCROLL_DOWN,   // shift rows [row, end] down by count
+    SCREEN_OP_MOVE,          // cursor moved to row col
+    SCREEN_OP_SET_REGION     // scroll margins set to [row, end]
+} screen_op_type_t;
+
+// print flag marking text that fills its row and wraps onto the next one
+#define SCREEN_OP_WRAPS 0x01
+// scroll flag for rows leaving the top of the screen into history
+#define SCREEN_OP_KEEPS 0x02
+
+// compact operation with absolute coordinates
+typedef struct ScreenOp {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t row;
+    uint16_t col;
+    uint16_t end;
+    uint32_t count;          // text length or scroll lines
+    uint32_t style;          // style written by prints or left by erases and scrolls
+    union {
+        const uint8_t *text;            // borrowed from the parser input
+        const uint32_t *codepoints;     // borrowed from the screen text pool
+    };
+} ScreenOp;
+
+// growable batch of operations
+typedef struct ScreenOpList {
+    ScreenOp *ops;
+    size_t count;
+    size_t capacity;
+} ScreenOpList;
+
+// release operation storage
+void screen_ops_free(ScreenOpList *list);
+// append an operation and return -1 when out of memory
+int screen_ops_push(ScreenOpList *list, ScreenOp op);
+// merge scrolls, drop overwritten writes and fold cursor moves in place
+void screen_ops_coalesce(ScreenOpList *list);
+// write operations as one line of text each
+void screen_ops_trace(FILE *out, const ScreenOp *ops, size_t count);
+
+#endif // SCREEN_OPS_H
@@ -0,0 +1,159 @@
+#ifndef SCROLLBACK_H
+#define SCROLLBACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <screen.h>
+#include <scrollback_cold.h>
+#include <style.h>
+
+// bytes of one history page, rows are packed into pages of this size
+#define SCROLLBACK_PAGE_SIZE (64 * 1024)
+// bytes a page may take once packed for deflate, a cell is at most fifteen
+#define SCROLLBACK_PACKED_SIZE (2 * SCROLLBACK_PAGE_SIZE)
+// cells and slots one page holds after its header
+#define SCROLLBACK_PAGE_CELLS ((SCROLLBACK_PAGE_SIZE - sizeof(ScrollbackPage)) / sizeof(Cell))
+// pages cold blocks are inflated into for readers
+#define SCROLLBACK_CACHE_PAGES 8
+
+// fixed size block of packed rows
+// cells fill it from the front and row slots from the back
+struct ScrollbackPage {
+    struct ScrollbackPage *next;   // free list link while pooled
+    uint32_t count;                // rows stored
+    uint32_t used;                 // cells stored
+    Cell data[];
+};
+
+// where a row lives in its page, as wide as one cell
+typedef struct ScrollbackSlot {
+    uint32_t start;
+    uint16_t length;
+    uint16_t wrapped;
+} ScrollbackSlot;
+
+// references a compressed block holds for one style
+typedef struct ScrollbackStyleCount {
+    uint32_t style;
+    uint32_t count;
+} ScrollbackStyleCount;
+
+// one page worth of rows in whichever tier it has reached
+// hot rows sit in a page, cold ones are deflated in memory or in the spill file
+typedef struct ScrollbackBlock {
+    ScrollbackPage *page;   // rows while hot, while compressing or when compression failed
+    ScrollbackJob *job;     // compression in flight
+    uint8_t *data;          // deflated rows held in memory
+    size_t size;            // deflated bytes in memory or in the spill file
+    int64_t spill;          // offset in the spill file or -1
+    uint64_t first;         // history number of its first row
+    uint32_t count;         // rows it holds
+    bool continued;         // first row carries on the line of the block before
+    uint32_t *spans;        // lengths of the lines starting in it once a width aware read measured them
+    uint32_t span_count;
+    uint32_t fold_width;    // width fold_rows was counted at, 0 once a push or eviction changes its lines
+    uint32_t fold_rows;     // rows the lines starting in it take at fold_width
+    bool settled;           // references are held by styles instead of by each row
+    ScrollbackStyleCount *styles;
+    size_t style_count;
+} ScrollbackBlock;
+
+// page a cold block was last inflated into
+typedef struct ScrollbackCache {
+    ScrollbackPage *page;
+    uint64_t first;         // block it holds or UINT64_MAX
+    uint64_t read;          // read that last used it
+} ScrollbackCache;
+
+// one history row as handed to readers
+// cells past length are default blanks and stay valid until the next push or read
+typedef struct ScrollbackLine {
+    const Cell *cells;
+    size_t length;
+    bool wrapped;       // text continues on the next row
+} ScrollbackLine;
+
+// rows scrolled off the top of the screen, oldest first
+// blocks are recycled once the line or byte cap is reached
+// rows keep the width they had when they left the screen, soft wrapped ones whole so lines can be joined again
+// width aware reads lay the joined lines out again, blocks they measured keep their line lengths
+// and how many rows those took at the last width so another width needs no inflating
+// with the cold tier started blocks past the newest few are deflated on a thread
+// and past the byte cap the oldest deflated ones move to an unlinked file
+// rows evicted from a deflated block keep their style references until the whole block goes
+typedef struct Scrollback {
+    ScrollbackBlock *blocks;    // ring of blocks, spilled then cold then compressing then hot
+    size_t block_head;
+    size_t block_count;
+    size_t block_capacity;
+    ScrollbackPage *free_pages; // recycled pages waiting for reuse
+    size_t free_count;
+    size_t page_count;          // pages held by blocks
+    size_t head_row;            // rows of the oldest block already evicted
+    size_t lines;               // rows retained
+    uint64_t dropped;           // rows evicted since init, numbers the oldest row
+    size_t max_lines;
+    size_t max_bytes;
+    StyleTable *styles;         // table the stored style ids reference
+    bool line_open;             // newest row is soft wrapped and its line carries on
+    uint64_t line_first;        // history number of the first row of the newest line
+    Cell *view;                 // rows laid out by the last width aware read
+    size_t view_capacity;
+    size_t span_bytes;          // line lengths kept by blocks for width aware reads
+    // cold tier, off until scrollback_start_cold
+    ScrollbackWorker worker;
+    ScrollbackSpill spill;
+    size_t hot_pages;           // newest blocks left uncompressed
+    size_t hot;                 // blocks at the end of the ring in pages
+    size_t compressing;         // blocks before them waiting on the thread
+    size_t spilled;             // blocks at the start of the ring in the spill file
+    size_t cold_bytes;          // deflated bytes held in memory
+    size_t finished_seen;       // jobs the thread had finished at the last collect
+    ScrollbackCache cache[SCROLLBACK_CACHE_PAGES];
+    uint64_t reads;
+    uint8_t *scratch;           // inflate buffer
+    uint32_t *tally;            // references per style while settling a block
+    bool cold;
+} Scrollback;
+
+// return slot index of a page, slots grow down from the end
+static inline ScrollbackSlot *scrollback_slot(const ScrollbackPage *page, size_t index) {
+    return (ScrollbackSlot *)(page->data + SCROLLBACK_PAGE_CELLS) - 1 - index;
+}
+
+// set up an empty history holding at most max_lines rows in max_bytes of memory
+// stored cells keep references in styles
+int scrollback_init(Scrollback *history, StyleTable *styles, size_t max_lines, size_t max_bytes);
+// compress all but the newest hot_bytes of pages on a background thread
+// and with spill set move deflated blocks past the byte cap to a temp file instead of dropping them
+// history keeps working from memory alone when either part fails to start
+int scrollback_start_cold(Scrollback *history, size_t hot_bytes, bool spill);
+// stop the thread and release every page
+void scrollback_free(Scrollback *history);
+// append a row of length cells, rows that end a line should have trailing default blanks trimmed
+// a row equal to the one before shares its cells
+// evicts the oldest rows when a cap is reached and never allocates per row
+int scrollback_push(Scrollback *history, const Cell *cells, size_t length, bool wrapped);
+// drop every row and keep the pages pooled
+void scrollback_clear(Scrollback *history);
+// fill out with up to count rows starting at row first counted from the oldest
+// cold rows are inflated on the way, a read stops early once it spans more blocks than the cache holds
+// returns the rows read
+size_t scrollback_read(Scrollback *history, size_t first, size_t count, ScrollbackLine *out);
+// fill out with up to count rows of history laid out at width, the last one back rows above the newest
+// only the blocks down to the viewport are measured, and each only once until its lines change
+// rows are copied so they stay valid until the next push or read, returns the rows filled, fewer at the top
+size_t scrollback_read_width(Scrollback *history, size_t width, size_t back, size_t count, ScrollbackLine *out);
+// return bytes held in memory by pages, deflated blocks, the block ring and what reads keep
+size_t scrollback_memory(const Scrollback *history);
+// return bytes of deflated blocks in the spill file
+size_t scrollback_spilled(const Scrollback *history);
+
+// return rows retained
+static inline size_t scrollback_lines(const Scrollback *history) {
+    return history ? history->lines : 0;
+}
+
+#endif // SCROLLBACK_H
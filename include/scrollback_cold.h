@@ -0,0 +1,79 @@
+#ifndef SCROLLBACK_COLD_H
+#define SCROLLBACK_COLD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <screen.h>
+
+typedef struct ScrollbackPage ScrollbackPage;
+
+// one page handed to the compression thread
+// the page is only read until done is set and stays owned by the caller
+typedef struct ScrollbackJob {
+    struct ScrollbackJob *next;
+    const ScrollbackPage *page;
+    uint8_t *data;          // deflated rows, NULL when compression failed
+    size_t size;
+    bool done;
+} ScrollbackJob;
+
+// background thread compressing pages in the order they were submitted
+typedef struct ScrollbackWorker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    ScrollbackJob *head;    // jobs not started yet
+    ScrollbackJob *tail;
+    ScrollbackJob *active;  // job being compressed
+    atomic_size_t finished; // jobs completed so far, polled without the lock
+    bool stop;
+    bool running;
+} ScrollbackWorker;
+
+// unlinked temp file holding compressed blocks past the memory threshold
+// blocks are evicted oldest first so live bytes are always [start, end)
+typedef struct ScrollbackSpill {
+    int fd;
+    size_t start;
+    size_t end;
+} ScrollbackSpill;
+
+// start the compression thread
+int scrollback_worker_start(ScrollbackWorker *worker);
+// join the thread, jobs still queued are left unfinished
+void scrollback_worker_stop(ScrollbackWorker *worker);
+// queue a page for compression
+void scrollback_worker_submit(ScrollbackWorker *worker, ScrollbackJob *job);
+// take a job back, waiting only when the thread is already compressing it
+void scrollback_worker_cancel(ScrollbackWorker *worker, ScrollbackJob *job);
+// return true once a job finished, the lock hands its output over
+bool scrollback_worker_done(ScrollbackWorker *worker, ScrollbackJob *job);
+// block until a job finished
+void scrollback_worker_wait(ScrollbackWorker *worker, ScrollbackJob *job);
+
+// rebuild the rows of a deflated page into page
+// scratch must hold SCROLLBACK_PACKED_SIZE bytes
+int scrollback_decode(const uint8_t *data, size_t size, ScrollbackPage *page, uint8_t *scratch);
+
+// create the spill file in TMPDIR or /tmp and unlink it straight away
+int scrollback_spill_open(ScrollbackSpill *spill);
+// close the file
+void scrollback_spill_close(ScrollbackSpill *spill);
+// append size bytes and return their offset or -1
+int64_t scrollback_spill_write(ScrollbackSpill *spill, const uint8_t *data, size_t size);
+// forget the oldest live bytes up to end, the file empties once none are left
+void scrollback_spill_release(ScrollbackSpill *spill, size_t end);
+// move live bytes to the front once dead bytes outweigh them and return how far they moved
+size_t scrollback_spill_compact(ScrollbackSpill *spill);
+// map size bytes at offset, *base and *length are handed to scrollback_spill_unmap
+// returns NULL with *base NULL when the mapping fails so there is nothing to unmap
+const uint8_t *scrollback_spill_map(const ScrollbackSpill *spill, int64_t offset, size_t size, void **base,
+                                    size_t *length);
+void scrollback_spill_unmap(void *base, size_t length);
+
+#endif // SCROLLBACK_COLD_H
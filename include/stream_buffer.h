@@ -0,0 +1,64 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <glad/glad.h>
+
+// ring size used when none is given
+#define STREAM_BUFFER_DEFAULT_SIZE ((size_t)4 << 20)
+// alignment of every upload so any attribute type can start there
+#define STREAM_BUFFER_ALIGN 64
+// fences kept in flight before the newest is replaced
+#define STREAM_BUFFER_MAX_FENCES 16
+
+// gpu progress through the ring, end is a position in bytes handed out
+typedef struct StreamFence {
+    GLsync sync;
+    size_t end;
+} StreamFence;
+
+// counters reported for diagnostics
+typedef struct StreamBufferStats {
+    uint64_t bytes_uploaded;
+    uint64_t uploads;
+    uint64_t fence_waits;  // uploads that stalled on a fence not yet signaled
+    uint64_t orphans;      // storage dropped at a wrap instead of waiting
+    uint64_t grows;
+} StreamBufferStats;
+
+// ring of gpu memory sub-allocated by uploads and read by draws queued right after
+// with buffer storage the ring stays mapped and fences keep writes off data in flight
+// otherwise ranges are written unsynchronized and the storage is orphaned on wrap
+typedef struct StreamBuffer {
+    GLuint buffer;
+    GLenum target;
+    uint8_t *mapped;       // persistent mapping, NULL when orphaning
+    size_t size;
+    size_t head;           // bytes handed out since the storage was made
+    size_t fenced;         // head when the newest fence was queued
+    size_t retired;        // bytes the gpu is known to be done with
+    StreamFence fences[STREAM_BUFFER_MAX_FENCES];
+    size_t fence_first;
+    size_t fence_count;
+    StreamBufferStats stats;
+} StreamBuffer;
+
+// create a ring of at least size bytes for target
+int stream_buffer_init(StreamBuffer *stream, GLenum target, size_t size);
+// release the storage and pending fences
+void stream_buffer_free(StreamBuffer *stream);
+// copy bytes into the ring leaving the buffer bound and return their offset
+int stream_buffer_upload(StreamBuffer *stream, const void *data, size_t bytes, size_t *offset);
+// return bytes of the persistent mapping to fill before the next fence, NULL when not mapped
+void *stream_buffer_reserve(StreamBuffer *stream, size_t bytes, size_t *offset);
+// fence uploads once every draw reading them has been queued
+void stream_buffer_fence(StreamBuffer *stream);
+// return true when the ring is persistently mapped
+static inline bool stream_buffer_persistent(const StreamBuffer *stream) {
+    return stream->mapped != NULL;
+}
+
+#endif // STREAM_BUFFER_H
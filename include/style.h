@@ -0,0 +1,91 @@
+#ifndef STYLE_H
+#define STYLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// packed colors keep their kind in the top byte
+#define STYLE_COLOR_DEFAULT 0u
+#define STYLE_COLOR_INDEXED 1u
+#define STYLE_COLOR_RGB 2u
+#define STYLE_COLOR(kind, value) (((uint32_t)(kind) << 24) | ((uint32_t)(value) & 0xFFFFFFu))
+#define STYLE_COLOR_KIND(color) ((color) >> 24)
+#define STYLE_COLOR_VALUE(color) ((color) & 0xFFFFFFu)
+
+// attribute bits selected by sgr
+#define STYLE_BOLD 0x01u
+#define STYLE_DIM 0x02u
+#define STYLE_ITALIC 0x04u
+#define STYLE_UNDERLINE 0x08u
+#define STYLE_INVERSE 0x10u
+#define STYLE_DOUBLE_UNDERLINE 0x20u
+#define STYLE_UNDERCURL 0x40u
+#define STYLE_STRIKE 0x80u
+// underline kinds replace each other
+#define STYLE_UNDERLINE_MASK (STYLE_UNDERLINE | STYLE_DOUBLE_UNDERLINE | STYLE_UNDERCURL)
+
+// id 0 is the default style and is never reference counted
+#define STYLE_DEFAULT_ID 0u
+// ids are handed out up to this bound and then fall back to the default
+#define STYLE_MAX_IDS 65536u
+
+// colors and attributes shared by every cell with the same id
+typedef struct Style {
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t attrs;
+} Style;
+
+// interned styles counted by the cells and pens that use them
+// ids whose count drops to zero are only recycled by style_table_collect
+// so queued operations may keep referring to them until they are applied
+typedef struct StyleTable {
+    Style *styles;          // indexed by id
+    uint32_t *refs;
+    uint8_t *queued;        // id is waiting in pending
+    uint32_t *slots;        // open addressing hash holding id + 1, zero is empty
+    uint32_t *free_ids;
+    uint32_t *pending;      // ids that reached zero since the last collect
+    size_t count;           // ids handed out so far
+    size_t capacity;
+    size_t slot_mask;
+    size_t free_count;
+    size_t pending_count;
+} StyleTable;
+
+// allocate a table holding only the default style
+int style_table_init(StyleTable *table);
+// release table storage
+void style_table_free(StyleTable *table);
+// return the id of an equal style, adding it when missing
+// new ids start unreferenced and fall back to the default when full
+uint32_t style_table_intern(StyleTable *table, const Style *style);
+// recycle ids that are still unreferenced
+void style_table_collect(StyleTable *table);
+// queue an id whose last reference was dropped
+void style_table_retire(StyleTable *table, uint32_t id);
+
+// return true when two styles render identically
+static inline bool style_equal(const Style *a, const Style *b) {
+    return a->fg == b->fg && a->bg == b->bg && a->attrs == b->attrs;
+}
+
+// look up the style stored for an id
+static inline const Style *style_table_get(const StyleTable *table, uint32_t id) {
+    return &table->styles[id];
+}
+
+// add count references to an id
+static inline void style_table_acquire(StyleTable *table, uint32_t id, uint32_t count) {
+    if (id != STYLE_DEFAULT_ID)
+        table->refs[id] += count;
+}
+
+// drop count references from an id
+static inline void style_table_release(StyleTable *table, uint32_t id, uint32_t count) {
+    if (id != STYLE_DEFAULT_ID && (table->refs[id] -= count) == 0)
+        style_table_retire(table, id);
+}
+
+#endif // STYLE_H
@@ -1,54 +1,64 @@
-#ifndef TEXT_H
-#define TEXT_H
-
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-#include <cglm/cglm.h>
-
-// describe glyph metrics used for rendering
-struct Character {
-	unsigned int TextureID;  // glyph texture id
-	ivec2 Size;       // glyph size in pixels
-	ivec2 Bearing;    // offset from baseline to top left
-	unsigned int Advance;    // advance to next glyph
-};
-
-extern int glyph_width;
-extern int glyph_height;
-extern int ascent;
-
-extern struct Character Characters[128];
-
-extern int x_resolution;
-extern int y_resolution;
-
-extern float x_spacing;
-extern float y_spacing;
-extern float margin_x;   // pixel margin on x axis
-extern float margin_y;   // pixel margin on y axis
-
-extern int grid_x_size;
-extern int grid_y_size;
-
-// allocate a fresh grid filled with spaces
-int *text_setup_grid(void);
-// set base scaling used when resizing
-void text_set_base_scale(float scale);
-// resize grid keeping existing characters
-int *text_resize_grid(int *grid, int new_width, int new_height, float *text_scale, int *cursor_row, int *cursor_col, int *scroll_top, int *scroll_bottom);
-
-// compile shader from source string
-GLuint compile_shader(const char *source, GLenum type);
-// create shader program from vertex and fragment sources
-GLuint create_shader_program(const char *vertex_src, const char *fragment_src);
-// load shader text from file
-char *load_shader_source(const char *filepath);
-// draw a single character quad
-void text_render_char(GLuint shaderProgram, char character, float x, float y, float scale, vec3 color);
-// upload glyph textures and metrics
-int text_setup_characters(void);
-// render cursor block with inverted colors
-void text_render_cursor(GLuint shaderProgram, float text_scale, int row, int col, vec3 fg, vec3 bg, char c);
-
-#endif
-
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <stdbool.h>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cglm/cglm.h>
+
+#include <glyph_cache.h>
+
+extern int glyph_width;
+extern int glyph_height;
+extern int ascent;
+
+// glyphs rasterized on demand from the terminal font
+extern GlyphCache glyph_cache;
+// pixel size of the glyph bucket being drawn
+extern uint32_t glyph_pixel_size;
+
+extern int x_resolution;
+extern int y_resolution;
+
+extern float x_spacing;
+extern float y_spacing;
+extern float margin_x;   // pixel margin on x axis
+extern float margin_y;   // pixel margin on y axis
+
+extern int grid_x_size;
+extern int grid_y_size;
+
+// derive whole pixel cell spacing from the glyph metrics at scale
+void text_set_spacing(float scale);
+// compute grid dimensions from current metrics
+void text_setup_grid(void);
+// set base scaling used when resizing
+void text_set_base_scale(float scale);
+// rescale metrics and grid dimensions for a new framebuffer size
+bool text_resize_grid(int new_width, int new_height, float *text_scale);
+
+// compile shader from source string
+GLuint compile_shader(const char *source, GLenum type);
+// create shader program from vertex and fragment sources
+GLuint create_shader_program(const char *vertex_src, const char *fragment_src);
+// load shader text from file
+char *load_shader_source(const char *filepath);
+// open the font and derive cell metrics, glyphs are rasterized on first use
+// wake is called from the background rasterizer when a new size is ready
+int text_setup_characters(void (*wake)(void));
+// release the glyph cache and font
+void text_free_characters(void);
+// pack background glyphs and switch sizes once ready, true when a redraw is needed
+bool text_poll_glyphs(void);
+// return the factor scaling glyphs of the current bucket to the cell size
+float text_glyph_scale(float text_scale);
+// return the cached glyph for a codepoint drawn with style attribute bits
+const Glyph *text_lookup_glyph(uint32_t codepoint, uint32_t style);
+// return the procedural glyph filling a whole cell or NULL when the font draws codepoint
+const Glyph *text_lookup_cell_glyph(uint32_t codepoint);
+// find the cached glyph a cell would draw without rasterizing or touching it
+// return its entry id or GLYPH_ENTRY_NONE, cell tells whether it fills the cell
+uint32_t text_find_glyph(uint32_t codepoint, uint32_t style, bool *cell);
+
+#endif
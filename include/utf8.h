@@ -0,0 +1,44 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define UTF8_REPLACEMENT 0xFFFD
+// bytes classified and validated together by the block fast path
+#define UTF8_BLOCK 32
+
+// per byte bit masks of one block, bit k describes data[k]
+typedef struct Utf8Masks {
+    uint64_t high;       // >= 0x80
+    uint64_t cont;       // 0x80..0xbf
+    uint64_t lead3;      // >= 0xe0
+    uint64_t lead4;      // >= 0xf0
+    uint64_t control;    // c0 controls and delete end the text
+    uint64_t special;    // leads whose second byte needs range checks
+} Utf8Masks;
+
+// partial sequence carried from one read to the next
+typedef struct Utf8Decoder {
+    uint32_t codepoint;   // bits gathered so far
+    uint32_t min;         // smallest value the sequence may encode
+    uint8_t needed;       // continuation bytes still expected
+} Utf8Decoder;
+
+// reset decoder to expect a new sequence
+void utf8_decoder_init(Utf8Decoder *decoder);
+// decode printable text into codepoints and return bytes consumed
+// stops before control bytes, at all ascii blocks and when out is full
+// invalid input becomes U+FFFD and an unfinished tail stays in decoder
+size_t utf8_decode_text(Utf8Decoder *decoder, const uint8_t *data, size_t len, uint32_t *out, size_t out_cap,
+                        size_t *out_len);
+// encode one codepoint and return its length in bytes
+size_t utf8_encode(uint32_t codepoint, char out[4]);
+
+// return true while a sequence is split across reads
+static inline bool utf8_decoder_pending(const Utf8Decoder *decoder) {
+    return decoder->needed != 0;
+}
+
+#endif // UTF8_H
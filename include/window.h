@@ -1,10 +1,10 @@
-#ifndef WINDOW_H
-#define WINDOW_H 
-
-#include <GLFW/glfw3.h>
-
-// create window and initialize glfw state
-GLFWwindow* window_initialize(void); 
-
-#endif // WINDOW_H 
-
+#ifndef WINDOW_H
+#define WINDOW_H 
+
+#include <GLFW/glfw3.h>
+
+// create window and initialize glfw state
+GLFWwindow* window_initialize(void); 
+
+#endif // WINDOW_H 
+
@@ -0,0 +1,43 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// most threads a pool runs besides the caller
+#define WORK_POOL_MAX_THREADS 15
+
+// run item index of a batch
+typedef void (*work_pool_fn)(void *ctx, size_t index);
+
+// fixed set of threads working through batches of independent items
+// the caller takes items too and returns once the whole batch is done
+typedef struct WorkPool {
+    pthread_t threads[WORK_POOL_MAX_THREADS];
+    size_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    work_pool_fn fn;
+    void *ctx;
+    size_t count;
+    atomic_size_t next;    // first item not taken yet
+    size_t busy;           // threads still inside the current batch
+    uint64_t generation;   // batches started so far
+    bool stop;
+    bool running;
+} WorkPool;
+
+// start threads workers, zero leaves every batch to the caller
+int work_pool_start(WorkPool *pool, size_t threads);
+// call fn for every index below count and wait for all of them
+void work_pool_run(WorkPool *pool, size_t count, work_pool_fn fn, void *ctx);
+// stop and join the workers
+void work_pool_stop(WorkPool *pool);
+// return the threads worth running besides the caller on this machine
+size_t work_pool_default_threads(void);
+
+#endif // WORK_POOL_H
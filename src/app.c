@@ -1,198 +1,435 @@
-#include <app.h>
-
-#include <stdbool.h>
-#include <stdint.h>
-#include <stdlib.h>
-#include <stdio.h>
-#include <unistd.h>
-
-#include <glad/glad.h>
-#include <GLFW/glfw3.h>
-#include <cglm/cglm.h>
-
-#include <pty_wrap.h>
-#include <shader.h>
-#include <terminal.h>
-#include <text.h>
-#include <window.h>
-
-typedef struct AppState {
-    int master_fd;
-    int child_pid;
-    GLuint shader_program;
-    TerminalState terminal;
-    vec3 fg_color;
-    vec3 bg_color;
-} AppState;
-
-static void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-static void char_callback(GLFWwindow *window, unsigned int codepoint);
-static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
-static void app_cleanup(AppState *app, GLFWwindow *window);
-
-int app_run(void) {
-    // initialize application state
-    AppState app = {
-        .master_fd = -1,
-        .child_pid = -1,
-        .shader_program = 0,
-        .terminal = {0},
-        .fg_color = {0.9f, 0.9f, 1.0f},
-        .bg_color = {0.02f, 0.02f, 0.1f},
-    };
-
-    // create window and rendering context
-    GLFWwindow *window = window_initialize();
-    if (!window) {
-        return -1;
-    }
-
-    // route glfw callbacks through application state
-    glfwSetWindowUserPointer(window, &app);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCharCallback(window, char_callback);
-    glfwSetKeyCallback(window, key_callback);
-
-    // load freetype glyph atlas
-    if (text_setup_characters() != 0) {
-        app_cleanup(&app, window);
-        return -1;
-    }
-
-    // prepare shader program for text rendering
-    app.shader_program = initialize_shader();
-    if (app.shader_program == 0) {
-        app_cleanup(&app, window);
-        return -1;
-    }
-
-    // allocate grid space and parser state
-    const float initial_scale = 0.35f;
-    if (terminal_init(&app.terminal, initial_scale) != 0) {
-        app_cleanup(&app, window);
-        return -1;
-    }
-
-    // launch terminal session with pty
-    if (pty_spawn(NULL, &app.master_fd, &app.child_pid) < 0) {
-        perror("pty_spawn failed");
-        app_cleanup(&app, window);
-        return -1;
-    }
-
-    // notify child process of visible grid size
-    pty_set_winsize(app.master_fd, grid_y_size, grid_x_size);
-
-    double initial_time = glfwGetTime();
-    terminal_on_input_activity(&app.terminal, initial_time);
-
-    // get input and draw frames until window closes
-    while (!glfwWindowShouldClose(window)) {
-        uint8_t buf[4096];
-        ssize_t n = pty_read(app.master_fd, buf, sizeof(buf));
-        if (n > 0) {
-            double input_now = glfwGetTime();
-            terminal_on_input_activity(&app.terminal, input_now);
-            terminal_process_data(&app.terminal, buf, (size_t)n);
-        }
-
-        // clear framebuffer using background color
-        glClearColor(app.bg_color[0], app.bg_color[1], app.bg_color[2], 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // handle cursor blink timing and render grid
-        double now = glfwGetTime();
-        terminal_update_cursor(&app.terminal, now);
-        terminal_render(&app.terminal, app.shader_program, app.fg_color, app.bg_color);
-
-        glfwPollEvents();
-        glfwSwapBuffers(window);
-    }
-
-    app_cleanup(&app, window);
-    return 0;
-}
-
-static void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-    AppState *app = glfwGetWindowUserPointer(window);
-    if (!app || width <= 0 || height <= 0)
-        return;
-
-    // update viewport and projection to match new framebuffer size
-    glViewport(0, 0, width, height);
-    if (app->shader_program != 0)
-        shader_update_projection(app->shader_program, width, height);
-
-    if (terminal_resize(&app->terminal, width, height) && app->master_fd > 0) {
-        // resize terminal to hosted shell
-        pty_set_winsize(app->master_fd, grid_y_size, grid_x_size);
-    }
-}
-
-static void char_callback(GLFWwindow *window, unsigned int codepoint) {
-    AppState *app = glfwGetWindowUserPointer(window);
-    if (!app || app->master_fd < 0)
-        return;
-
-    // forward printable characters to shell
-    char c = (char)codepoint;
-    pty_write(app->master_fd, &c, 1);
-}
-
-static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
-    (void)scancode;
-    AppState *app = glfwGetWindowUserPointer(window);
-    if (!app || app->master_fd < 0)
-        return;
-
-    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-        switch (key) {
-        case GLFW_KEY_ENTER:
-            // send carriage return on enter
-            pty_write(app->master_fd, "\r", 1);
-            break;
-        case GLFW_KEY_BACKSPACE:
-            // send del for backspace key
-            pty_write(app->master_fd, "\x7F", 1);
-            break;
-        case GLFW_KEY_UP:
-            // forward arrow key escape sequences
-            pty_write(app->master_fd, "\x1b[A", 3);
-            break;
-        case GLFW_KEY_DOWN:
-            pty_write(app->master_fd, "\x1b[B", 3);
-            break;
-        case GLFW_KEY_RIGHT:
-            pty_write(app->master_fd, "\x1b[C", 3);
-            break;
-        case GLFW_KEY_LEFT:
-            pty_write(app->master_fd, "\x1b[D", 3);
-            break;
-        case GLFW_KEY_C:
-            if (mods & GLFW_MOD_CONTROL)
-                // send interrupt signal on ctrl c
-                pty_write(app->master_fd, "\x03", 1);
-            break;
-        default:
-            break;
-        }
-    }
-}
-
-static void app_cleanup(AppState *app, GLFWwindow *window) {
-    // close pty master descriptor
-    if (app->master_fd >= 0) {
-        close(app->master_fd);
-        app->master_fd = -1;
-    }
-
-    // release terminal resources
-    terminal_free(&app->terminal);
-
-    // destroy glfw window before terminating
-    if (window)
-        glfwDestroyWindow(window);
-
-    glfwTerminate();
-}
-
+#include <app.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cglm/cglm.h>
+
+#include <cell_kernel.h>
+#include <pty_wrap.h>
+#include <renderer.h>
+#include <shader.h>
+#include <terminal.h>
+#include <text.h>
+#include <utf8.h>
+#include <window.h>
+
+// default seconds per frame spent draining pty output
+#define PTY_READ_BUDGET 0.008
+// bytes buffered between the reader thread and the parser
+#define PTY_RING_CAPACITY (1024 * 1024)
+// largest span parsed before checking the frame budget again
+#define PTY_PARSE_CHUNK (64 * 1024)
+// seconds the grid size must hold still before the child is told about it
+#define PTY_WINSIZE_SETTLE 0.1
+
+// seconds between throughput reports
+#define READ_STATS_INTERVAL 1.0
+
+// count bytes consumed from the pty for throughput diagnostics
+// TERMITE_READ_STATS reports them on stderr once a second while output flows
+typedef struct ReadStats {
+    size_t frame_bytes;
+    size_t peak_frame_bytes;    // largest frame since the last report
+    uint64_t total_bytes;
+    uint64_t frames;
+    uint64_t report_bytes;      // bytes and frames since the last report
+    uint64_t report_frames;
+    double report_start;
+    bool report;
+} ReadStats;
+
+typedef struct AppState {
+    int master_fd;
+    int child_pid;
+    GLuint shader_program;
+    Renderer renderer;
+    TerminalState terminal;
+    vec3 fg_color;
+    vec3 bg_color;
+    double read_budget;
+    ReadStats read_stats;
+    PtyReader pty_reader;
+    int pending_width;      // framebuffer size of the last resize event
+    int pending_height;
+    int winsize_cols;       // grid size the child was last told about
+    int winsize_rows;
+    double winsize_deadline;
+    bool resize_pending;
+    bool winsize_pending;
+    bool pty_pending;
+    bool needs_redraw;
+} AppState;
+
+static void framebuffer_size_callback(GLFWwindow *window, int width, int height);
+static void window_refresh_callback(GLFWwindow *window);
+static void char_callback(GLFWwindow *window, unsigned int codepoint);
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+static void app_cleanup(AppState *app, GLFWwindow *window);
+static size_t app_drain_pty(AppState *app);
+static void app_report_reads(ReadStats *stats, size_t consumed, double now);
+static void app_apply_resize(AppState *app, double now);
+static double app_next_deadline(const AppState *app, double now);
+static void app_wake(void);
+static RendererBackend app_backend(int argc, char **argv);
+
+int app_run(int argc, char **argv) {
+    // initialize application state
+    AppState app = {
+        .master_fd = -1,
+        .child_pid = -1,
+        .shader_program = 0,
+        .fg_color = {0.9f, 0.9f, 1.0f},
+        .bg_color = {0.02f, 0.02f, 0.1f},
+        .read_budget = PTY_READ_BUDGET,
+        .resize_pending = false,
+        .winsize_pending = false,
+        .pty_pending = false,
+        .needs_redraw = true,
+    };
+
+    const char *read_stats = getenv("TERMITE_READ_STATS");
+    app.read_stats.report = read_stats && *read_stats && strcmp(read_stats, "0") != 0;
+
+    // TERMITE_READ_BUDGET sets the milliseconds per frame spent draining the pty
+    const char *read_budget = getenv("TERMITE_READ_BUDGET");
+    if (read_budget) {
+        char *end;
+        double ms = strtod(read_budget, &end);
+        if (end != read_budget && *end == '\0' && ms > 0.0 && ms <= 1000.0)
+            app.read_budget = ms / 1000.0;
+        else
+            fprintf(stderr, "read budget %s invalid, using %.0f ms\n", read_budget, PTY_READ_BUDGET * 1000.0);
+    }
+
+    // TERMITE_SIMD pins the grid kernels to one instruction set
+    const char *simd = getenv("TERMITE_SIMD");
+    if (cell_kernel_init(simd) != 0)
+        fprintf(stderr, "simd %s unavailable, using %s\n", simd, cell_kernels.name);
+
+    // create window and rendering context
+    GLFWwindow *window = window_initialize();
+    if (!window) {
+        return -1;
+    }
+
+    // route glfw callbacks through application state
+    glfwSetWindowUserPointer(window, &app);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwSetCharCallback(window, char_callback);
+    glfwSetKeyCallback(window, key_callback);
+
+    // open the font for the on demand glyph cache
+    if (text_setup_characters(app_wake) != 0) {
+        app_cleanup(&app, window);
+        return -1;
+    }
+
+    // prepare shader program for text rendering
+    app.shader_program = initialize_shader();
+    if (app.shader_program == 0) {
+        app_cleanup(&app, window);
+        return -1;
+    }
+
+    // create instanced grid renderer on top of the program
+    if (renderer_init(&app.renderer, app.shader_program) != 0) {
+        app_cleanup(&app, window);
+        return -1;
+    }
+
+    // switch backends on request and keep instancing when that fails
+    RendererBackend backend = app_backend(argc, argv);
+    if (backend != RENDERER_BACKEND_INSTANCED && renderer_set_backend(&app.renderer, backend) != 0)
+        fprintf(stderr, "renderer backend unavailable, using instanced\n");
+
+    // allocate grid space and parser state
+    const float initial_scale = 0.35f;
+    if (terminal_init(&app.terminal, initial_scale) != 0) {
+        app_cleanup(&app, window);
+        return -1;
+    }
+
+    // launch terminal session with pty
+    if (pty_spawn(NULL, &app.master_fd, &app.child_pid) < 0) {
+        perror("pty_spawn failed");
+        app_cleanup(&app, window);
+        return -1;
+    }
+
+    // notify child process of visible grid size
+    pty_set_winsize(app.master_fd, grid_y_size, grid_x_size);
+    app.winsize_cols = grid_x_size;
+    app.winsize_rows = grid_y_size;
+
+    // read child output on its own thread and wake the event loop
+    if (pty_reader_start(&app.pty_reader, app.master_fd, PTY_RING_CAPACITY, app_wake) != 0) {
+        perror("pty_reader_start failed");
+        app_cleanup(&app, window);
+        return -1;
+    }
+
+    double initial_time = glfwGetTime();
+    terminal_on_input_activity(&app.terminal, initial_time);
+
+    // sleep until input, pty output or a cursor blink needs a new frame
+    while (!glfwWindowShouldClose(window)) {
+        if (app.needs_redraw || app.pty_pending) {
+            glfwPollEvents();
+        } else {
+            double wait_now = glfwGetTime();
+            double timeout = app_next_deadline(&app, wait_now) - wait_now;
+            if (timeout > 0.0)
+                glfwWaitEventsTimeout(timeout);
+            else
+                glfwPollEvents();
+        }
+
+        // resize events since the last frame collapse into one resize
+        app_apply_resize(&app, glfwGetTime());
+
+        // consume child output until drained or the frame budget is spent
+        if (app_drain_pty(&app) > 0) {
+            double input_now = glfwGetTime();
+            terminal_on_input_activity(&app.terminal, input_now);
+        }
+
+        // glyphs rasterized in the background after a resize
+        if (text_poll_glyphs())
+            app.needs_redraw = true;
+
+        // output that changed no cells does not need a frame
+        const ScreenDamage *damage = terminal_damage(&app.terminal);
+        if (damage && screen_damage_any(damage))
+            app.needs_redraw = true;
+
+        // handle cursor blink timing
+        double now = glfwGetTime();
+        if (terminal_update_cursor(&app.terminal, now))
+            app.needs_redraw = true;
+
+        if (!app.needs_redraw)
+            continue;
+
+        // redraw damaged rows offscreen and present the retained frame
+        terminal_render(&app.terminal, &app.renderer, app.fg_color, app.bg_color);
+
+        glfwSwapBuffers(window);
+        terminal_clear_damage(&app.terminal);
+        app.needs_redraw = false;
+    }
+
+    app_cleanup(&app, window);
+    return 0;
+}
+
+static size_t app_drain_pty(AppState *app) {
+    size_t consumed = 0;
+    double deadline = glfwGetTime() + app->read_budget;
+    app->pty_pending = false;
+    pty_reader_begin_drain(&app->pty_reader);
+
+    for (;;) {
+        // parse ring spans in place without copying
+        const uint8_t *span;
+        size_t n = pty_reader_peek(&app->pty_reader, &span);
+        if (n == 0)
+            break;
+        if (n > PTY_PARSE_CHUNK)
+            n = PTY_PARSE_CHUNK;
+
+        terminal_process_data(&app->terminal, span, n);
+        pty_reader_consume(&app->pty_reader, n);
+        consumed += n;
+
+        // leave the rest for the next frame without blocking on events
+        if (glfwGetTime() >= deadline) {
+            app->pty_pending = true;
+            break;
+        }
+    }
+
+    // record per frame throughput counters
+    ReadStats *stats = &app->read_stats;
+    stats->frame_bytes = consumed;
+    if (consumed > stats->peak_frame_bytes)
+        stats->peak_frame_bytes = consumed;
+    stats->total_bytes += consumed;
+    stats->frames++;
+    if (stats->report)
+        app_report_reads(stats, consumed, glfwGetTime());
+    return consumed;
+}
+
+static void app_report_reads(ReadStats *stats, size_t consumed, double now) {
+    // idle frames neither open a report nor count towards one
+    if (consumed == 0 && stats->report_bytes == 0)
+        return;
+    if (stats->report_bytes == 0)
+        stats->report_start = now;
+    stats->report_bytes += consumed;
+    stats->report_frames++;
+
+    double elapsed = now - stats->report_start;
+    if (elapsed < READ_STATS_INTERVAL)
+        return;
+    fprintf(stderr, "pty %.1f MB/s, %llu bytes over %llu frames, peak %zu per frame, %llu total\n",
+            (double)stats->report_bytes / elapsed / 1e6, (unsigned long long)stats->report_bytes,
+            (unsigned long long)stats->report_frames, stats->peak_frame_bytes, (unsigned long long)stats->total_bytes);
+    stats->report_bytes = 0;
+    stats->report_frames = 0;
+    stats->peak_frame_bytes = 0;
+}
+
+static void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
+    AppState *app = glfwGetWindowUserPointer(window);
+    if (!app || width <= 0 || height <= 0)
+        return;
+
+    // a drag fires many events per frame so only the last size is kept
+    app->pending_width = width;
+    app->pending_height = height;
+    app->resize_pending = true;
+    app->needs_redraw = true;
+}
+
+static void app_apply_resize(AppState *app, double now) {
+    if (app->resize_pending) {
+        app->resize_pending = false;
+
+        // update viewport and projection to match new framebuffer size
+        glViewport(0, 0, app->pending_width, app->pending_height);
+        if (app->shader_program != 0)
+            shader_update_projection(app->shader_program, app->pending_width, app->pending_height);
+
+        // every grid change restarts the settle interval, a drag back to the told size cancels it
+        if (terminal_resize(&app->terminal, app->pending_width, app->pending_height)) {
+            app->winsize_pending = grid_x_size != app->winsize_cols || grid_y_size != app->winsize_rows;
+            app->winsize_deadline = now + PTY_WINSIZE_SETTLE;
+        }
+    }
+
+    // tell the hosted shell once so it repaints its prompt a single time
+    if (app->winsize_pending && now >= app->winsize_deadline && app->master_fd >= 0) {
+        pty_set_winsize(app->master_fd, grid_y_size, grid_x_size);
+        app->winsize_cols = grid_x_size;
+        app->winsize_rows = grid_y_size;
+        app->winsize_pending = false;
+    }
+}
+
+static double app_next_deadline(const AppState *app, double now) {
+    // wake for a pending winsize as well as the cursor blink
+    double deadline = terminal_next_cursor_deadline(&app->terminal, now);
+    if (app->winsize_pending && app->winsize_deadline < deadline)
+        deadline = app->winsize_deadline;
+    return deadline;
+}
+
+static void window_refresh_callback(GLFWwindow *window) {
+    AppState *app = glfwGetWindowUserPointer(window);
+    if (!app)
+        return;
+
+    // contents were damaged by the window system
+    app->needs_redraw = true;
+}
+
+static void app_wake(void) {
+    // unblock glfwWaitEventsTimeout from the reader thread
+    glfwPostEmptyEvent();
+}
+
+static RendererBackend app_backend(int argc, char **argv) {
+    // --renderer=NAME overrides TERMITE_RENDERER
+    const char *name = getenv("TERMITE_RENDERER");
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--renderer=", 11) == 0)
+            name = argv[i] + 11;
+    }
+
+    RendererBackend backend = RENDERER_BACKEND_INSTANCED;
+    if (name && renderer_backend_parse(name, &backend) != 0)
+        fprintf(stderr, "unknown renderer %s, using instanced\n", name);
+    return backend;
+}
+
+static void char_callback(GLFWwindow *window, unsigned int codepoint) {
+    AppState *app = glfwGetWindowUserPointer(window);
+    if (!app || app->master_fd < 0)
+        return;
+
+    // forward typed characters to shell as utf-8
+    char bytes[4];
+    pty_write(app->master_fd, bytes, utf8_encode(codepoint, bytes));
+}
+
+static void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    (void)scancode;
+    AppState *app = glfwGetWindowUserPointer(window);
+    if (!app || app->master_fd < 0)
+        return;
+
+    if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+        switch (key) {
+        case GLFW_KEY_ENTER:
+            // send carriage return on enter
+            pty_write(app->master_fd, "\r", 1);
+            break;
+        case GLFW_KEY_BACKSPACE:
+            // send del for backspace key
+            pty_write(app->master_fd, "\x7F", 1);
+            break;
+        case GLFW_KEY_UP:
+            // forward arrow key escape sequences
+            pty_write(app->master_fd, "\x1b[A", 3);
+            break;
+        case GLFW_KEY_DOWN:
+            pty_write(app->master_fd, "\x1b[B", 3);
+            break;
+        case GLFW_KEY_RIGHT:
+            pty_write(app->master_fd, "\x1b[C", 3);
+            break;
+        case GLFW_KEY_LEFT:
+            pty_write(app->master_fd, "\x1b[D", 3);
+            break;
+        case GLFW_KEY_C:
+            if (mods & GLFW_MOD_CONTROL)
+                // send interrupt signal on ctrl c
+                pty_write(app->master_fd, "\x03", 1);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static void app_cleanup(AppState *app, GLFWwindow *window) {
+    // stop reader before its descriptor is closed
+    pty_reader_stop(&app->pty_reader);
+
+    // close pty master descriptor
+    if (app->master_fd >= 0) {
+        close(app->master_fd);
+        app->master_fd = -1;
+    }
+
+    // release terminal and renderer resources
+    terminal_free(&app->terminal);
+    renderer_free(&app->renderer);
+    text_free_characters();
+
+    // destroy glfw window before terminating
+    if (window)
+        glfwDestroyWindow(window);
+
+    glfwTerminate();
+}
+
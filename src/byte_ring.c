@@ -0,0 +1,72 @@
+#include <byte_ring.h>
+
+#include <stdlib.h>
+
+int byte_ring_init(ByteRing *ring, size_t capacity) {
+    if (!ring || capacity == 0)
+        return -1;
+
+    // power of two capacity turns wrapping into a mask
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    ring->data = malloc(size);
+    if (!ring->data)
+        return -1;
+
+    ring->capacity = size;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+void byte_ring_free(ByteRing *ring) {
+    if (!ring)
+        return;
+    free(ring->data);
+    ring->data = NULL;
+    ring->capacity = 0;
+}
+
+size_t byte_ring_write_span(ByteRing *ring, uint8_t **out) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    // free space stops at the end of the buffer or at the consumer
+    size_t free_bytes = ring->capacity - (head - tail);
+    size_t offset = head & (ring->capacity - 1);
+    size_t until_end = ring->capacity - offset;
+
+    *out = ring->data + offset;
+    return free_bytes < until_end ? free_bytes : until_end;
+}
+
+void byte_ring_commit(ByteRing *ring, size_t n) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+}
+
+size_t byte_ring_read_span(ByteRing *ring, const uint8_t **out) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    // readable bytes stop at the end of the buffer or at the producer
+    size_t used = head - tail;
+    size_t offset = tail & (ring->capacity - 1);
+    size_t until_end = ring->capacity - offset;
+
+    *out = ring->data + offset;
+    return used < until_end ? used : until_end;
+}
+
+void byte_ring_consume(ByteRing *ring, size_t n) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+}
+
+size_t byte_ring_size(ByteRing *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
@@ -0,0 +1,326 @@
+#include <cell_glyph.h>
+
+#include <math.h>
+#include <string.h>
+
+// weight of one arm of a box drawing character
+enum { ARM_NONE, ARM_LIGHT, ARM_HEAVY, ARM_DOUBLE };
+
+// arms packed as left right up down with two bits each
+#define ARMS(l, r, u, d) ((l) | (r) << 2 | (u) << 4 | (d) << 6)
+#define ARM_LEFT(arms) ((arms) & 3)
+#define ARM_RIGHT(arms) (((arms) >> 2) & 3)
+#define ARM_UP(arms) (((arms) >> 4) & 3)
+#define ARM_DOWN(arms) (((arms) >> 6) & 3)
+
+#define N ARM_NONE
+#define L ARM_LIGHT
+#define H ARM_HEAVY
+#define D ARM_DOUBLE
+
+// arms of U+2500..U+257F, dashes arcs and diagonals are drawn separately
+static const uint8_t box_arms[128] = {
+    ARMS(L, L, N, N), ARMS(H, H, N, N), ARMS(N, N, L, L), ARMS(N, N, H, H), // 2500
+    0, 0, 0, 0, 0, 0, 0, 0,                                                 // 2504 dashes
+    ARMS(N, L, N, L), ARMS(N, H, N, L), ARMS(N, L, N, H), ARMS(N, H, N, H), // 250C
+    ARMS(L, N, N, L), ARMS(H, N, N, L), ARMS(L, N, N, H), ARMS(H, N, N, H), // 2510
+    ARMS(N, L, L, N), ARMS(N, H, L, N), ARMS(N, L, H, N), ARMS(N, H, H, N), // 2514
+    ARMS(L, N, L, N), ARMS(H, N, L, N), ARMS(L, N, H, N), ARMS(H, N, H, N), // 2518
+    ARMS(N, L, L, L), ARMS(N, H, L, L), ARMS(N, L, H, L), ARMS(N, L, L, H), // 251C
+    ARMS(N, L, H, H), ARMS(N, H, H, L), ARMS(N, H, L, H), ARMS(N, H, H, H), // 2520
+    ARMS(L, N, L, L), ARMS(H, N, L, L), ARMS(L, N, H, L), ARMS(L, N, L, H), // 2524
+    ARMS(L, N, H, H), ARMS(H, N, H, L), ARMS(H, N, L, H), ARMS(H, N, H, H), // 2528
+    ARMS(L, L, N, L), ARMS(H, L, N, L), ARMS(L, H, N, L), ARMS(H, H, N, L), // 252C
+    ARMS(L, L, N, H), ARMS(H, L, N, H), ARMS(L, H, N, H), ARMS(H, H, N, H), // 2530
+    ARMS(L, L, L, N), ARMS(H, L, L, N), ARMS(L, H, L, N), ARMS(H, H, L, N), // 2534
+    ARMS(L, L, H, N), ARMS(H, L, H, N), ARMS(L, H, H, N), ARMS(H, H, H, N), // 2538
+    ARMS(L, L, L, L), ARMS(H, L, L, L), ARMS(L, H, L, L), ARMS(H, H, L, L), // 253C
+    ARMS(L, L, H, L), ARMS(L, L, L, H), ARMS(L, L, H, H), ARMS(H, L, H, L), // 2540
+    ARMS(L, H, H, L), ARMS(H, L, L, H), ARMS(L, H, L, H), ARMS(H, H, H, L), // 2544
+    ARMS(H, H, L, H), ARMS(H, L, H, H), ARMS(L, H, H, H), ARMS(H, H, H, H), // 2548
+    0, 0, 0, 0,                                                             // 254C dashes
+    ARMS(D, D, N, N), ARMS(N, N, D, D), ARMS(N, D, N, L), ARMS(N, L, N, D), // 2550
+    ARMS(N, D, N, D), ARMS(D, N, N, L), ARMS(L, N, N, D), ARMS(D, N, N, D), // 2554
+    ARMS(N, D, L, N), ARMS(N, L, D, N), ARMS(N, D, D, N), ARMS(D, N, L, N), // 2558
+    ARMS(L, N, D, N), ARMS(D, N, D, N), ARMS(N, D, L, L), ARMS(N, L, D, D), // 255C
+    ARMS(N, D, D, D), ARMS(D, N, L, L), ARMS(L, N, D, D), ARMS(D, N, D, D), // 2560
+    ARMS(D, D, N, L), ARMS(L, L, N, D), ARMS(D, D, N, D), ARMS(D, D, L, N), // 2564
+    ARMS(L, L, D, N), ARMS(D, D, D, N), ARMS(D, D, L, L), ARMS(L, L, D, D), // 2568
+    ARMS(D, D, D, D), 0, 0, 0,                                              // 256C arcs
+    0, 0, 0, 0,                                                             // 2570 arc and diagonals
+    ARMS(L, N, N, N), ARMS(N, N, L, N), ARMS(N, L, N, N), ARMS(N, N, N, L), // 2574
+    ARMS(H, N, N, N), ARMS(N, N, H, N), ARMS(N, H, N, N), ARMS(N, N, N, H), // 2578
+    ARMS(L, H, N, N), ARMS(N, N, L, H), ARMS(H, L, N, N), ARMS(N, N, H, L), // 257C
+};
+
+#undef N
+#undef L
+#undef H
+#undef D
+
+// coverage bitmap being drawn into, rows run top down
+typedef struct Canvas {
+    uint8_t *pixels;
+    int width;
+    int height;
+    int light;           // stroke width of light lines
+} Canvas;
+
+// extents of the strokes crossing one axis, a and b differ only for double lines
+typedef struct StrokeSpan {
+    int a0, a1;
+    int b0, b1;
+} StrokeSpan;
+
+static void fill_rect(const Canvas *canvas, int x0, int y0, int x1, int y1, uint8_t value) {
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 > canvas->width)
+        x1 = canvas->width;
+    if (y1 > canvas->height)
+        y1 = canvas->height;
+    for (int y = y0; y < y1; y++) {
+        if (x1 > x0)
+            memset(canvas->pixels + (size_t)y * canvas->width + x0, value, (size_t)(x1 - x0));
+    }
+}
+
+static void blend_pixel(const Canvas *canvas, int x, int y, float coverage) {
+    if (coverage <= 0.0f)
+        return;
+    uint8_t value = (uint8_t)lroundf((coverage > 1.0f ? 1.0f : coverage) * 255.0f);
+    uint8_t *pixel = &canvas->pixels[(size_t)y * canvas->width + x];
+    if (value > *pixel)
+        *pixel = value;
+}
+
+static int arm_thickness(const Canvas *canvas, int weight) {
+    return weight == ARM_HEAVY ? canvas->light * 2 : canvas->light;
+}
+
+// strokes of the given weight centered across an axis of length size
+static StrokeSpan stroke_span(const Canvas *canvas, int size, int weight) {
+    StrokeSpan span;
+    if (weight == ARM_NONE) {
+        span.a0 = span.a1 = span.b0 = span.b1 = size / 2;
+    } else if (weight == ARM_DOUBLE) {
+        int t = canvas->light;
+        span.a0 = (size - 3 * t) / 2;
+        span.a1 = span.a0 + t;
+        span.b0 = span.a0 + 2 * t;
+        span.b1 = span.a0 + 3 * t;
+    } else {
+        int t = arm_thickness(canvas, weight);
+        span.a0 = span.b0 = (size - t) / 2;
+        span.a1 = span.b1 = span.a0 + t;
+    }
+    return span;
+}
+
+static int axis_weight(int first, int second) {
+    if (first == ARM_DOUBLE || second == ARM_DOUBLE)
+        return ARM_DOUBLE;
+    return first > second ? first : second;
+}
+
+// draw lines from the cell center to the edges so every join meets its neighbour
+static void draw_box(const Canvas *canvas, uint8_t arms) {
+    int left = ARM_LEFT(arms);
+    int right = ARM_RIGHT(arms);
+    int up = ARM_UP(arms);
+    int down = ARM_DOWN(arms);
+    int w = canvas->width;
+    int h = canvas->height;
+
+    StrokeSpan v = stroke_span(canvas, w, axis_weight(up, down));
+    StrokeSpan hz = stroke_span(canvas, h, axis_weight(left, right));
+    bool vertical_double = up == ARM_DOUBLE && down == ARM_DOUBLE;
+    bool horizontal_double = left == ARM_DOUBLE && right == ARM_DOUBLE;
+
+    // horizontal arms stop at the vertical strokes they join
+    if (left == ARM_DOUBLE) {
+        fill_rect(canvas, 0, hz.a0, up ? v.a1 : v.b1, hz.a1, 255);
+        fill_rect(canvas, 0, hz.b0, down ? v.a1 : v.b1, hz.b1, 255);
+    } else if (left) {
+        StrokeSpan own = stroke_span(canvas, h, left);
+        fill_rect(canvas, 0, own.a0, !right && vertical_double ? v.a1 : v.b1, own.a1, 255);
+    }
+    if (right == ARM_DOUBLE) {
+        fill_rect(canvas, up ? v.b0 : v.a0, hz.a0, w, hz.a1, 255);
+        fill_rect(canvas, down ? v.b0 : v.a0, hz.b0, w, hz.b1, 255);
+    } else if (right) {
+        StrokeSpan own = stroke_span(canvas, h, right);
+        fill_rect(canvas, !left && vertical_double ? v.b0 : v.a0, own.a0, w, own.a1, 255);
+    }
+
+    // vertical arms stop at the horizontal strokes they join
+    if (up == ARM_DOUBLE) {
+        fill_rect(canvas, v.a0, 0, v.a1, left ? hz.a1 : hz.b1, 255);
+        fill_rect(canvas, v.b0, 0, v.b1, right ? hz.a1 : hz.b1, 255);
+    } else if (up) {
+        StrokeSpan own = stroke_span(canvas, w, up);
+        fill_rect(canvas, own.a0, 0, own.a1, !down && horizontal_double ? hz.a1 : hz.b1, 255);
+    }
+    if (down == ARM_DOUBLE) {
+        fill_rect(canvas, v.a0, left ? hz.b0 : hz.a0, v.a1, h, 255);
+        fill_rect(canvas, v.b0, right ? hz.b0 : hz.a0, v.b1, h, 255);
+    } else if (down) {
+        StrokeSpan own = stroke_span(canvas, w, down);
+        fill_rect(canvas, own.a0, !up && horizontal_double ? hz.b0 : hz.a0, own.a1, h, 255);
+    }
+}
+
+// split a line into dashes with half a gap at each end so dashes repeat across cells
+static void draw_dashes(const Canvas *canvas, int count, int weight, bool vertical) {
+    int length = vertical ? canvas->height : canvas->width;
+    StrokeSpan own = stroke_span(canvas, vertical ? canvas->width : canvas->height, weight);
+    int gap = length / (count * 4) > 1 ? length / (count * 4) : 1;
+    for (int i = 0; i < count; i++) {
+        int start = i * length / count + gap / 2;
+        int end = (i + 1) * length / count - (gap - gap / 2);
+        if (vertical)
+            fill_rect(canvas, own.a0, start, own.a1, end, 255);
+        else
+            fill_rect(canvas, start, own.a0, end, own.a1, 255);
+    }
+}
+
+// rounded corner joining the center lines, dx and dy point to the connected edges
+static void draw_arc(const Canvas *canvas, int dx, int dy) {
+    float t = (float)canvas->light;
+    float cx = (float)((canvas->width - canvas->light) / 2) + t * 0.5f;
+    float cy = (float)((canvas->height - canvas->light) / 2) + t * 0.5f;
+    float rx = dx > 0 ? (float)canvas->width - cx : cx;
+    float ry = dy > 0 ? (float)canvas->height - cy : cy;
+    float radius = rx < ry ? rx : ry;
+    float ox = cx + (float)dx * radius;
+    float oy = cy + (float)dy * radius;
+
+    for (int y = 0; y < canvas->height; y++) {
+        for (int x = 0; x < canvas->width; x++) {
+            float px = (float)x + 0.5f;
+            float py = (float)y + 0.5f;
+            // straight runs past the arc and the quarter circle inside it
+            float distance;
+            if ((px - ox) * (float)dx > 0.0f)
+                distance = fabsf(py - cy);
+            else if ((py - oy) * (float)dy > 0.0f)
+                distance = fabsf(px - cx);
+            else
+                distance = fabsf(hypotf(px - ox, py - oy) - radius);
+            blend_pixel(canvas, x, y, t * 0.5f + 0.5f - distance);
+        }
+    }
+}
+
+// corner to corner line so diagonals continue into the next cell
+static void draw_diagonal(const Canvas *canvas, bool rising) {
+    float w = (float)canvas->width;
+    float h = (float)canvas->height;
+    float length = hypotf(w, h);
+    for (int y = 0; y < canvas->height; y++) {
+        for (int x = 0; x < canvas->width; x++) {
+            float px = (float)x + 0.5f;
+            float py = (float)y + 0.5f;
+            float along = rising ? px * h + py * w - w * h : px * h - py * w;
+            blend_pixel(canvas, x, y, (float)canvas->light * 0.5f + 0.5f - fabsf(along) / length);
+        }
+    }
+}
+
+static void draw_block(const Canvas *canvas, uint32_t codepoint) {
+    int w = canvas->width;
+    int h = canvas->height;
+    int half_w = w / 2;
+    int half_h = h / 2;
+
+    if (codepoint == 0x2580) {
+        fill_rect(canvas, 0, 0, w, half_h, 255);
+    } else if (codepoint <= 0x2588) {
+        // lower eighths up to the full block
+        int eighths = (int)(codepoint - 0x2580);
+        fill_rect(canvas, 0, h - (int)lroundf((float)h * (float)eighths / 8.0f), w, h, 255);
+    } else if (codepoint <= 0x258F) {
+        // left eighths shrinking from seven
+        int eighths = 0x2590 - (int)codepoint;
+        fill_rect(canvas, 0, 0, (int)lroundf((float)w * (float)eighths / 8.0f), h, 255);
+    } else if (codepoint == 0x2590) {
+        fill_rect(canvas, half_w, 0, w, h, 255);
+    } else if (codepoint <= 0x2593) {
+        // shades blend evenly instead of dithering
+        fill_rect(canvas, 0, 0, w, h, (uint8_t)(64 * (codepoint - 0x2590)));
+    } else if (codepoint == 0x2594) {
+        fill_rect(canvas, 0, 0, w, (int)lroundf((float)h / 8.0f), 255);
+    } else if (codepoint == 0x2595) {
+        fill_rect(canvas, w - (int)lroundf((float)w / 8.0f), 0, w, h, 255);
+    } else {
+        // quadrants as upper left, upper right, lower left, lower right bits
+        static const uint8_t quadrants[10] = { 0x4, 0x8, 0x1, 0xD, 0x9, 0x7, 0xB, 0x2, 0x6, 0xE };
+        uint8_t bits = quadrants[codepoint - 0x2596];
+        if (bits & 0x1)
+            fill_rect(canvas, 0, 0, half_w, half_h, 255);
+        if (bits & 0x2)
+            fill_rect(canvas, half_w, 0, w, half_h, 255);
+        if (bits & 0x4)
+            fill_rect(canvas, 0, half_h, half_w, h, 255);
+        if (bits & 0x8)
+            fill_rect(canvas, half_w, half_h, w, h, 255);
+    }
+}
+
+// two columns of four dots numbered down the left column first
+static void draw_braille(const Canvas *canvas, uint32_t codepoint) {
+    static const uint8_t dot_column[8] = { 0, 0, 0, 1, 1, 1, 0, 1 };
+    static const uint8_t dot_row[8] = { 0, 1, 2, 0, 1, 2, 3, 3 };
+    float cell_w = (float)canvas->width / 2.0f;
+    float cell_h = (float)canvas->height / 4.0f;
+    float radius = (cell_w < cell_h ? cell_w : cell_h) * 0.35f;
+
+    for (int dot = 0; dot < 8; dot++) {
+        if (!(codepoint & (1u << dot)))
+            continue;
+        float ox = ((float)dot_column[dot] + 0.5f) * cell_w;
+        float oy = ((float)dot_row[dot] + 0.5f) * cell_h;
+        int x0 = (int)(ox - radius - 1.0f);
+        int y0 = (int)(oy - radius - 1.0f);
+        for (int y = y0 < 0 ? 0 : y0; y <= (int)(oy + radius + 1.0f) && y < canvas->height; y++) {
+            for (int x = x0 < 0 ? 0 : x0; x <= (int)(ox + radius + 1.0f) && x < canvas->width; x++) {
+                float distance = hypotf((float)x + 0.5f - ox, (float)y + 0.5f - oy);
+                blend_pixel(canvas, x, y, radius + 0.5f - distance);
+            }
+        }
+    }
+}
+
+void cell_glyph_render(uint32_t codepoint, int width, int height, uint8_t *pixels) {
+    memset(pixels, 0, (size_t)width * height);
+    // light lines grow with the cell and never vanish at small sizes
+    int light = (int)lroundf((float)height / 20.0f);
+    Canvas canvas = { pixels, width, height, light < 1 ? 1 : light };
+
+    if (codepoint >= 0x2800) {
+        draw_braille(&canvas, codepoint);
+    } else if (codepoint >= 0x2580) {
+        draw_block(&canvas, codepoint);
+    } else if (codepoint >= 0x2504 && codepoint <= 0x250B) {
+        // triple then quadruple dashes alternating light and heavy
+        int index = (int)(codepoint - 0x2504);
+        draw_dashes(&canvas, index < 4 ? 3 : 4, index & 1 ? ARM_HEAVY : ARM_LIGHT, index & 2);
+    } else if (codepoint >= 0x254C && codepoint <= 0x254F) {
+        int index = (int)(codepoint - 0x254C);
+        draw_dashes(&canvas, 2, index & 1 ? ARM_HEAVY : ARM_LIGHT, index & 2);
+    } else if (codepoint >= 0x256D && codepoint <= 0x2570) {
+        static const int8_t arc_dx[4] = { 1, -1, -1, 1 };
+        static const int8_t arc_dy[4] = { 1, 1, -1, -1 };
+        draw_arc(&canvas, arc_dx[codepoint - 0x256D], arc_dy[codepoint - 0x256D]);
+    } else if (codepoint >= 0x2571 && codepoint <= 0x2573) {
+        if (codepoint != 0x2572)
+            draw_diagonal(&canvas, true);
+        if (codepoint != 0x2571)
+            draw_diagonal(&canvas, false);
+    } else {
+        draw_box(&canvas, box_arms[codepoint - 0x2500]);
+    }
+}
@@ -0,0 +1,607 @@
+#include <cell_kernel.h>
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CELL_KERNEL_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CELL_KERNEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// hash lanes, word w of a row always feeds lane w % CELL_HASH_LANES
+// so the vector variants can update whole blocks of lanes at once
+#define CELL_HASH_LANES 16
+#define CELL_HASH_MUL 0x9E3779B1u
+// cells covering every lane once
+#define CELL_HASH_BLOCK (CELL_HASH_LANES / 2)
+
+static const uint32_t cell_hash_seed[CELL_HASH_LANES] = {
+    0x811C9DC5u, 0x050C5D1Fu, 0x2545F491u, 0x9E3779B9u, 0x85EBCA6Bu, 0xC2B2AE35u, 0x27D4EB2Fu, 0x165667B1u,
+    0xD3A2646Cu, 0xFD7046C5u, 0xB55A4F09u, 0x68E31DA4u, 0x1B873593u, 0xCC9E2D51u, 0xE6546B64u, 0x7FEB352Du,
+};
+
+static inline uint32_t cell_hash_step(uint32_t lane, uint32_t word) {
+    lane = (lane ^ word) * CELL_HASH_MUL;
+    return lane ^ (lane >> 15);
+}
+
+// feed the cells from first on into the lanes and fold them into one value
+static uint64_t cell_hash_finish(uint32_t lanes[CELL_HASH_LANES], const Cell *cells, size_t first, size_t count) {
+    for (size_t i = first; i < count; i++) {
+        size_t lane = (i * 2) % CELL_HASH_LANES;
+        lanes[lane] = cell_hash_step(lanes[lane], cells[i].codepoint);
+        lanes[lane + 1] = cell_hash_step(lanes[lane + 1], cells[i].style);
+    }
+
+    uint64_t h = 0xCBF29CE484222325ull ^ count;
+    for (size_t lane = 0; lane < CELL_HASH_LANES; lane++)
+        h = (h ^ lanes[lane]) * 0x100000001B3ull;
+    return h ^ (h >> 29);
+}
+
+static void fill_scalar(Cell *cells, size_t count, Cell value) {
+    for (size_t i = 0; i < count; i++)
+        cells[i] = value;
+}
+
+static void copy_any(Cell *dst, const Cell *src, size_t count) {
+    // libc already moves memory with the widest loads the cpu has
+    memmove(dst, src, count * sizeof(Cell));
+}
+
+static size_t diff_scalar(const Cell *a, const Cell *b, size_t count) {
+    size_t i = 0;
+    while (i < count && a[i].codepoint == b[i].codepoint && a[i].style == b[i].style)
+        i++;
+    return i;
+}
+
+static size_t style_run_scalar(const Cell *cells, size_t count, uint32_t style) {
+    size_t i = 0;
+    while (i < count && cells[i].style == style)
+        i++;
+    return i;
+}
+
+static void store_bytes_scalar(Cell *dst, const uint8_t *text, size_t count, uint32_t style) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (Cell){ text[i], style };
+}
+
+static void store_codepoints_scalar(Cell *dst, const uint32_t *codepoints, size_t count, uint32_t style) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (Cell){ codepoints[i], style };
+}
+
+static uint64_t hash_scalar(const Cell *cells, size_t count) {
+    uint32_t lanes[CELL_HASH_LANES];
+    memcpy(lanes, cell_hash_seed, sizeof(lanes));
+    return cell_hash_finish(lanes, cells, 0, count);
+}
+
+static size_t scan_printable_scalar(const uint8_t *text, size_t count) {
+    size_t i = 0;
+    while (i < count && text[i] >= 0x20 && text[i] <= 0x7E)
+        i++;
+    return i;
+}
+
+static void classify_utf8_scalar(const uint8_t *text, Utf8Masks *masks) {
+    *masks = (Utf8Masks){0};
+    for (int k = 0; k < UTF8_BLOCK; k++) {
+        uint8_t b = text[k];
+        uint64_t bit = (uint64_t)1 << k;
+        if (b >= 0x80)
+            masks->high |= bit;
+        if (b >= 0x80 && b < 0xC0)
+            masks->cont |= bit;
+        if (b >= 0xE0)
+            masks->lead3 |= bit;
+        if (b >= 0xF0)
+            masks->lead4 |= bit;
+        if (b < 0x20 || b == 0x7F)
+            masks->control |= bit;
+        if (b == 0xC0 || b == 0xC1 || b == 0xC2 || b == 0xE0 || b == 0xED || b == 0xF0 || b >= 0xF4)
+            masks->special |= bit;
+    }
+}
+
+#define CELL_KERNELS_SCALAR                                                                                      \
+    { "scalar", fill_scalar, copy_any, diff_scalar, style_run_scalar, store_bytes_scalar, store_codepoints_scalar, \
+      hash_scalar, scan_printable_scalar, classify_utf8_scalar }
+
+static const CellKernels cell_kernels_scalar = CELL_KERNELS_SCALAR;
+CellKernels cell_kernels = CELL_KERNELS_SCALAR;
+
+#if defined(CELL_KERNEL_X86)
+// vector variants are built for their target whatever the compiler flags
+// and only run once cpuid reported support
+#define CELL_KERNEL_SSE2 __attribute__((target("sse2")))
+#define CELL_KERNEL_AVX2 __attribute__((target("avx2")))
+
+static CELL_KERNEL_SSE2 void fill_sse2(Cell *cells, size_t count, Cell value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    __m128i v = _mm_set1_epi64x((long long)bits);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128((__m128i *)(cells + i), v);
+        _mm_storeu_si128((__m128i *)(cells + i + 2), v);
+        _mm_storeu_si128((__m128i *)(cells + i + 4), v);
+        _mm_storeu_si128((__m128i *)(cells + i + 6), v);
+    }
+    for (; i + 2 <= count; i += 2)
+        _mm_storeu_si128((__m128i *)(cells + i), v);
+    if (i < count)
+        cells[i] = value;
+}
+
+static CELL_KERNEL_SSE2 size_t diff_sse2(const Cell *a, const Cell *b, size_t count) {
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(a + i)),
+                                     _mm_loadu_si128((const __m128i *)(b + i)));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(eq) ^ 0xFFFFu;
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask) / sizeof(Cell);
+    }
+    return i + diff_scalar(a + i, b + i, count - i);
+}
+
+static CELL_KERNEL_SSE2 size_t style_run_sse2(const Cell *cells, size_t count, uint32_t style) {
+    // only the bytes of the style words decide
+    __m128i want = _mm_set1_epi32((int)style);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(cells + i)), want);
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(eq) & 0xF0F0u;
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask) / sizeof(Cell);
+    }
+    return i + style_run_scalar(cells + i, count - i, style);
+}
+
+static CELL_KERNEL_SSE2 void store_bytes_sse2(Cell *dst, const uint8_t *text, size_t count, uint32_t style) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i tag = _mm_set1_epi32((int)style);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // widen eight bytes to words and interleave them with the style
+        __m128i words = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(text + i)), zero);
+        __m128i low = _mm_unpacklo_epi16(words, zero);
+        __m128i high = _mm_unpackhi_epi16(words, zero);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi32(low, tag));
+        _mm_storeu_si128((__m128i *)(dst + i + 2), _mm_unpackhi_epi32(low, tag));
+        _mm_storeu_si128((__m128i *)(dst + i + 4), _mm_unpacklo_epi32(high, tag));
+        _mm_storeu_si128((__m128i *)(dst + i + 6), _mm_unpackhi_epi32(high, tag));
+    }
+    store_bytes_scalar(dst + i, text + i, count - i, style);
+}
+
+static CELL_KERNEL_SSE2 void store_codepoints_sse2(Cell *dst, const uint32_t *codepoints, size_t count,
+                                                   uint32_t style) {
+    __m128i tag = _mm_set1_epi32((int)style);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(codepoints + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_unpacklo_epi32(v, tag));
+        _mm_storeu_si128((__m128i *)(dst + i + 2), _mm_unpackhi_epi32(v, tag));
+    }
+    store_codepoints_scalar(dst + i, codepoints + i, count - i, style);
+}
+
+// sse2 has no 32 bit multiply so combine the even and odd lane products
+static CELL_KERNEL_SSE2 inline __m128i hash_mul_sse2(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static CELL_KERNEL_SSE2 inline __m128i hash_step_sse2(__m128i lanes, const Cell *cells, __m128i mul) {
+    lanes = hash_mul_sse2(_mm_xor_si128(lanes, _mm_loadu_si128((const __m128i *)cells)), mul);
+    return _mm_xor_si128(lanes, _mm_srli_epi32(lanes, 15));
+}
+
+static CELL_KERNEL_SSE2 uint64_t hash_sse2(const Cell *cells, size_t count) {
+    __m128i mul = _mm_set1_epi32((int)CELL_HASH_MUL);
+    __m128i s0 = _mm_loadu_si128((const __m128i *)cell_hash_seed);
+    __m128i s1 = _mm_loadu_si128((const __m128i *)(cell_hash_seed + 4));
+    __m128i s2 = _mm_loadu_si128((const __m128i *)(cell_hash_seed + 8));
+    __m128i s3 = _mm_loadu_si128((const __m128i *)(cell_hash_seed + 12));
+    size_t i = 0;
+    for (; i + CELL_HASH_BLOCK <= count; i += CELL_HASH_BLOCK) {
+        s0 = hash_step_sse2(s0, cells + i, mul);
+        s1 = hash_step_sse2(s1, cells + i + 2, mul);
+        s2 = hash_step_sse2(s2, cells + i + 4, mul);
+        s3 = hash_step_sse2(s3, cells + i + 6, mul);
+    }
+
+    uint32_t lanes[CELL_HASH_LANES];
+    _mm_storeu_si128((__m128i *)lanes, s0);
+    _mm_storeu_si128((__m128i *)(lanes + 4), s1);
+    _mm_storeu_si128((__m128i *)(lanes + 8), s2);
+    _mm_storeu_si128((__m128i *)(lanes + 12), s3);
+    return cell_hash_finish(lanes, cells, i, count);
+}
+
+static CELL_KERNEL_AVX2 void fill_avx2(Cell *cells, size_t count, Cell value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    __m256i v = _mm256_set1_epi64x((long long)bits);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        _mm256_storeu_si256((__m256i *)(cells + i), v);
+        _mm256_storeu_si256((__m256i *)(cells + i + 4), v);
+        _mm256_storeu_si256((__m256i *)(cells + i + 8), v);
+        _mm256_storeu_si256((__m256i *)(cells + i + 12), v);
+    }
+    for (; i + 4 <= count; i += 4)
+        _mm256_storeu_si256((__m256i *)(cells + i), v);
+    for (; i < count; i++)
+        cells[i] = value;
+}
+
+static CELL_KERNEL_AVX2 size_t diff_avx2(const Cell *a, const Cell *b, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + i)),
+                                        _mm256_loadu_si256((const __m256i *)(b + i)));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(eq);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask) / sizeof(Cell);
+    }
+    return i + diff_scalar(a + i, b + i, count - i);
+}
+
+static CELL_KERNEL_AVX2 size_t style_run_avx2(const Cell *cells, size_t count, uint32_t style) {
+    __m256i want = _mm256_set1_epi32((int)style);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(cells + i)), want);
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(eq) & 0xF0F0F0F0u;
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask) / sizeof(Cell);
+    }
+    return i + style_run_scalar(cells + i, count - i, style);
+}
+
+// interleave eight codepoints with the style, unpacking works within 128 bit halves
+static CELL_KERNEL_AVX2 inline void store_cells_avx2(Cell *dst, __m256i codepoints, __m256i tag) {
+    __m256i low = _mm256_unpacklo_epi32(codepoints, tag);
+    __m256i high = _mm256_unpackhi_epi32(codepoints, tag);
+    _mm256_storeu_si256((__m256i *)dst, _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256((__m256i *)(dst + 4), _mm256_permute2x128_si256(low, high, 0x31));
+}
+
+static CELL_KERNEL_AVX2 void store_bytes_avx2(Cell *dst, const uint8_t *text, size_t count, uint32_t style) {
+    __m256i tag = _mm256_set1_epi32((int)style);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        store_cells_avx2(dst + i, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(text + i))), tag);
+    store_bytes_scalar(dst + i, text + i, count - i, style);
+}
+
+static CELL_KERNEL_AVX2 void store_codepoints_avx2(Cell *dst, const uint32_t *codepoints, size_t count,
+                                                   uint32_t style) {
+    __m256i tag = _mm256_set1_epi32((int)style);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+        store_cells_avx2(dst + i, _mm256_loadu_si256((const __m256i *)(codepoints + i)), tag);
+    store_codepoints_scalar(dst + i, codepoints + i, count - i, style);
+}
+
+static CELL_KERNEL_AVX2 inline __m256i hash_step_avx2(__m256i lanes, const Cell *cells, __m256i mul) {
+    lanes = _mm256_mullo_epi32(_mm256_xor_si256(lanes, _mm256_loadu_si256((const __m256i *)cells)), mul);
+    return _mm256_xor_si256(lanes, _mm256_srli_epi32(lanes, 15));
+}
+
+static CELL_KERNEL_AVX2 uint64_t hash_avx2(const Cell *cells, size_t count) {
+    __m256i mul = _mm256_set1_epi32((int)CELL_HASH_MUL);
+    __m256i s0 = _mm256_loadu_si256((const __m256i *)cell_hash_seed);
+    __m256i s1 = _mm256_loadu_si256((const __m256i *)(cell_hash_seed + 8));
+    size_t i = 0;
+    for (; i + CELL_HASH_BLOCK <= count; i += CELL_HASH_BLOCK) {
+        s0 = hash_step_avx2(s0, cells + i, mul);
+        s1 = hash_step_avx2(s1, cells + i + 4, mul);
+    }
+
+    uint32_t lanes[CELL_HASH_LANES];
+    _mm256_storeu_si256((__m256i *)lanes, s0);
+    _mm256_storeu_si256((__m256i *)(lanes + 8), s1);
+    return cell_hash_finish(lanes, cells, i, count);
+}
+
+// signed compares also reject bytes >= 0x80 since they are negative
+static CELL_KERNEL_SSE2 size_t scan_printable_sse2(const uint8_t *text, size_t count) {
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i high = _mm_set1_epi8(0x7F);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, low), _mm_cmpgt_epi8(high, v));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(ok) ^ 0xFFFFu;
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + scan_printable_scalar(text + i, count - i);
+}
+
+static CELL_KERNEL_AVX2 size_t scan_printable_avx2(const uint8_t *text, size_t count) {
+    const __m256i low = _mm256_set1_epi8(0x1F);
+    const __m256i high = _mm256_set1_epi8(0x7F);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i ok = _mm256_and_si256(_mm256_cmpgt_epi8(v, low), _mm256_cmpgt_epi8(high, v));
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ok);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+    return i + scan_printable_scalar(text + i, count - i);
+}
+
+// classify 16 bytes with signed compares since bytes >= 0x80 are negative
+static CELL_KERNEL_SSE2 void classify_utf8_half_sse2(const uint8_t *text, Utf8Masks *masks, int shift) {
+    __m128i v = _mm_loadu_si128((const __m128i *)text);
+    uint64_t high = (uint64_t)_mm_movemask_epi8(v);
+    uint64_t cont = (uint64_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8((char)0xC0), v));
+    uint64_t lead3 = (uint64_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)0xDF)));
+    uint64_t lead4 = (uint64_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)0xEF)));
+    uint64_t low = (uint64_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(0x20), v));
+    uint64_t del = (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x7F)));
+
+    // c0 c1 c2 e0 ed f0 and f4 or above
+    __m128i odd = _mm_cmpgt_epi8(v, _mm_set1_epi8((char)0xF3));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xC0)));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xC1)));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xC2)));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xE0)));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xED)));
+    odd = _mm_or_si128(odd, _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xF0)));
+    uint64_t special = (uint64_t)_mm_movemask_epi8(odd) & high;
+
+    masks->high |= high << shift;
+    masks->cont |= (cont & high) << shift;
+    masks->lead3 |= (lead3 & high) << shift;
+    masks->lead4 |= (lead4 & high) << shift;
+    masks->control |= ((low & ~high) | del) << shift;
+    masks->special |= special << shift;
+}
+
+static CELL_KERNEL_SSE2 void classify_utf8_sse2(const uint8_t *text, Utf8Masks *masks) {
+    *masks = (Utf8Masks){0};
+    classify_utf8_half_sse2(text, masks, 0);
+    classify_utf8_half_sse2(text + 16, masks, 16);
+}
+
+static CELL_KERNEL_AVX2 void classify_utf8_avx2(const uint8_t *text, Utf8Masks *masks) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)text);
+    uint64_t high = (uint32_t)_mm256_movemask_epi8(v);
+    uint64_t cont = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8((char)0xC0), v));
+    uint64_t lead3 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)0xDF)));
+    uint64_t lead4 = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)0xEF)));
+    uint64_t low = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v));
+    uint64_t del = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x7F)));
+
+    __m256i odd = _mm256_cmpgt_epi8(v, _mm256_set1_epi8((char)0xF3));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xC0)));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xC1)));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xC2)));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xE0)));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xED)));
+    odd = _mm256_or_si256(odd, _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0xF0)));
+
+    masks->high = high;
+    masks->cont = cont & high;
+    masks->lead3 = lead3 & high;
+    masks->lead4 = lead4 & high;
+    masks->control = (low & ~high) | del;
+    masks->special = (uint32_t)_mm256_movemask_epi8(odd) & high;
+}
+
+static const CellKernels cell_kernels_sse2 = {
+    "sse2", fill_sse2, copy_any, diff_sse2, style_run_sse2, store_bytes_sse2, store_codepoints_sse2, hash_sse2,
+    scan_printable_sse2, classify_utf8_sse2,
+};
+
+static const CellKernels cell_kernels_avx2 = {
+    "avx2", fill_avx2, copy_any, diff_avx2, style_run_avx2, store_bytes_avx2, store_codepoints_avx2, hash_avx2,
+    scan_printable_avx2, classify_utf8_avx2,
+};
+
+static bool cell_kernel_has_sse2(void) {
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (edx & bit_SSE2);
+}
+
+// avx2 needs the cpu flag and an os that saves the ymm registers
+static bool cell_kernel_has_avx2(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+        return false;
+    unsigned int xcr0, xcr0_high;
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+    if ((xcr0 & 0x6) != 0x6)
+        return false;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & bit_AVX2) != 0;
+}
+#endif // CELL_KERNEL_X86
+
+#if defined(CELL_KERNEL_NEON)
+static void fill_neon(Cell *cells, size_t count, Cell value) {
+    uint32x4_t v = vreinterpretq_u32_u64(vdupq_n_u64((uint64_t)value.style << 32 | value.codepoint));
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u32((uint32_t *)(cells + i), v);
+        vst1q_u32((uint32_t *)(cells + i + 2), v);
+        vst1q_u32((uint32_t *)(cells + i + 4), v);
+        vst1q_u32((uint32_t *)(cells + i + 6), v);
+    }
+    for (; i + 2 <= count; i += 2)
+        vst1q_u32((uint32_t *)(cells + i), v);
+    if (i < count)
+        cells[i] = value;
+}
+
+static size_t diff_neon(const Cell *a, const Cell *b, size_t count) {
+    // find the block holding a difference and let the scalar loop pick the cell
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t low = vceqq_u32(vld1q_u32((const uint32_t *)(a + i)), vld1q_u32((const uint32_t *)(b + i)));
+        uint32x4_t high = vceqq_u32(vld1q_u32((const uint32_t *)(a + i + 2)), vld1q_u32((const uint32_t *)(b + i + 2)));
+        if (vminvq_u32(vandq_u32(low, high)) != UINT32_MAX)
+            break;
+    }
+    return i + diff_scalar(a + i, b + i, count - i);
+}
+
+static size_t style_run_neon(const Cell *cells, size_t count, uint32_t style) {
+    uint32x4_t want = vdupq_n_u32(style);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // split four cells into codepoints and styles
+        uint32x4x2_t split = vld2q_u32((const uint32_t *)(cells + i));
+        if (vminvq_u32(vceqq_u32(split.val[1], want)) != UINT32_MAX)
+            break;
+    }
+    return i + style_run_scalar(cells + i, count - i, style);
+}
+
+static void store_bytes_neon(Cell *dst, const uint8_t *text, size_t count, uint32_t style) {
+    uint32x4_t tag = vdupq_n_u32(style);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t words = vmovl_u8(vld1_u8(text + i));
+        uint32x4x2_t low = { { vmovl_u16(vget_low_u16(words)), tag } };
+        uint32x4x2_t high = { { vmovl_u16(vget_high_u16(words)), tag } };
+        vst2q_u32((uint32_t *)(dst + i), low);
+        vst2q_u32((uint32_t *)(dst + i + 4), high);
+    }
+    store_bytes_scalar(dst + i, text + i, count - i, style);
+}
+
+static void store_codepoints_neon(Cell *dst, const uint32_t *codepoints, size_t count, uint32_t style) {
+    uint32x4_t tag = vdupq_n_u32(style);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32x4x2_t pair = { { vld1q_u32(codepoints + i), tag } };
+        vst2q_u32((uint32_t *)(dst + i), pair);
+    }
+    store_codepoints_scalar(dst + i, codepoints + i, count - i, style);
+}
+
+static inline uint32x4_t hash_step_neon(uint32x4_t lanes, const Cell *cells, uint32x4_t mul) {
+    lanes = vmulq_u32(veorq_u32(lanes, vld1q_u32((const uint32_t *)cells)), mul);
+    return veorq_u32(lanes, vshrq_n_u32(lanes, 15));
+}
+
+static uint64_t hash_neon(const Cell *cells, size_t count) {
+    uint32x4_t mul = vdupq_n_u32(CELL_HASH_MUL);
+    uint32x4_t s0 = vld1q_u32(cell_hash_seed);
+    uint32x4_t s1 = vld1q_u32(cell_hash_seed + 4);
+    uint32x4_t s2 = vld1q_u32(cell_hash_seed + 8);
+    uint32x4_t s3 = vld1q_u32(cell_hash_seed + 12);
+    size_t i = 0;
+    for (; i + CELL_HASH_BLOCK <= count; i += CELL_HASH_BLOCK) {
+        s0 = hash_step_neon(s0, cells + i, mul);
+        s1 = hash_step_neon(s1, cells + i + 2, mul);
+        s2 = hash_step_neon(s2, cells + i + 4, mul);
+        s3 = hash_step_neon(s3, cells + i + 6, mul);
+    }
+
+    uint32_t lanes[CELL_HASH_LANES];
+    vst1q_u32(lanes, s0);
+    vst1q_u32(lanes + 4, s1);
+    vst1q_u32(lanes + 8, s2);
+    vst1q_u32(lanes + 12, s3);
+    return cell_hash_finish(lanes, cells, i, count);
+}
+
+static size_t scan_printable_neon(const uint8_t *text, size_t count) {
+    const uint8x16_t low = vdupq_n_u8(0x20);
+    const uint8x16_t high = vdupq_n_u8(0x7E);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t v = vld1q_u8(text + i);
+        if (vminvq_u8(vandq_u8(vcgeq_u8(v, low), vcleq_u8(v, high))) != 0xFF)
+            break;
+    }
+    return i + scan_printable_scalar(text + i, count - i);
+}
+
+// neon has no movemask so weight each lane by its bit and add the halves
+static inline uint64_t movemask_neon(uint8x16_t set) {
+    static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t bits = vandq_u8(set, vld1q_u8(weights));
+    return (uint64_t)vaddv_u8(vget_low_u8(bits)) | (uint64_t)vaddv_u8(vget_high_u8(bits)) << 8;
+}
+
+static void classify_utf8_neon(const uint8_t *text, Utf8Masks *masks) {
+    *masks = (Utf8Masks){0};
+    for (int shift = 0; shift < UTF8_BLOCK; shift += 16) {
+        uint8x16_t v = vld1q_u8(text + shift);
+        uint8x16_t high = vcgeq_u8(v, vdupq_n_u8(0x80));
+        uint8x16_t control = vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)), vceqq_u8(v, vdupq_n_u8(0x7F)));
+
+        // c0 c1 c2 e0 ed f0 and f4 or above
+        uint8x16_t odd = vcgeq_u8(v, vdupq_n_u8(0xF4));
+        odd = vorrq_u8(odd, vandq_u8(vcgeq_u8(v, vdupq_n_u8(0xC0)), vcleq_u8(v, vdupq_n_u8(0xC2))));
+        odd = vorrq_u8(odd, vceqq_u8(v, vdupq_n_u8(0xE0)));
+        odd = vorrq_u8(odd, vceqq_u8(v, vdupq_n_u8(0xED)));
+        odd = vorrq_u8(odd, vceqq_u8(v, vdupq_n_u8(0xF0)));
+
+        masks->high |= movemask_neon(high) << shift;
+        masks->cont |= movemask_neon(vandq_u8(high, vcltq_u8(v, vdupq_n_u8(0xC0)))) << shift;
+        masks->lead3 |= movemask_neon(vcgeq_u8(v, vdupq_n_u8(0xE0))) << shift;
+        masks->lead4 |= movemask_neon(vcgeq_u8(v, vdupq_n_u8(0xF0))) << shift;
+        masks->control |= movemask_neon(control) << shift;
+        masks->special |= movemask_neon(odd) << shift;
+    }
+}
+
+static const CellKernels cell_kernels_neon = {
+    "neon", fill_neon, copy_any, diff_neon, style_run_neon, store_bytes_neon, store_codepoints_neon, hash_neon,
+    scan_printable_neon, classify_utf8_neon,
+};
+#endif // CELL_KERNEL_NEON
+
+// collect the variants this cpu runs from slowest to fastest
+static size_t cell_kernel_supported(const CellKernels **variants) {
+    size_t count = 0;
+    variants[count++] = &cell_kernels_scalar;
+#if defined(CELL_KERNEL_X86)
+    if (cell_kernel_has_sse2())
+        variants[count++] = &cell_kernels_sse2;
+    if (cell_kernel_has_avx2())
+        variants[count++] = &cell_kernels_avx2;
+#elif defined(CELL_KERNEL_NEON)
+    // neon is part of every aarch64 cpu
+    variants[count++] = &cell_kernels_neon;
+#endif
+    return count;
+}
+
+int cell_kernel_init(const char *name) {
+    const CellKernels *variants[3];
+    size_t count = cell_kernel_supported(variants);
+    cell_kernels = *variants[count - 1];
+    if (!name)
+        return 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(variants[i]->name, name) == 0) {
+            cell_kernels = *variants[i];
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -1,386 +1,474 @@
-#include <esc_seq.h>
-#include <string.h>
-#include <stdlib.h>
-#include <ctype.h>
-#include <stdbool.h>
-
-// move scroll region upward by one line
-void term_scroll_region_up(int *grid, int grid_x_size, int scroll_top, int scroll_bottom) {
-    if (scroll_top >= scroll_bottom)
-        return;
-    int height = scroll_bottom - scroll_top;
-    memmove(grid + scroll_top * grid_x_size,
-            grid + (scroll_top + 1) * grid_x_size,
-            sizeof(int) * grid_x_size * height);
-    memset(grid + scroll_bottom * grid_x_size, ' ', sizeof(int) * grid_x_size);
-}
-
-// move scroll region downward by one line
-void term_scroll_region_down(int *grid, int grid_x_size, int scroll_top, int scroll_bottom) {
-    if (scroll_top >= scroll_bottom)
-        return;
-    int height = scroll_bottom - scroll_top;
-    memmove(grid + (scroll_top + 1) * grid_x_size,
-            grid + scroll_top * grid_x_size,
-            sizeof(int) * grid_x_size * height);
-    memset(grid + scroll_top * grid_x_size, ' ', sizeof(int) * grid_x_size);
-}
-
-void esc_parser_init(esc_parser_t *parser) {
-    // reset parser buffers and state
-    parser->state = ESC_STATE_NORMAL;
-    parser->buf_pos = 0;
-    parser->param_count = 0;
-    parser->osc_waiting_backslash = false;
-    parser->params_present = false;
-    memset(parser->buf, 0, sizeof(parser->buf));
-    memset(parser->params, 0, sizeof(parser->params));
-}
-
-static int parse_int(const char *str, size_t len, int *out) {
-    int val = 0;
-    size_t i = 0;
-    while (i < len && isdigit((unsigned char)str[i])) {
-        val = val * 10 + (str[i] - '0');
-        i++;
-    }
-    *out = val;
-    return i;
-}
-
-static void parse_params(esc_parser_t *parser) {
-    // extract numeric parameters separated by semicolons
-    parser->param_count = 0;
-    parser->params_present = false;
-    size_t i = 0;
-    while (i < parser->buf_pos && parser->param_count < 16) {
-        if (isdigit((unsigned char)parser->buf[i])) {
-            int val;
-            size_t consumed = parse_int(parser->buf + i, parser->buf_pos - i, &val);
-            parser->params[parser->param_count++] = val;
-            parser->params_present = true;
-            i += consumed;
-        } else if (parser->buf[i] == ';') {
-            i++;
-        } else {
-            break;
-        }
-    }
-    if (!parser->params_present) {
-        parser->params[0] = 1;
-        parser->param_count = 1;
-    }
-}
-
-// handle state machine for escape sequence parsing
-int esc_parser_process(esc_parser_t *parser, uint8_t byte, int *cursor_row, int *cursor_col, int *grid, int grid_x_size, int grid_y_size, int *scroll_top, int *scroll_bottom) {
-    switch (parser->state) {
-    case ESC_STATE_NORMAL:
-        parser->osc_waiting_backslash = false;
-        if (byte == 0x1b) {
-            // begin escape sequence detection
-            parser->state = ESC_STATE_ESC;
-            parser->buf_pos = 0;
-            return 1;
-        }
-        return 0;
-
-    case ESC_STATE_ESC:
-        if (parser->osc_waiting_backslash) {
-            if (byte == '\\') {
-                // terminate osc sequence
-                parser->state = ESC_STATE_NORMAL;
-                parser->buf_pos = 0;
-                parser->osc_waiting_backslash = false;
-                return 1;
-            } else {
-                parser->osc_waiting_backslash = false;
-            }
-        }
-        if (byte == '[') {
-            // start csi sequence
-            parser->state = ESC_STATE_CSI;
-            parser->buf_pos = 0;
-            return 1;
-        } else if (byte == ']') {
-            // start osc sequence
-            parser->state = ESC_STATE_OSC;
-            parser->buf_pos = 0;
-            return 1;
-        } else if (byte == 'D') {
-            // index escape declass cursor down
-            if (*cursor_row >= *scroll_top && *cursor_row <= *scroll_bottom) {
-                if (*cursor_row == *scroll_bottom) {
-                    term_scroll_region_up(grid, grid_x_size, *scroll_top, *scroll_bottom);
-                } else if (*cursor_row < *scroll_bottom) {
-                    (*cursor_row)++;
-                }
-            } else if (*cursor_row < grid_y_size - 1) {
-                (*cursor_row)++;
-            }
-            parser->state = ESC_STATE_NORMAL;
-            parser->buf_pos = 0;
-            return 1;
-        } else if (byte == 'M') {
-            // reverse index escape declass cursor up
-            if (*cursor_row >= *scroll_top && *cursor_row <= *scroll_bottom) {
-                if (*cursor_row == *scroll_top) {
-                    term_scroll_region_down(grid, grid_x_size, *scroll_top, *scroll_bottom);
-                } else if (*cursor_row > *scroll_top) {
-                    (*cursor_row)--;
-                }
-            } else if (*cursor_row > 0) {
-                (*cursor_row)--;
-            }
-            parser->state = ESC_STATE_NORMAL;
-            parser->buf_pos = 0;
-            return 1;
-        } else if (byte == 'E') {
-            // next line escape moves cursor and resets column
-            if (*cursor_row >= *scroll_top && *cursor_row <= *scroll_bottom) {
-                if (*cursor_row == *scroll_bottom) {
-                    term_scroll_region_up(grid, grid_x_size, *scroll_top, *scroll_bottom);
-                } else if (*cursor_row < *scroll_bottom) {
-                    (*cursor_row)++;
-                }
-            } else if (*cursor_row < grid_y_size - 1) {
-                (*cursor_row)++;
-            }
-            *cursor_col = 0;
-            parser->state = ESC_STATE_NORMAL;
-            parser->buf_pos = 0;
-            return 1;
-        } else {
-            parser->state = ESC_STATE_NORMAL;
-            return 0;
-        }
-
-    case ESC_STATE_OSC:
-        if (byte == 0x07) {
-            // bel terminates osc
-            parser->state = ESC_STATE_NORMAL;
-            parser->buf_pos = 0;
-            parser->osc_waiting_backslash = false;
-            return 1;
-        } else if (byte == 0x1b) {
-            // esc expects final backslash
-            parser->osc_waiting_backslash = true;
-            parser->state = ESC_STATE_ESC;
-            return 1;
-        } else {
-            return 1;
-        }
-
-    case ESC_STATE_CSI:
-        if (byte >= 0x40 && byte <= 0x7E) {
-            char cmd = (char)byte;
-            parse_params(parser);
-
-            int n = parser->params[0];
-
-            switch (cmd) {
-            case 'A':
-                // cursor up csi n a
-                *cursor_row = (*cursor_row - n) < 0 ? 0 : (*cursor_row - n);
-                break;
-            case 'B':
-                // cursor down csi n b
-                *cursor_row = (*cursor_row + n) >= grid_y_size ? (grid_y_size - 1) : (*cursor_row + n);
-                break;
-            case 'C':
-                // cursor forward csi n c
-                *cursor_col = (*cursor_col + n) >= grid_x_size ? (grid_x_size - 1) : (*cursor_col + n);
-                break;
-            case 'D':
-                // cursor backward csi n d
-                *cursor_col = (*cursor_col - n) < 0 ? 0 : (*cursor_col - n);
-                break;
-            case 'H':
-            case 'f':
-                {
-                    // cursor position csi row col h or f
-                    int row = parser->param_count > 0 ? parser->params[0] : 1;
-                    int col = parser->param_count > 1 ? parser->params[1] : 1;
-                    *cursor_row = (row - 1) < 0 ? 0 : ((row - 1) >= grid_y_size ? (grid_y_size - 1) : (row - 1));
-                    *cursor_col = (col - 1) < 0 ? 0 : ((col - 1) >= grid_x_size ? (grid_x_size - 1) : (col - 1));
-                }
-                break;
-            case 'J':
-                {
-                    // erase in display csi n j
-                    int mode = parser->params_present ? n : 0;
-                    if (mode == 0 || mode == 1) {
-                        for (int y = mode == 0 ? *cursor_row : 0;
-                             y <= (mode == 0 ? grid_y_size - 1 : *cursor_row);
-                             y++) {
-                            int start_col = (y == *cursor_row) ? (mode == 0 ? *cursor_col : 0) : 0;
-                            int end_col = (y == *cursor_row) ? (mode == 0 ? grid_x_size : *cursor_col + 1) : grid_x_size;
-                            for (int x = start_col; x < end_col; x++) {
-                                grid[y * grid_x_size + x] = ' ';
-                            }
-                        }
-                    } else if (mode == 2) {
-                        memset(grid, ' ', sizeof(int) * grid_x_size * grid_y_size);
-                    }
-                }
-                break;
-            case 'K':
-                {
-                    // erase in line csi n k
-                    int mode = parser->params_present ? n : 0;
-                    int y = *cursor_row;
-                    int start_col, end_col;
-                    if (mode == 0) {
-                        start_col = *cursor_col;
-                        end_col = grid_x_size;
-                    } else if (mode == 1) {
-                        start_col = 0;
-                        end_col = *cursor_col + 1;
-                    } else {
-                        start_col = 0;
-                        end_col = grid_x_size;
-                    }
-                    for (int x = start_col; x < end_col; x++) {
-                        grid[y * grid_x_size + x] = ' ';
-                    }
-                }
-                break;
-            case 'L':
-                {
-                    // insert line csi n l
-                    if (*cursor_row < *scroll_top || *cursor_row > *scroll_bottom)
-                        break;
-                    int count = parser->params_present ? n : 1;
-                    if (count < 0)
-                        count = 0;
-                    int start = *cursor_row;
-                    int limit = *scroll_bottom - start + 1;
-                    if (limit <= 0)
-                        break;
-                    if (count > limit)
-                        count = limit;
-                    int move = limit - count;
-                    if (move > 0) {
-                        memmove(grid + (start + count) * grid_x_size,
-                                grid + start * grid_x_size,
-                                sizeof(int) * grid_x_size * move);
-                    }
-                    for (int i = 0; i < count; i++) {
-                        memset(grid + (start + i) * grid_x_size, ' ', sizeof(int) * grid_x_size);
-                    }
-                }
-                break;
-            case 'M':
-                {
-                    // delete line csi n m
-                    if (*cursor_row < *scroll_top || *cursor_row > *scroll_bottom)
-                        break;
-                    int count = parser->params_present ? n : 1;
-                    if (count < 0)
-                        count = 0;
-                    int start = *cursor_row;
-                    int limit = *scroll_bottom - start + 1;
-                    if (limit <= 0)
-                        break;
-                    if (count > limit)
-                        count = limit;
-                    int move = limit - count;
-                    if (move > 0) {
-                        memmove(grid + start * grid_x_size,
-                                grid + (start + count) * grid_x_size,
-                                sizeof(int) * grid_x_size * move);
-                    }
-                    for (int i = 0; i < count; i++) {
-                        memset(grid + (*scroll_bottom - i) * grid_x_size, ' ', sizeof(int) * grid_x_size);
-                    }
-                }
-                break;
-            case 'S':
-                {
-                    // scroll up csi n s
-                    int count = parser->params_present ? n : 1;
-                    if (count < 0)
-                        count = 0;
-                    int limit = *scroll_bottom - *scroll_top + 1;
-                    if (limit <= 0)
-                        break;
-                    if (count > limit)
-                        count = limit;
-                    for (int i = 0; i < count; i++)
-                        term_scroll_region_up(grid, grid_x_size, *scroll_top, *scroll_bottom);
-                }
-                break;
-            case 'T':
-                {
-                    // scroll down csi n t
-                    int count = parser->params_present ? n : 1;
-                    if (count < 0)
-                        count = 0;
-                    int limit = *scroll_bottom - *scroll_top + 1;
-                    if (limit <= 0)
-                        break;
-                    if (count > limit)
-                        count = limit;
-                    for (int i = 0; i < count; i++)
-                        term_scroll_region_down(grid, grid_x_size, *scroll_top, *scroll_bottom);
-                }
-                break;
-            case 'r':
-                {
-                    // set scroll region csi top bottom r
-                    if (!parser->params_present) {
-                        *scroll_top = 0;
-                        *scroll_bottom = grid_y_size - 1;
-                    } else {
-                        int top = parser->params[0] > 0 ? parser->params[0] - 1 : 0;
-                        int bottom = (parser->param_count > 1) ? parser->params[1] - 1 : (grid_y_size - 1);
-                        if (top < 0)
-                            top = 0;
-                        if (top >= grid_y_size)
-                            top = grid_y_size - 1;
-                        if (bottom < 0)
-                            bottom = 0;
-                        if (bottom >= grid_y_size)
-                            bottom = grid_y_size - 1;
-                        if (top >= bottom) {
-                            *scroll_top = 0;
-                            *scroll_bottom = grid_y_size - 1;
-                        } else {
-                            *scroll_top = top;
-                            *scroll_bottom = bottom;
-                        }
-                    }
-                    if (*cursor_row < *scroll_top)
-                        *cursor_row = *scroll_top;
-                    if (*cursor_row > *scroll_bottom)
-                        *cursor_row = *scroll_bottom;
-                    *cursor_col = 0;
-                }
-                break;
-            case 'm':
-                // select graphic rendition csi parameters m
-                break;
-            default:
-                break;
-            }
-
-            parser->state = ESC_STATE_NORMAL;
-            parser->buf_pos = 0;
-            return 1;
-        } else if (byte >= 0x20 && byte <= 0x3F) {
-            if (parser->buf_pos < sizeof(parser->buf) - 1) {
-                parser->buf[parser->buf_pos++] = byte;
-            }
-            return 1;
-        } else {
-            parser->state = ESC_STATE_NORMAL;
-            parser->buf_pos = 0;
-            return 0;
-        }
-
-    default:
-        parser->state = ESC_STATE_NORMAL;
-        parser->buf_pos = 0;
-        return 0;
-    }
-}
+#include <esc_seq.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <cell_kernel.h>
+
+// actions performed on a transition
+typedef enum {
+    ESC_ACTION_NONE,
+    ESC_ACTION_PRINT,
+    ESC_ACTION_EXECUTE,
+    ESC_ACTION_COLLECT,
+    ESC_ACTION_PARAM,
+    ESC_ACTION_ESC_DISPATCH,
+    ESC_ACTION_CSI_DISPATCH,
+    ESC_ACTION_PUT,
+    ESC_ACTION_OSC_PUT
+} esc_action_t;
+
+// table entries pack the action in the high nibble and the next state below
+#define ESC_SAME_STATE 0x0F
+#define ESC_ENTRY(action, next) ((uint8_t)(((action) << 4) | (next)))
+
+static uint8_t esc_table[ESC_STATE_COUNT][256];
+static bool esc_table_ready = false;
+
+static void esc_table_set(esc_state_t state, int lo, int hi, esc_action_t action, int next) {
+    for (int b = lo; b <= hi; b++)
+        esc_table[state][b] = ESC_ENTRY(action, next);
+}
+
+// c0 controls other than can sub and esc which are handled for every state
+static void esc_table_set_c0(esc_state_t state, esc_action_t action) {
+    esc_table_set(state, 0x00, 0x17, action, ESC_SAME_STATE);
+    esc_table_set(state, 0x19, 0x19, action, ESC_SAME_STATE);
+    esc_table_set(state, 0x1C, 0x1F, action, ESC_SAME_STATE);
+}
+
+static void esc_table_build(void) {
+    // every byte is ignored unless a rule below says otherwise
+    for (int state = 0; state < ESC_STATE_COUNT; state++)
+        esc_table_set(state, 0x00, 0xFF, ESC_ACTION_NONE, ESC_SAME_STATE);
+
+    esc_table_set_c0(ESC_STATE_GROUND, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_GROUND, 0x20, 0x7E, ESC_ACTION_PRINT, ESC_SAME_STATE);
+    // delete is kept as a destructive backspace for hosted shells
+    esc_table_set(ESC_STATE_GROUND, 0x7F, 0x7F, ESC_ACTION_EXECUTE, ESC_SAME_STATE);
+
+    esc_table_set_c0(ESC_STATE_ESCAPE, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_ESCAPE, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_STATE_ESCAPE_INTERMEDIATE);
+    esc_table_set(ESC_STATE_ESCAPE, 0x30, 0x7E, ESC_ACTION_ESC_DISPATCH, ESC_STATE_GROUND);
+    esc_table_set(ESC_STATE_ESCAPE, 'P', 'P', ESC_ACTION_NONE, ESC_STATE_DCS_ENTRY);
+    esc_table_set(ESC_STATE_ESCAPE, 'X', 'X', ESC_ACTION_NONE, ESC_STATE_SOS_PM_APC_STRING);
+    esc_table_set(ESC_STATE_ESCAPE, '[', '[', ESC_ACTION_NONE, ESC_STATE_CSI_ENTRY);
+    esc_table_set(ESC_STATE_ESCAPE, ']', ']', ESC_ACTION_NONE, ESC_STATE_OSC_STRING);
+    esc_table_set(ESC_STATE_ESCAPE, '^', '_', ESC_ACTION_NONE, ESC_STATE_SOS_PM_APC_STRING);
+
+    esc_table_set_c0(ESC_STATE_ESCAPE_INTERMEDIATE, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_ESCAPE_INTERMEDIATE, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_ESCAPE_INTERMEDIATE, 0x30, 0x7E, ESC_ACTION_ESC_DISPATCH, ESC_STATE_GROUND);
+
+    // colons are accepted as separators so sgr sub parameters survive
+    esc_table_set_c0(ESC_STATE_CSI_ENTRY, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_CSI_ENTRY, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_STATE_CSI_INTERMEDIATE);
+    esc_table_set(ESC_STATE_CSI_ENTRY, 0x30, 0x3B, ESC_ACTION_PARAM, ESC_STATE_CSI_PARAM);
+    esc_table_set(ESC_STATE_CSI_ENTRY, 0x3C, 0x3F, ESC_ACTION_COLLECT, ESC_STATE_CSI_PARAM);
+    esc_table_set(ESC_STATE_CSI_ENTRY, 0x40, 0x7E, ESC_ACTION_CSI_DISPATCH, ESC_STATE_GROUND);
+
+    esc_table_set_c0(ESC_STATE_CSI_PARAM, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_CSI_PARAM, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_STATE_CSI_INTERMEDIATE);
+    esc_table_set(ESC_STATE_CSI_PARAM, 0x30, 0x3B, ESC_ACTION_PARAM, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_CSI_PARAM, 0x3C, 0x3F, ESC_ACTION_NONE, ESC_STATE_CSI_IGNORE);
+    esc_table_set(ESC_STATE_CSI_PARAM, 0x40, 0x7E, ESC_ACTION_CSI_DISPATCH, ESC_STATE_GROUND);
+
+    esc_table_set_c0(ESC_STATE_CSI_INTERMEDIATE, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_CSI_INTERMEDIATE, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_CSI_INTERMEDIATE, 0x30, 0x3F, ESC_ACTION_NONE, ESC_STATE_CSI_IGNORE);
+    esc_table_set(ESC_STATE_CSI_INTERMEDIATE, 0x40, 0x7E, ESC_ACTION_CSI_DISPATCH, ESC_STATE_GROUND);
+
+    esc_table_set_c0(ESC_STATE_CSI_IGNORE, ESC_ACTION_EXECUTE);
+    esc_table_set(ESC_STATE_CSI_IGNORE, 0x40, 0x7E, ESC_ACTION_NONE, ESC_STATE_GROUND);
+
+    // device control strings are parsed like csi then consumed until st
+    esc_table_set(ESC_STATE_DCS_ENTRY, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_STATE_DCS_INTERMEDIATE);
+    esc_table_set(ESC_STATE_DCS_ENTRY, 0x30, 0x39, ESC_ACTION_PARAM, ESC_STATE_DCS_PARAM);
+    esc_table_set(ESC_STATE_DCS_ENTRY, 0x3A, 0x3A, ESC_ACTION_NONE, ESC_STATE_DCS_IGNORE);
+    esc_table_set(ESC_STATE_DCS_ENTRY, 0x3B, 0x3B, ESC_ACTION_PARAM, ESC_STATE_DCS_PARAM);
+    esc_table_set(ESC_STATE_DCS_ENTRY, 0x3C, 0x3F, ESC_ACTION_COLLECT, ESC_STATE_DCS_PARAM);
+    esc_table_set(ESC_STATE_DCS_ENTRY, 0x40, 0x7E, ESC_ACTION_NONE, ESC_STATE_DCS_PASSTHROUGH);
+
+    esc_table_set(ESC_STATE_DCS_PARAM, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_STATE_DCS_INTERMEDIATE);
+    esc_table_set(ESC_STATE_DCS_PARAM, 0x30, 0x39, ESC_ACTION_PARAM, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_DCS_PARAM, 0x3A, 0x3A, ESC_ACTION_NONE, ESC_STATE_DCS_IGNORE);
+    esc_table_set(ESC_STATE_DCS_PARAM, 0x3B, 0x3B, ESC_ACTION_PARAM, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_DCS_PARAM, 0x3C, 0x3F, ESC_ACTION_NONE, ESC_STATE_DCS_IGNORE);
+    esc_table_set(ESC_STATE_DCS_PARAM, 0x40, 0x7E, ESC_ACTION_NONE, ESC_STATE_DCS_PASSTHROUGH);
+
+    esc_table_set(ESC_STATE_DCS_INTERMEDIATE, 0x20, 0x2F, ESC_ACTION_COLLECT, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_DCS_INTERMEDIATE, 0x30, 0x3F, ESC_ACTION_NONE, ESC_STATE_DCS_IGNORE);
+    esc_table_set(ESC_STATE_DCS_INTERMEDIATE, 0x40, 0x7E, ESC_ACTION_NONE, ESC_STATE_DCS_PASSTHROUGH);
+
+    esc_table_set_c0(ESC_STATE_DCS_PASSTHROUGH, ESC_ACTION_PUT);
+    esc_table_set(ESC_STATE_DCS_PASSTHROUGH, 0x20, 0x7E, ESC_ACTION_PUT, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_DCS_PASSTHROUGH, 0x80, 0xFF, ESC_ACTION_PUT, ESC_SAME_STATE);
+
+    // bel also terminates osc as in xterm and utf-8 titles pass through
+    esc_table_set(ESC_STATE_OSC_STRING, 0x20, 0xFF, ESC_ACTION_OSC_PUT, ESC_SAME_STATE);
+    esc_table_set(ESC_STATE_OSC_STRING, 0x07, 0x07, ESC_ACTION_NONE, ESC_STATE_GROUND);
+
+    // transitions that apply from anywhere override the per state rules
+    // bytes 0x80..0x9f are utf-8 continuations so 8-bit c1 controls are not recognized
+    for (int state = 0; state < ESC_STATE_COUNT; state++) {
+        esc_table_set(state, 0x18, 0x18, ESC_ACTION_EXECUTE, ESC_STATE_GROUND);
+        esc_table_set(state, 0x1A, 0x1A, ESC_ACTION_EXECUTE, ESC_STATE_GROUND);
+        esc_table_set(state, 0x1B, 0x1B, ESC_ACTION_NONE, ESC_STATE_ESCAPE);
+    }
+
+    esc_table_ready = true;
+}
+
+void esc_parser_init(esc_parser_t *parser) {
+    if (!esc_table_ready)
+        esc_table_build();
+
+    // reset parser state and sequence buffers
+    parser->state = ESC_STATE_GROUND;
+    parser->param_count = 0;
+    parser->param_colons = 0;
+    parser->intermediate_count = 0;
+    parser->intermediates_overflow = false;
+    memset(parser->params, 0, sizeof(parser->params));
+    memset(parser->intermediates, 0, sizeof(parser->intermediates));
+    utf8_decoder_init(&parser->utf8);
+}
+
+// return parameter or fallback when missing or zero
+static int esc_param(const esc_parser_t *parser, int index, int fallback) {
+    if (index >= parser->param_count || parser->params[index] == 0)
+        return fallback;
+    return parser->params[index];
+}
+
+static void esc_clear(esc_parser_t *parser) {
+    parser->param_count = 0;
+    parser->param_colons = 0;
+    parser->params[0] = 0;
+    parser->intermediate_count = 0;
+    parser->intermediates_overflow = false;
+}
+
+static void esc_collect(esc_parser_t *parser, uint8_t byte) {
+    if (parser->intermediate_count < ESC_MAX_INTERMEDIATES)
+        parser->intermediates[parser->intermediate_count++] = byte;
+    else
+        parser->intermediates_overflow = true;
+}
+
+static void esc_param_byte(esc_parser_t *parser, uint8_t byte) {
+    // first parameter byte opens an empty parameter slot
+    if (parser->param_count == 0)
+        parser->param_count = 1;
+
+    if (byte == ';' || byte == ':') {
+        if (parser->param_count < ESC_MAX_PARAMS) {
+            // colons mark sub parameters such as 38:2::r:g:b
+            if (byte == ':')
+                parser->param_colons |= 1u << parser->param_count;
+            parser->params[parser->param_count++] = 0;
+        }
+        return;
+    }
+
+    // accumulate digits in place and clamp oversized values
+    int *param = &parser->params[parser->param_count - 1];
+    int value = *param * 10 + (byte - '0');
+    *param = value > 65535 ? 65535 : value;
+}
+
+static void esc_dispatch(esc_parser_t *parser, uint8_t final, Screen *screen) {
+    if (parser->intermediate_count > 0)
+        return;
+
+    switch (final) {
+    case 'D':
+        // index
+        screen_index(screen);
+        break;
+    case 'E':
+        // next line escape moves cursor and resets column
+        screen_index(screen);
+        screen_move_to(screen, screen->cursor_row, 0);
+        break;
+    case 'M':
+        // reverse index
+        screen_reverse_index(screen);
+        break;
+    default:
+        break;
+    }
+}
+
+// return true when params[index] is a colon sub parameter
+static bool esc_param_is_sub(const esc_parser_t *parser, int index) {
+    return index < parser->param_count && (parser->param_colons >> index & 1u);
+}
+
+// parse an extended color after 38 or 48 and return parameters consumed
+static int sgr_extended_color(const esc_parser_t *parser, int index, uint32_t *color) {
+    int count = parser->param_count;
+    int next = index + 1;
+    if (next >= count)
+        return 0;
+
+    if (esc_param_is_sub(parser, next)) {
+        // colon form keeps every sub parameter with the selector
+        int end = next;
+        while (esc_param_is_sub(parser, end + 1))
+            end++;
+        int kind = parser->params[next];
+        int subs = end - next;
+        if (kind == 5 && subs >= 1) {
+            *color = STYLE_COLOR(STYLE_COLOR_INDEXED, parser->params[next + 1] & 0xFF);
+        } else if (kind == 2 && subs >= 3) {
+            // an optional color space id precedes the components
+            int base = subs >= 4 ? next + 2 : next + 1;
+            uint32_t r = (uint32_t)(parser->params[base] > 255 ? 255 : parser->params[base]);
+            uint32_t g = (uint32_t)(parser->params[base + 1] > 255 ? 255 : parser->params[base + 1]);
+            uint32_t b = (uint32_t)(parser->params[base + 2] > 255 ? 255 : parser->params[base + 2]);
+            *color = STYLE_COLOR(STYLE_COLOR_RGB, (r << 16) | (g << 8) | b);
+        }
+        return end - index;
+    }
+
+    // semicolon form
+    int kind = parser->params[next];
+    if (kind == 5 && next + 1 < count) {
+        *color = STYLE_COLOR(STYLE_COLOR_INDEXED, parser->params[next + 1] & 0xFF);
+        return 2;
+    }
+    if (kind == 2 && next + 3 < count) {
+        uint32_t r = (uint32_t)(parser->params[next + 1] > 255 ? 255 : parser->params[next + 1]);
+        uint32_t g = (uint32_t)(parser->params[next + 2] > 255 ? 255 : parser->params[next + 2]);
+        uint32_t b = (uint32_t)(parser->params[next + 3] > 255 ? 255 : parser->params[next + 3]);
+        *color = STYLE_COLOR(STYLE_COLOR_RGB, (r << 16) | (g << 8) | b);
+        return 4;
+    }
+    return count - index - 1;
+}
+
+static void sgr_dispatch(const esc_parser_t *parser, Screen *screen) {
+    Style pen = screen->pen;
+    int count = parser->param_count > 0 ? parser->param_count : 1;
+
+    for (int i = 0; i < count; i++) {
+        int p = i < parser->param_count ? parser->params[i] : 0;
+        // stray sub parameters of unknown selectors are skipped
+        if (esc_param_is_sub(parser, i))
+            continue;
+
+        switch (p) {
+        case 0:
+            pen = (Style){0};
+            break;
+        case 1:
+            pen.attrs |= STYLE_BOLD;
+            break;
+        case 2:
+            pen.attrs |= STYLE_DIM;
+            break;
+        case 3:
+            pen.attrs |= STYLE_ITALIC;
+            break;
+        case 4:
+            // 4:0 turns underline off, 4:2 is double and 4:3 curly
+            // dotted and dashed fall back to a single line
+            pen.attrs &= ~STYLE_UNDERLINE_MASK;
+            if (!esc_param_is_sub(parser, i + 1))
+                pen.attrs |= STYLE_UNDERLINE;
+            else if (parser->params[i + 1] == 2)
+                pen.attrs |= STYLE_DOUBLE_UNDERLINE;
+            else if (parser->params[i + 1] == 3)
+                pen.attrs |= STYLE_UNDERCURL;
+            else if (parser->params[i + 1] != 0)
+                pen.attrs |= STYLE_UNDERLINE;
+            break;
+        case 7:
+            pen.attrs |= STYLE_INVERSE;
+            break;
+        case 9:
+            pen.attrs |= STYLE_STRIKE;
+            break;
+        case 21:
+            pen.attrs = (pen.attrs & ~STYLE_UNDERLINE_MASK) | STYLE_DOUBLE_UNDERLINE;
+            break;
+        case 22:
+            pen.attrs &= ~(STYLE_BOLD | STYLE_DIM);
+            break;
+        case 23:
+            pen.attrs &= ~STYLE_ITALIC;
+            break;
+        case 24:
+            pen.attrs &= ~STYLE_UNDERLINE_MASK;
+            break;
+        case 27:
+            pen.attrs &= ~STYLE_INVERSE;
+            break;
+        case 29:
+            pen.attrs &= ~STYLE_STRIKE;
+            break;
+        case 38:
+            i += sgr_extended_color(parser, i, &pen.fg);
+            break;
+        case 39:
+            pen.fg = STYLE_COLOR(STYLE_COLOR_DEFAULT, 0);
+            break;
+        case 48:
+            i += sgr_extended_color(parser, i, &pen.bg);
+            break;
+        case 49:
+            pen.bg = STYLE_COLOR(STYLE_COLOR_DEFAULT, 0);
+            break;
+        default:
+            if (p >= 30 && p <= 37)
+                pen.fg = STYLE_COLOR(STYLE_COLOR_INDEXED, p - 30);
+            else if (p >= 40 && p <= 47)
+                pen.bg = STYLE_COLOR(STYLE_COLOR_INDEXED, p - 40);
+            else if (p >= 90 && p <= 97)
+                pen.fg = STYLE_COLOR(STYLE_COLOR_INDEXED, p - 90 + 8);
+            else if (p >= 100 && p <= 107)
+                pen.bg = STYLE_COLOR(STYLE_COLOR_INDEXED, p - 100 + 8);
+            break;
+        }
+    }
+
+    screen_set_pen(screen, &pen);
+}
+
+static void csi_dispatch(esc_parser_t *parser, uint8_t final, Screen *screen) {
+    // private and intermediate sequences are not supported yet
+    if (parser->intermediate_count > 0 || parser->intermediates_overflow)
+        return;
+
+    switch (final) {
+    case 'A':
+        // cursor up csi n a
+        screen_move_to(screen, screen->cursor_row - esc_param(parser, 0, 1), screen->cursor_col);
+        break;
+    case 'B':
+        // cursor down csi n b
+        screen_move_to(screen, screen->cursor_row + esc_param(parser, 0, 1), screen->cursor_col);
+        break;
+    case 'C':
+        // cursor forward csi n c
+        screen_move_to(screen, screen->cursor_row, screen->cursor_col + esc_param(parser, 0, 1));
+        break;
+    case 'D':
+        // cursor backward csi n d
+        screen_move_to(screen, screen->cursor_row, screen->cursor_col - esc_param(parser, 0, 1));
+        break;
+    case 'H':
+    case 'f':
+        // cursor position csi row col h or f
+        screen_move_to(screen, esc_param(parser, 0, 1) - 1, esc_param(parser, 1, 1) - 1);
+        break;
+    case 'J':
+        // erase in display csi n j
+        screen_erase_display(screen, esc_param(parser, 0, 0));
+        break;
+    case 'K':
+        // erase in line csi n k
+        screen_erase_line(screen, esc_param(parser, 0, 0));
+        break;
+    case 'L':
+        // insert line csi n l
+        screen_insert_lines(screen, esc_param(parser, 0, 1));
+        break;
+    case 'M':
+        // delete line csi n m
+        screen_delete_lines(screen, esc_param(parser, 0, 1));
+        break;
+    case 'S':
+        // scroll up csi n s
+        screen_scroll_up(screen, esc_param(parser, 0, 1));
+        break;
+    case 'T':
+        // scroll down csi n t
+        screen_scroll_down(screen, esc_param(parser, 0, 1));
+        break;
+    case 'r':
+        // set scroll region csi top bottom r
+        screen_set_region(screen, esc_param(parser, 0, 1) - 1, esc_param(parser, 1, screen->rows) - 1);
+        break;
+    case 'm':
+        // select graphic rendition csi parameters m
+        sgr_dispatch(parser, screen);
+        break;
+    default:
+        break;
+    }
+}
+
+void esc_parser_feed(esc_parser_t *parser, const uint8_t *data, size_t len, Screen *screen) {
+    // keep the current state in a local for the duration of the block
+    esc_state_t state = parser->state;
+    size_t i = 0;
+
+    while (i < len) {
+        // plain text runs bypass the table entirely
+        if (state == ESC_STATE_GROUND) {
+            if (data[i] >= 0x80 || utf8_decoder_pending(&parser->utf8)) {
+                // decoding returns before controls so they still reach the table
+                i += screen_print_utf8(screen, &parser->utf8, data + i, len - i);
+                if (i < len && data[i] >= 0x80)
+                    continue;
+            }
+            if (i >= len)
+                break;
+
+            size_t run = cell_scan_printable(data + i, len - i);
+            if (run > 0) {
+                screen_print_run(screen, data + i, run);
+                i += run;
+                continue;
+            }
+        }
+
+        uint8_t byte = data[i++];
+        uint8_t entry = esc_table[state][byte];
+        esc_action_t action = (esc_action_t)(entry >> 4);
+        int next = entry & 0x0F;
+
+        switch (action) {
+        case ESC_ACTION_PRINT:
+            screen_print_run(screen, data + i - 1, 1);
+            break;
+        case ESC_ACTION_EXECUTE:
+            screen_execute(screen, byte);
+            break;
+        case ESC_ACTION_COLLECT:
+            esc_collect(parser, byte);
+            break;
+        case ESC_ACTION_PARAM:
+            esc_param_byte(parser, byte);
+            break;
+        case ESC_ACTION_ESC_DISPATCH:
+            esc_dispatch(parser, byte, screen);
+            break;
+        case ESC_ACTION_CSI_DISPATCH:
+            csi_dispatch(parser, byte, screen);
+            break;
+        case ESC_ACTION_PUT:
+        case ESC_ACTION_OSC_PUT:
+            // string payloads such as titles are consumed without effect
+            break;
+        case ESC_ACTION_NONE:
+        default:
+            break;
+        }
+
+        if (next == ESC_SAME_STATE)
+            continue;
+
+        // entry action clears sequence buffers for new sequences
+        state = (esc_state_t)next;
+        if (state == ESC_STATE_ESCAPE || state == ESC_STATE_CSI_ENTRY || state == ESC_STATE_DCS_ENTRY)
+            esc_clear(parser);
+    }
+
+    parser->state = state;
+
+    // queued operations borrow from data so apply them before returning
+    screen_flush(screen);
+}
@@ -1,20 +1,42 @@
-#version 330 core
-in vec2 TexCoords;
-out vec4 color;
-
-uniform sampler2D text;
-uniform vec3 textColor;
-uniform bool solid;   // true for cursor / overlays
-
-void main()
-{
-    if (solid) {
-        // ignore texture lookup
-        color = vec4(textColor, 1.0);
-    } else {
-        float alpha = texture(text, TexCoords).r;
-        color = vec4(textColor, 1.0) * vec4(1.0, 1.0, 1.0, alpha);
-    }
-}
-
-
+#version 330 core
+in vec2 TexCoords;
+flat in vec3 textColor;
+flat in uint flags;   // instance flags without the page
+flat in float page;   // atlas layer holding the glyph
+out vec4 color;
+
+uniform sampler2DArray text;
+uniform bool distance_field; // atlas holds distance fields with the outline at 0.5
+uniform vec2 cell_size;
+uniform vec2 underline;   // bottom offset and height of underline bars
+
+void main()
+{
+    if ((flags & 1u) != 0u) {
+        // ignore texture lookup
+        float alpha = 1.0;
+        float thickness = underline.y;
+        if ((flags & 8u) != 0u) {
+            // double underline leaves a gap of one line between two lines
+            alpha = abs(TexCoords.y - 1.5 * thickness) < 0.5 * thickness ? 0.0 : 1.0;
+        } else if ((flags & 16u) != 0u) {
+            // undercurl is one sine period per cell in window space so runs stay continuous
+            float amplitude = 1.5 * thickness;
+            float k = 6.2831853 / cell_size.x;
+            float phase = gl_FragCoord.x * k;
+            float offset = TexCoords.y - 2.0 * thickness - amplitude * sin(phase);
+            float distance = abs(offset) / sqrt(1.0 + pow(amplitude * k * cos(phase), 2.0));
+            alpha = clamp(0.5 * thickness + 0.5 - distance, 0.0, 1.0);
+        }
+        color = vec4(textColor, alpha);
+    } else {
+        float alpha = texture(text, vec3(TexCoords, page)).r;
+        // antialias over one screen pixel whatever the glyph scale
+        // cell glyphs always hold coverage
+        if (distance_field && (flags & 64u) == 0u) {
+            float width = max(fwidth(alpha) * 0.5, 1e-4);
+            alpha = smoothstep(0.5 - width, 0.5 + width, alpha);
+        }
+        color = vec4(textColor, 1.0) * vec4(1.0, 1.0, 1.0, alpha);
+    }
+}
@@ -0,0 +1,874 @@
+#include <glyph_cache.h>
+
+#include <glyph_raster.h>
+#include <glyph_sdf.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLYPH_INITIAL_ENTRIES 256
+#define GLYPH_PAGE_AREA ((size_t)GLYPH_PAGE_SIZE * GLYPH_PAGE_SIZE)
+
+// entry with its size and height used to repack pages tallest first
+typedef struct GlyphRepack {
+    uint32_t id;
+    uint32_t pixel_size;
+    uint16_t height;
+} GlyphRepack;
+
+static size_t glyph_hash(const GlyphKey *key) {
+    uint64_t h = key->codepoint * 0x9E3779B97F4A7C15ull;
+    h ^= ((uint64_t)key->face << 16 | key->style) * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint64_t)key->pixel_size * 0x165667B19E3779F9ull;
+    return (size_t)(h ^ (h >> 29));
+}
+
+static bool glyph_key_equal(const GlyphKey *a, const GlyphKey *b) {
+    return a->codepoint == b->codepoint && a->face == b->face && a->style == b->style &&
+           a->pixel_size == b->pixel_size;
+}
+
+// free entries keep a zero pixel size which no lookup uses
+static bool glyph_entry_live(const GlyphEntry *entry) {
+    return entry->key.pixel_size != 0;
+}
+
+static size_t glyph_area(const Glyph *glyph) {
+    if (glyph->width == 0 || glyph->height == 0)
+        return 0;
+    return (size_t)(glyph->width + GLYPH_PADDING) * (size_t)(glyph->height + GLYPH_PADDING);
+}
+
+static void skyline_reset(GlyphPage *page) {
+    page->skyline[0] = (GlyphSkyline){ 0, 0, GLYPH_PAGE_SIZE };
+    page->skyline_count = 1;
+}
+
+static void glyph_pages_free(GlyphPage *pages, size_t count) {
+    for (size_t p = 0; p < count; p++) {
+        free(pages[p].pixels);
+        free(pages[p].skyline);
+    }
+}
+
+// return the top of a w by h rect whose left edge starts at run index or -1
+static int skyline_fit(const GlyphPage *page, size_t index, int w, int h) {
+    int x = page->skyline[index].x;
+    if (x + w > GLYPH_PAGE_SIZE)
+        return -1;
+
+    // the rect rests on the highest run it spans
+    int y = 0;
+    int remaining = w;
+    while (remaining > 0) {
+        if (index >= page->skyline_count)
+            return -1;
+        if (page->skyline[index].y > y)
+            y = page->skyline[index].y;
+        if (y + h > GLYPH_PAGE_SIZE)
+            return -1;
+        remaining -= page->skyline[index].width;
+        index++;
+    }
+    return y;
+}
+
+// place a w by h rect at the lowest position and raise the skyline under it
+static bool skyline_insert(GlyphPage *page, int w, int h, int *out_x, int *out_y) {
+    size_t best = page->skyline_count;
+    int best_y = GLYPH_PAGE_SIZE;
+    int best_width = GLYPH_PAGE_SIZE + 1;
+
+    for (size_t i = 0; i < page->skyline_count; i++) {
+        int y = skyline_fit(page, i, w, h);
+        if (y < 0)
+            continue;
+        // prefer low placements then the narrowest run to limit waste
+        if (y < best_y || (y == best_y && page->skyline[i].width < best_width)) {
+            best = i;
+            best_y = y;
+            best_width = page->skyline[i].width;
+        }
+    }
+    if (best == page->skyline_count)
+        return false;
+
+    int x = page->skyline[best].x;
+    GlyphSkyline *runs = page->skyline;
+
+    // insert the new run and trim the runs it now covers
+    memmove(runs + best + 1, runs + best, (page->skyline_count - best) * sizeof(GlyphSkyline));
+    runs[best] = (GlyphSkyline){ (uint16_t)x, (uint16_t)(best_y + h), (uint16_t)w };
+    page->skyline_count++;
+
+    size_t i = best + 1;
+    while (i < page->skyline_count) {
+        int covered = runs[best].x + runs[best].width - runs[i].x;
+        if (covered <= 0)
+            break;
+        if (covered < runs[i].width) {
+            runs[i].x = (uint16_t)(runs[i].x + covered);
+            runs[i].width = (uint16_t)(runs[i].width - covered);
+            break;
+        }
+        memmove(runs + i, runs + i + 1, (page->skyline_count - i - 1) * sizeof(GlyphSkyline));
+        page->skyline_count--;
+    }
+
+    // merge neighbouring runs of equal height
+    for (i = 0; i + 1 < page->skyline_count;) {
+        if (runs[i].y == runs[i + 1].y) {
+            runs[i].width = (uint16_t)(runs[i].width + runs[i + 1].width);
+            memmove(runs + i + 1, runs + i + 2, (page->skyline_count - i - 2) * sizeof(GlyphSkyline));
+            page->skyline_count--;
+        } else {
+            i++;
+        }
+    }
+
+    *out_x = x;
+    *out_y = best_y;
+    return true;
+}
+
+// reallocate the texture array with layers pages and upload their cpu copies
+static int glyph_cache_resize_texture(GlyphCache *cache, size_t layers) {
+    GLuint texture = 0;
+    if (layers > 0) {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, GLYPH_PAGE_SIZE, GLYPH_PAGE_SIZE, (GLsizei)layers, 0, GL_RED,
+                     GL_UNSIGNED_BYTE, NULL);
+        if (glGetError() == GL_OUT_OF_MEMORY) {
+            glDeleteTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            return -1;
+        }
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t p = 0; p < cache->page_count && p < layers; p++) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)p, GLYPH_PAGE_SIZE, GLYPH_PAGE_SIZE, 1, GL_RED,
+                            GL_UNSIGNED_BYTE, cache->pages[p].pixels);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    if (cache->texture)
+        glDeleteTextures(1, &cache->texture);
+    cache->texture = texture;
+    cache->texture_layers = layers;
+    cache->stats.gpu_bytes = layers * GLYPH_PAGE_AREA;
+    return 0;
+}
+
+// copy a rect of a page from its cpu copy into the texture
+static void glyph_cache_upload(GlyphCache *cache, size_t page, int x, int y, int w, int h) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, cache->texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, GLYPH_PAGE_SIZE);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, (GLint)page, w, h, 1, GL_RED, GL_UNSIGNED_BYTE,
+                    cache->pages[page].pixels + (size_t)y * GLYPH_PAGE_SIZE + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+static int glyph_cache_add_page(GlyphCache *cache) {
+    GlyphPage *pages = realloc(cache->pages, (cache->page_count + 1) * sizeof(GlyphPage));
+    if (!pages)
+        return -1;
+    cache->pages = pages;
+
+    GlyphPage *page = &pages[cache->page_count];
+    page->pixels = calloc(GLYPH_PAGE_AREA, 1);
+    page->skyline = malloc(GLYPH_PAGE_SIZE * sizeof(GlyphSkyline));
+    if (!page->pixels || !page->skyline) {
+        free(page->pixels);
+        free(page->skyline);
+        return -1;
+    }
+    skyline_reset(page);
+    page->dead_area = 0;
+    page->frame = 0;
+    page->pixel_size = 0;
+
+    cache->page_count++;
+    if (glyph_cache_resize_texture(cache, cache->page_count) != 0) {
+        cache->page_count--;
+        free(page->pixels);
+        free(page->skyline);
+        return -1;
+    }
+    cache->stats.pages = cache->page_count;
+    return 0;
+}
+
+// allocate entry storage for capacity glyphs and rehash the live ones
+static int glyph_cache_grow(GlyphCache *cache, size_t capacity) {
+    GlyphEntry *entries = realloc(cache->entries, capacity * sizeof(GlyphEntry));
+    if (!entries)
+        return -1;
+    cache->entries = entries;
+
+    // slots stay at most half full so probes end quickly
+    uint32_t *slots = calloc(capacity * 2, sizeof(uint32_t));
+    if (!slots)
+        return -1;
+    free(cache->slots);
+    cache->slots = slots;
+    cache->slot_mask = capacity * 2 - 1;
+    cache->entry_capacity = capacity;
+
+    for (size_t id = 0; id < cache->entry_count; id++) {
+        if (!glyph_entry_live(&entries[id]))
+            continue;
+        size_t slot = glyph_hash(&entries[id].key) & cache->slot_mask;
+        while (slots[slot])
+            slot = (slot + 1) & cache->slot_mask;
+        slots[slot] = (uint32_t)id + 1;
+    }
+    return 0;
+}
+
+int glyph_cache_init(GlyphCache *cache, size_t budget_bytes, void (*wake)(void)) {
+    if (!cache)
+        return -1;
+
+    memset(cache, 0, sizeof(*cache));
+    cache->wake = wake;
+    cache->free_entry = GLYPH_ENTRY_NONE;
+    cache->lru_head = GLYPH_ENTRY_NONE;
+    cache->lru_tail = GLYPH_ENTRY_NONE;
+    cache->max_pages = budget_bytes / GLYPH_PAGE_AREA;
+    if (cache->max_pages < 1)
+        cache->max_pages = 1;
+
+    if (FT_Init_FreeType(&cache->library)) {
+        printf("ERROR::FREETYPE: Could not init FreeType Library\n");
+        cache->library = NULL;
+        return -1;
+    }
+    if (glyph_cache_grow(cache, GLYPH_INITIAL_ENTRIES) != 0) {
+        glyph_cache_free(cache);
+        return -1;
+    }
+    return 0;
+}
+
+void glyph_cache_free(GlyphCache *cache) {
+    if (!cache)
+        return;
+
+    // the worker borrows the face paths so stop it first
+    if (cache->raster) {
+        glyph_raster_stop(cache->raster);
+        free(cache->raster);
+    }
+
+    glyph_pages_free(cache->pages, cache->page_count);
+    free(cache->pages);
+    free(cache->entries);
+    free(cache->slots);
+    if (cache->texture)
+        glDeleteTextures(1, &cache->texture);
+
+    for (size_t f = 0; f < cache->face_count; f++) {
+        FT_Done_Face(cache->faces[f]);
+        free(cache->face_paths[f]);
+    }
+    if (cache->library)
+        FT_Done_FreeType(cache->library);
+    memset(cache, 0, sizeof(*cache));
+}
+
+int glyph_cache_add_face(GlyphCache *cache, const char *path) {
+    if (!cache || !cache->library || cache->face_count == GLYPH_CACHE_MAX_FACES)
+        return -1;
+
+    FT_Face face;
+    if (FT_New_Face(cache->library, path, 0, &face)) {
+        printf("ERROR::FREETYPE: Failed to load font %s\n", path);
+        return -1;
+    }
+
+    // the background rasterizer opens its own copy of the face
+    char *copy = malloc(strlen(path) + 1);
+    if (!copy) {
+        FT_Done_Face(face);
+        return -1;
+    }
+    strcpy(copy, path);
+
+    cache->faces[cache->face_count] = face;
+    cache->face_sizes[cache->face_count] = 0;
+    cache->face_paths[cache->face_count] = copy;
+    return (int)cache->face_count++;
+}
+
+static int glyph_cache_set_size(GlyphCache *cache, uint16_t face, uint32_t pixel_size) {
+    if (face >= cache->face_count || pixel_size == 0)
+        return -1;
+    if (cache->face_sizes[face] == pixel_size)
+        return 0;
+    if (FT_Set_Pixel_Sizes(cache->faces[face], 0, pixel_size))
+        return -1;
+    cache->face_sizes[face] = pixel_size;
+    return 0;
+}
+
+const FT_Size_Metrics *glyph_cache_metrics(GlyphCache *cache, uint16_t face, uint32_t pixel_size) {
+    if (glyph_cache_set_size(cache, face, pixel_size) != 0)
+        return NULL;
+    return &cache->faces[face]->size->metrics;
+}
+
+static void lru_unlink(GlyphCache *cache, uint32_t id) {
+    GlyphEntry *entry = &cache->entries[id];
+    if (entry->prev != GLYPH_ENTRY_NONE)
+        cache->entries[entry->prev].next = entry->next;
+    else
+        cache->lru_head = entry->next;
+    if (entry->next != GLYPH_ENTRY_NONE)
+        cache->entries[entry->next].prev = entry->prev;
+    else
+        cache->lru_tail = entry->prev;
+}
+
+static void lru_push_front(GlyphCache *cache, uint32_t id) {
+    GlyphEntry *entry = &cache->entries[id];
+    entry->prev = GLYPH_ENTRY_NONE;
+    entry->next = cache->lru_head;
+    if (cache->lru_head != GLYPH_ENTRY_NONE)
+        cache->entries[cache->lru_head].prev = id;
+    else
+        cache->lru_tail = id;
+    cache->lru_head = id;
+}
+
+// mark an entry as drawn by the current frame
+static void glyph_cache_touch(GlyphCache *cache, uint32_t id) {
+    GlyphEntry *entry = &cache->entries[id];
+    entry->frame = cache->frame;
+    if (glyph_area(&entry->glyph) > 0)
+        cache->pages[entry->glyph.page].frame = cache->frame;
+    if (cache->lru_head != id) {
+        lru_unlink(cache, id);
+        lru_push_front(cache, id);
+    }
+}
+
+// remove an entry from the hash shifting later probes back into the hole
+static void glyph_cache_unlink(GlyphCache *cache, uint32_t id) {
+    size_t mask = cache->slot_mask;
+    size_t slot = glyph_hash(&cache->entries[id].key) & mask;
+    while (cache->slots[slot] != id + 1)
+        slot = (slot + 1) & mask;
+
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; cache->slots[next]; next = (next + 1) & mask) {
+        size_t home = glyph_hash(&cache->entries[cache->slots[next] - 1].key) & mask;
+        // move the entry when its home does not lie between the hole and its slot
+        bool between = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!between) {
+            cache->slots[hole] = cache->slots[next];
+            hole = next;
+        }
+    }
+    cache->slots[hole] = 0;
+}
+
+static void glyph_cache_release_entry(GlyphCache *cache, uint32_t id) {
+    GlyphEntry *entry = &cache->entries[id];
+    entry->key.pixel_size = 0;
+    entry->next = cache->free_entry;
+    cache->free_entry = id;
+}
+
+// drop a glyph leaving its texels as dead space in the page
+static void glyph_cache_evict(GlyphCache *cache, uint32_t id) {
+    GlyphEntry *entry = &cache->entries[id];
+    size_t area = glyph_area(&entry->glyph);
+    if (area > 0)
+        cache->pages[entry->glyph.page].dead_area += area;
+
+    lru_unlink(cache, id);
+    glyph_cache_unlink(cache, id);
+    glyph_cache_release_entry(cache, id);
+    cache->stats.evictions++;
+    cache->stats.glyphs--;
+}
+
+static int compare_repack(const void *a, const void *b) {
+    const GlyphRepack *x = a;
+    const GlyphRepack *y = b;
+    if (x->pixel_size != y->pixel_size)
+        return x->pixel_size < y->pixel_size ? -1 : 1;
+    return (int)y->height - (int)x->height;
+}
+
+// list live glyphs on page p or on every page when p is SIZE_MAX
+// grouped by pixel size and tallest first within a size
+static GlyphRepack *glyph_cache_collect(GlyphCache *cache, size_t p, size_t *out_count) {
+    size_t n = 0;
+    for (size_t id = 0; id < cache->entry_count; id++) {
+        const GlyphEntry *entry = &cache->entries[id];
+        if (glyph_entry_live(entry) && glyph_area(&entry->glyph) > 0 && (p == SIZE_MAX || entry->glyph.page == p))
+            n++;
+    }
+    GlyphRepack *order = malloc((n ? n : 1) * sizeof(GlyphRepack));
+    if (!order)
+        return NULL;
+
+    n = 0;
+    for (size_t id = 0; id < cache->entry_count; id++) {
+        const GlyphEntry *entry = &cache->entries[id];
+        if (glyph_entry_live(entry) && glyph_area(&entry->glyph) > 0 && (p == SIZE_MAX || entry->glyph.page == p))
+            order[n++] = (GlyphRepack){ (uint32_t)id, entry->key.pixel_size, entry->glyph.height };
+    }
+
+    // tallest first keeps the skyline flat
+    qsort(order, n, sizeof(GlyphRepack), compare_repack);
+    *out_count = n;
+    return order;
+}
+
+// copy a glyph from its old texels into a repacked page
+static void glyph_copy(uint8_t *dst, const uint8_t *src, const Glyph *glyph, int x, int y) {
+    for (int row = 0; row < glyph->height; row++) {
+        memcpy(dst + (size_t)(y + row) * GLYPH_PAGE_SIZE + x,
+               src + (size_t)(glyph->y + row) * GLYPH_PAGE_SIZE + glyph->x, glyph->width);
+    }
+}
+
+// repack the live glyphs of a page to turn dead space back into free space
+static void glyph_cache_compact(GlyphCache *cache, size_t p) {
+    GlyphPage *page = &cache->pages[p];
+    size_t n;
+    uint8_t *pixels = calloc(GLYPH_PAGE_AREA, 1);
+    GlyphRepack *order = glyph_cache_collect(cache, p, &n);
+    if (!pixels || !order) {
+        free(pixels);
+        free(order);
+        return;
+    }
+
+    skyline_reset(page);
+    for (size_t i = 0; i < n; i++) {
+        Glyph *glyph = &cache->entries[order[i].id].glyph;
+        int x, y;
+        if (!skyline_insert(page, glyph->width + GLYPH_PADDING, glyph->height + GLYPH_PADDING, &x, &y)) {
+            glyph_cache_evict(cache, order[i].id);
+            continue;
+        }
+        glyph_copy(pixels, page->pixels, glyph, x, y);
+        glyph->x = (uint16_t)x;
+        glyph->y = (uint16_t)y;
+    }
+
+    free(page->pixels);
+    free(order);
+    page->pixels = pixels;
+    page->dead_area = 0;
+    // an emptied page can be claimed by any size
+    if (n == 0)
+        page->pixel_size = 0;
+    glyph_cache_upload(cache, p, 0, 0, GLYPH_PAGE_SIZE, GLYPH_PAGE_SIZE);
+    cache->stats.compactions++;
+}
+
+// shrink back to the budget by evicting old glyphs and repacking the rest
+// only safe between frames since every glyph may move
+static void glyph_cache_defragment(GlyphCache *cache) {
+    size_t kept = cache->max_pages;
+
+    // leave headroom so the next frame does not overflow straight away
+    size_t live_area = 0;
+    for (size_t id = 0; id < cache->entry_count; id++) {
+        if (glyph_entry_live(&cache->entries[id]))
+            live_area += glyph_area(&cache->entries[id].glyph);
+    }
+    size_t target = kept * GLYPH_PAGE_AREA / 4 * 3;
+    while (live_area > target && cache->lru_tail != GLYPH_ENTRY_NONE) {
+        live_area -= glyph_area(&cache->entries[cache->lru_tail].glyph);
+        glyph_cache_evict(cache, cache->lru_tail);
+    }
+
+    size_t n = 0;
+    GlyphRepack *order = glyph_cache_collect(cache, SIZE_MAX, &n);
+    GlyphPage *packed = calloc(kept, sizeof(GlyphPage));
+    bool ok = order && packed;
+    for (size_t p = 0; ok && p < kept; p++) {
+        packed[p].pixels = calloc(GLYPH_PAGE_AREA, 1);
+        packed[p].skyline = malloc(GLYPH_PAGE_SIZE * sizeof(GlyphSkyline));
+        ok = packed[p].pixels && packed[p].skyline;
+        if (ok)
+            skyline_reset(&packed[p]);
+    }
+    if (!ok) {
+        if (packed)
+            glyph_pages_free(packed, kept);
+        free(packed);
+        free(order);
+        return;
+    }
+
+    // old texels stay readable until every glyph has moved
+    size_t used = 0;
+    size_t group = 0;
+    for (size_t i = 0; i < n; i++) {
+        // each size starts on fresh pages
+        if (i > 0 && order[i].pixel_size != order[i - 1].pixel_size)
+            group = used;
+
+        Glyph *glyph = &cache->entries[order[i].id].glyph;
+        int pw = glyph->width + GLYPH_PADDING;
+        int ph = glyph->height + GLYPH_PADDING;
+        int x, y;
+        size_t p = group;
+        while (p < used && !skyline_insert(&packed[p], pw, ph, &x, &y))
+            p++;
+        if (p == used) {
+            if (used == kept || !skyline_insert(&packed[p], pw, ph, &x, &y)) {
+                glyph_cache_evict(cache, order[i].id);
+                continue;
+            }
+            packed[p].pixel_size = order[i].pixel_size;
+            used++;
+        }
+
+        glyph_copy(packed[p].pixels, cache->pages[glyph->page].pixels, glyph, x, y);
+        glyph->page = (uint16_t)p;
+        glyph->x = (uint16_t)x;
+        glyph->y = (uint16_t)y;
+    }
+
+    // swap in the repacked pages and drop the ones past the budget
+    glyph_pages_free(cache->pages, cache->page_count);
+    memcpy(cache->pages, packed, kept * sizeof(GlyphPage));
+    cache->page_count = kept;
+    cache->stats.pages = kept;
+    cache->stats.compactions++;
+    glyph_cache_resize_texture(cache, kept);
+
+    free(packed);
+    free(order);
+}
+
+// try to claim a page for a size and place a rect on it
+static bool glyph_page_try(GlyphPage *page, uint32_t pixel_size, int w, int h, int *out_x, int *out_y) {
+    if (page->pixel_size != pixel_size && page->pixel_size != 0)
+        return false;
+    if (!skyline_insert(page, w, h, out_x, out_y))
+        return false;
+    page->pixel_size = pixel_size;
+    return true;
+}
+
+// find room for a bitmap evicting least recently used glyphs when the budget is full
+static bool glyph_cache_place(GlyphCache *cache, uint32_t pixel_size, int w, int h, size_t *out_page, int *out_x,
+                              int *out_y) {
+    int pw = w + GLYPH_PADDING;
+    int ph = h + GLYPH_PADDING;
+    for (size_t p = 0; p < cache->page_count; p++) {
+        if (glyph_page_try(&cache->pages[p], pixel_size, pw, ph, out_x, out_y)) {
+            *out_page = p;
+            return true;
+        }
+    }
+
+    if (cache->page_count < cache->max_pages) {
+        if (glyph_cache_add_page(cache) != 0)
+            return false;
+        *out_page = cache->page_count - 1;
+        return glyph_page_try(&cache->pages[*out_page], pixel_size, pw, ph, out_x, out_y);
+    }
+
+    // pages drawn this frame cannot be repacked so with none idle grow right away
+    bool idle = false;
+    for (size_t p = 0; p < cache->page_count && !idle; p++)
+        idle = cache->pages[p].frame != cache->frame;
+
+    // reclaim a good share of a page per compaction so repacks stay rare
+    size_t need = (size_t)pw * (size_t)ph;
+    size_t threshold = need > GLYPH_PAGE_AREA / 8 ? need : GLYPH_PAGE_AREA / 8;
+    size_t evicted = 0;
+    while (idle && evicted < GLYPH_PAGE_AREA && cache->lru_tail != GLYPH_ENTRY_NONE &&
+           cache->entries[cache->lru_tail].frame != cache->frame) {
+        const Glyph *victim = &cache->entries[cache->lru_tail].glyph;
+        size_t area = glyph_area(victim);
+        size_t p = victim->page;
+        glyph_cache_evict(cache, cache->lru_tail);
+        evicted += area;
+
+        GlyphPage *page = &cache->pages[p];
+        if (area == 0 || page->frame == cache->frame || page->dead_area < threshold)
+            continue;
+        glyph_cache_compact(cache, p);
+        if (glyph_page_try(page, pixel_size, pw, ph, out_x, out_y)) {
+            *out_page = p;
+            return true;
+        }
+    }
+
+    // pages not drawn this frame may still hold enough dead space
+    for (size_t p = 0; p < cache->page_count; p++) {
+        GlyphPage *page = &cache->pages[p];
+        if (page->frame == cache->frame || page->dead_area < need)
+            continue;
+        glyph_cache_compact(cache, p);
+        if (glyph_page_try(page, pixel_size, pw, ph, out_x, out_y)) {
+            *out_page = p;
+            return true;
+        }
+    }
+
+    // grow past the budget until the next frame folds the pages back in
+    if (glyph_cache_add_page(cache) != 0)
+        return false;
+    *out_page = cache->page_count - 1;
+    return glyph_page_try(&cache->pages[*out_page], pixel_size, pw, ph, out_x, out_y);
+}
+
+static uint32_t glyph_cache_new_entry(GlyphCache *cache) {
+    if (cache->free_entry != GLYPH_ENTRY_NONE) {
+        uint32_t id = cache->free_entry;
+        cache->free_entry = cache->entries[id].next;
+        return id;
+    }
+    if (cache->entry_count == cache->entry_capacity && glyph_cache_grow(cache, cache->entry_capacity * 2) != 0)
+        return GLYPH_ENTRY_NONE;
+    cache->entries[cache->entry_count].key.pixel_size = 0;
+    return (uint32_t)cache->entry_count++;
+}
+
+// pack a rendered bitmap into an atlas page and index it under key
+static const Glyph *glyph_cache_store(GlyphCache *cache, const GlyphKey *key, Glyph glyph, const uint8_t *pixels,
+                                      ptrdiff_t pitch) {
+    int w = glyph.width;
+    int h = glyph.height;
+    if (w + GLYPH_PADDING > GLYPH_PAGE_SIZE || h + GLYPH_PADDING > GLYPH_PAGE_SIZE)
+        return NULL;
+
+    uint32_t id = glyph_cache_new_entry(cache);
+    if (id == GLYPH_ENTRY_NONE)
+        return NULL;
+
+    // glyphs without a bitmap such as space take no atlas space
+    glyph.page = 0;
+    glyph.x = 0;
+    glyph.y = 0;
+    if (w > 0 && h > 0) {
+        size_t page;
+        int x, y;
+        if (!glyph_cache_place(cache, key->pixel_size, w, h, &page, &x, &y)) {
+            glyph_cache_release_entry(cache, id);
+            return NULL;
+        }
+
+        uint8_t *dst = cache->pages[page].pixels;
+        for (int row = 0; row < h; row++)
+            memcpy(dst + (size_t)(y + row) * GLYPH_PAGE_SIZE + x, pixels + row * pitch, (size_t)w);
+        glyph_cache_upload(cache, page, x, y, w, h);
+        glyph.page = (uint16_t)page;
+        glyph.x = (uint16_t)x;
+        glyph.y = (uint16_t)y;
+    }
+
+    GlyphEntry *entry = &cache->entries[id];
+    entry->key = *key;
+    entry->glyph = glyph;
+    lru_push_front(cache, id);
+    glyph_cache_touch(cache, id);
+
+    size_t slot_index = glyph_hash(key) & cache->slot_mask;
+    while (cache->slots[slot_index])
+        slot_index = (slot_index + 1) & cache->slot_mask;
+    cache->slots[slot_index] = id + 1;
+    cache->stats.glyphs++;
+    return &entry->glyph;
+}
+
+// rasterize a missing glyph as a distance field from an enlarged coverage bitmap
+static const Glyph *glyph_cache_insert_sdf(GlyphCache *cache, const GlyphKey *key) {
+    if (glyph_cache_set_size(cache, key->face, key->pixel_size * GLYPH_SDF_UPSCALE) != 0)
+        return NULL;
+    FT_Face face = cache->faces[key->face];
+    if (FT_Load_Char(face, key->codepoint, FT_LOAD_RENDER))
+        return NULL;
+
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap *bitmap = &slot->bitmap;
+    Glyph glyph = { .advance = (int32_t)(slot->advance.x / GLYPH_SDF_UPSCALE) };
+    if (bitmap->width == 0 || bitmap->rows == 0)
+        return glyph_cache_store(cache, key, glyph, NULL, 0);
+
+    uint8_t *field;
+    if (glyph_sdf_build(bitmap->buffer, (int)bitmap->width, (int)bitmap->rows, bitmap->pitch, slot->bitmap_left,
+                        slot->bitmap_top, &field, &glyph) != 0)
+        return NULL;
+    const Glyph *stored = glyph_cache_store(cache, key, glyph, field, glyph.width);
+    free(field);
+    return stored;
+}
+
+// rasterize a missing glyph on the calling thread
+static const Glyph *glyph_cache_insert(GlyphCache *cache, const GlyphKey *key) {
+    if (cache->mode == GLYPH_MODE_SDF)
+        return glyph_cache_insert_sdf(cache, key);
+
+    if (glyph_cache_set_size(cache, key->face, key->pixel_size) != 0)
+        return NULL;
+    FT_Face face = cache->faces[key->face];
+    if (FT_Load_Char(face, key->codepoint, FT_LOAD_RENDER))
+        return NULL;
+
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap *bitmap = &slot->bitmap;
+    Glyph glyph = {
+        .width = (uint16_t)bitmap->width,
+        .height = (uint16_t)bitmap->rows,
+        .bearing_x = (int16_t)slot->bitmap_left,
+        .bearing_y = (int16_t)slot->bitmap_top,
+        .advance = (int32_t)slot->advance.x,
+    };
+    return glyph_cache_store(cache, key, glyph, bitmap->buffer, bitmap->pitch);
+}
+
+uint32_t glyph_cache_find(const GlyphCache *cache, const GlyphKey *key) {
+    size_t slot = glyph_hash(key) & cache->slot_mask;
+    while (cache->slots[slot]) {
+        uint32_t id = cache->slots[slot] - 1;
+        if (glyph_key_equal(&cache->entries[id].key, key))
+            return id;
+        slot = (slot + 1) & cache->slot_mask;
+    }
+    return GLYPH_ENTRY_NONE;
+}
+
+const Glyph *glyph_cache_lookup(GlyphCache *cache, GlyphKey key) {
+    uint32_t id = glyph_cache_find(cache, &key);
+    if (id != GLYPH_ENTRY_NONE)
+        return glyph_cache_use(cache, id);
+
+    cache->stats.misses++;
+    return glyph_cache_insert(cache, &key);
+}
+
+const Glyph *glyph_cache_peek(GlyphCache *cache, GlyphKey key) {
+    uint32_t id = glyph_cache_find(cache, &key);
+    if (id == GLYPH_ENTRY_NONE)
+        return NULL;
+    return glyph_cache_use(cache, id);
+}
+
+const Glyph *glyph_cache_use(GlyphCache *cache, uint32_t id) {
+    cache->stats.hits++;
+    glyph_cache_touch(cache, id);
+    return &cache->entries[id].glyph;
+}
+
+const Glyph *glyph_cache_put(GlyphCache *cache, GlyphKey key, Glyph glyph, const uint8_t *pixels) {
+    cache->stats.misses++;
+    return glyph_cache_store(cache, &key, glyph, pixels, glyph.width);
+}
+
+void glyph_cache_prepare_size(GlyphCache *cache, uint32_t from_size, uint32_t to_size) {
+    // glyphs of an abandoned request are not going to be drawn
+    if (cache->prepare_size != 0 && cache->prepare_size != from_size && cache->prepare_size != to_size)
+        glyph_cache_release_size(cache, cache->prepare_size);
+
+    // the working set is whatever the last couple of frames drew
+    size_t count = 0;
+    GlyphKey *keys = malloc((cache->entry_count ? cache->entry_count : 1) * sizeof(GlyphKey));
+    if (keys) {
+        for (size_t id = 0; id < cache->entry_count; id++) {
+            const GlyphEntry *entry = &cache->entries[id];
+            // glyphs drawn by the caller have no face to rasterize from
+            if (!glyph_entry_live(entry) || entry->key.pixel_size != from_size || entry->frame + 2 < cache->frame ||
+                entry->key.face >= cache->face_count)
+                continue;
+            GlyphKey key = entry->key;
+            key.pixel_size = to_size;
+            if (glyph_cache_find(cache, &key) == GLYPH_ENTRY_NONE)
+                keys[count++] = key;
+        }
+    }
+
+    if (count > 0 && !cache->raster) {
+        cache->raster = malloc(sizeof(GlyphRaster));
+        if (cache->raster &&
+            glyph_raster_start(cache->raster, cache->face_paths, cache->face_count, cache->wake) != 0) {
+            free(cache->raster);
+            cache->raster = NULL;
+        }
+    }
+
+    // without a worker the new size fills in through ordinary misses
+    // and only keys the worker queued are waited for
+    cache->prepare_size = to_size;
+    cache->prepare_pending = 0;
+    if (cache->raster)
+        cache->prepare_generation = glyph_raster_submit(cache->raster, keys, count, &cache->prepare_pending);
+    free(keys);
+}
+
+bool glyph_cache_poll(GlyphCache *cache) {
+    if (!cache->raster)
+        return false;
+
+    GlyphBitmap *done;
+    size_t failed;
+    size_t count = glyph_raster_take(cache->raster, &done, &failed);
+    cache->prepare_pending -= failed < cache->prepare_pending ? failed : cache->prepare_pending;
+    bool added = false;
+    for (size_t i = 0; i < count; i++) {
+        GlyphBitmap *bitmap = &done[i];
+        // bitmaps of a superseded request are dropped
+        if (bitmap->generation == cache->prepare_generation) {
+            if (cache->prepare_pending > 0)
+                cache->prepare_pending--;
+            if (bitmap->loaded && glyph_cache_find(cache, &bitmap->key) == GLYPH_ENTRY_NONE &&
+                glyph_cache_store(cache, &bitmap->key, bitmap->glyph, bitmap->pixels, bitmap->glyph.width))
+                added = true;
+        }
+        free(bitmap->pixels);
+    }
+    free(done);
+    return added;
+}
+
+bool glyph_cache_size_ready(const GlyphCache *cache, uint32_t pixel_size) {
+    return cache->prepare_size == pixel_size && cache->prepare_pending == 0;
+}
+
+void glyph_cache_release_size(GlyphCache *cache, uint32_t pixel_size) {
+    for (size_t id = 0; id < cache->entry_count; id++) {
+        const GlyphEntry *entry = &cache->entries[id];
+        if (glyph_entry_live(entry) && entry->key.pixel_size == pixel_size)
+            glyph_cache_evict(cache, (uint32_t)id);
+    }
+
+    // the pages of the size are empty now so clear them for any other size
+    for (size_t p = 0; p < cache->page_count; p++) {
+        GlyphPage *page = &cache->pages[p];
+        if (page->pixel_size != pixel_size)
+            continue;
+        memset(page->pixels, 0, GLYPH_PAGE_AREA);
+        skyline_reset(page);
+        page->dead_area = 0;
+        page->pixel_size = 0;
+        glyph_cache_upload(cache, p, 0, 0, GLYPH_PAGE_SIZE, GLYPH_PAGE_SIZE);
+    }
+}
+
+void glyph_cache_begin_frame(GlyphCache *cache) {
+    // pages grown past the budget while a frame needed them are folded back in
+    if (cache->page_count > cache->max_pages)
+        glyph_cache_defragment(cache);
+    cache->frame++;
+}
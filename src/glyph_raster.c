@@ -0,0 +1,193 @@
+#include <glyph_raster.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// render one key with the worker faces
+static void glyph_raster_render(FT_Face *faces, uint32_t *sizes, size_t face_count, const GlyphKey *key,
+                                GlyphBitmap *out) {
+    out->key = *key;
+    out->pixels = NULL;
+    out->glyph = (Glyph){0};
+    out->loaded = false;
+
+    if (key->face >= face_count || !faces[key->face])
+        return;
+    FT_Face face = faces[key->face];
+    if (sizes[key->face] != key->pixel_size) {
+        if (FT_Set_Pixel_Sizes(face, 0, key->pixel_size))
+            return;
+        sizes[key->face] = key->pixel_size;
+    }
+    if (FT_Load_Char(face, key->codepoint, FT_LOAD_RENDER))
+        return;
+
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap *bitmap = &slot->bitmap;
+    size_t w = bitmap->width;
+    size_t h = bitmap->rows;
+    if (w > 0 && h > 0) {
+        out->pixels = malloc(w * h);
+        if (!out->pixels)
+            return;
+        // pack rows since freetype pitch may exceed glyph width
+        for (size_t row = 0; row < h; row++)
+            memcpy(out->pixels + row * w, bitmap->buffer + (ptrdiff_t)row * bitmap->pitch, w);
+    }
+
+    out->glyph.width = (uint16_t)w;
+    out->glyph.height = (uint16_t)h;
+    out->glyph.bearing_x = (int16_t)slot->bitmap_left;
+    out->glyph.bearing_y = (int16_t)slot->bitmap_top;
+    out->glyph.advance = (int32_t)slot->advance.x;
+    out->loaded = true;
+}
+
+static void *glyph_raster_main(void *arg) {
+    GlyphRaster *raster = arg;
+    FT_Library library;
+    FT_Face faces[GLYPH_CACHE_MAX_FACES] = {0};
+    uint32_t sizes[GLYPH_CACHE_MAX_FACES] = {0};
+    bool have_library = FT_Init_FreeType(&library) == 0;
+    for (size_t f = 0; have_library && f < raster->face_count; f++) {
+        if (FT_New_Face(library, raster->paths[f], 0, &faces[f]))
+            faces[f] = NULL;
+    }
+
+    pthread_mutex_lock(&raster->lock);
+    for (;;) {
+        while (!raster->stop && raster->job_next == raster->job_count)
+            pthread_cond_wait(&raster->work, &raster->lock);
+        if (raster->stop)
+            break;
+
+        GlyphKey key = raster->jobs[raster->job_next++];
+        uint32_t generation = raster->generation;
+        pthread_mutex_unlock(&raster->lock);
+
+        // render without the lock so submissions never wait on freetype
+        GlyphBitmap bitmap;
+        glyph_raster_render(faces, sizes, raster->face_count, &key, &bitmap);
+        bitmap.generation = generation;
+
+        pthread_mutex_lock(&raster->lock);
+        if (raster->done_count == raster->done_capacity) {
+            size_t capacity = raster->done_capacity ? raster->done_capacity * 2 : 64;
+            GlyphBitmap *done = realloc(raster->done, capacity * sizeof(GlyphBitmap));
+            if (done) {
+                raster->done = done;
+                raster->done_capacity = capacity;
+            }
+        }
+        if (raster->done_count < raster->done_capacity) {
+            raster->done[raster->done_count++] = bitmap;
+        } else {
+            // still counted so the consumer is not left waiting on it
+            free(bitmap.pixels);
+            if (generation == raster->generation)
+                raster->failed++;
+        }
+
+        // wake the consumer once per batch when the queue runs dry
+        if (raster->job_next == raster->job_count && raster->wake)
+            raster->wake();
+    }
+    pthread_mutex_unlock(&raster->lock);
+
+    for (size_t f = 0; f < raster->face_count; f++) {
+        if (faces[f])
+            FT_Done_Face(faces[f]);
+    }
+    if (have_library)
+        FT_Done_FreeType(library);
+    return NULL;
+}
+
+int glyph_raster_start(GlyphRaster *raster, char *const *paths, size_t face_count, glyph_raster_wake_fn wake) {
+    if (!raster || face_count > GLYPH_CACHE_MAX_FACES)
+        return -1;
+
+    memset(raster, 0, sizeof(*raster));
+    raster->wake = wake;
+    raster->face_count = face_count;
+    for (size_t f = 0; f < face_count; f++)
+        raster->paths[f] = paths[f];
+
+    if (pthread_mutex_init(&raster->lock, NULL) != 0)
+        return -1;
+    if (pthread_cond_init(&raster->work, NULL) != 0) {
+        pthread_mutex_destroy(&raster->lock);
+        return -1;
+    }
+    if (pthread_create(&raster->thread, NULL, glyph_raster_main, raster) != 0) {
+        pthread_cond_destroy(&raster->work);
+        pthread_mutex_destroy(&raster->lock);
+        return -1;
+    }
+    raster->running = true;
+    return 0;
+}
+
+uint32_t glyph_raster_submit(GlyphRaster *raster, const GlyphKey *keys, size_t count, size_t *out_queued) {
+    pthread_mutex_lock(&raster->lock);
+    uint32_t generation = ++raster->generation;
+    raster->failed = 0;
+
+    // a newer request makes anything still queued pointless
+    GlyphKey *jobs = realloc(raster->jobs, (count ? count : 1) * sizeof(GlyphKey));
+    if (jobs) {
+        raster->jobs = jobs;
+        memcpy(jobs, keys, count * sizeof(GlyphKey));
+        raster->job_count = count;
+    } else {
+        raster->job_count = 0;
+    }
+    raster->job_next = 0;
+    *out_queued = raster->job_count;
+
+    pthread_cond_signal(&raster->work);
+    pthread_mutex_unlock(&raster->lock);
+    return generation;
+}
+
+size_t glyph_raster_take(GlyphRaster *raster, GlyphBitmap **out, size_t *out_failed) {
+    *out = NULL;
+    *out_failed = 0;
+    if (!raster->running)
+        return 0;
+
+    pthread_mutex_lock(&raster->lock);
+    *out_failed = raster->failed;
+    raster->failed = 0;
+    size_t count = raster->done_count;
+    if (count > 0) {
+        // hand over the whole array and let the worker start a new one
+        *out = raster->done;
+        raster->done = NULL;
+        raster->done_count = 0;
+        raster->done_capacity = 0;
+    }
+    pthread_mutex_unlock(&raster->lock);
+    return count;
+}
+
+void glyph_raster_stop(GlyphRaster *raster) {
+    if (!raster->running)
+        return;
+
+    pthread_mutex_lock(&raster->lock);
+    raster->stop = true;
+    pthread_cond_signal(&raster->work);
+    pthread_mutex_unlock(&raster->lock);
+    pthread_join(raster->thread, NULL);
+
+    for (size_t i = 0; i < raster->done_count; i++)
+        free(raster->done[i].pixels);
+    free(raster->done);
+    free(raster->jobs);
+    pthread_cond_destroy(&raster->work);
+    pthread_mutex_destroy(&raster->lock);
+    raster->done = NULL;
+    raster->jobs = NULL;
+    raster->running = false;
+}
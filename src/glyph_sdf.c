@@ -0,0 +1,132 @@
+#include <glyph_sdf.h>
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// distance used for cells no seed can reach
+#define SDF_FAR 1e20f
+
+static int floor_div(int a, int b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// squared distance transform of one line of samples with parabola envelopes
+// f is read from and the result written back with the given stride
+static void sdf_transform_line(float *f, size_t stride, int n, float *line, float *z, int *v) {
+    for (int q = 0; q < n; q++)
+        line[q] = f[(size_t)q * stride];
+
+    int k = 0;
+    v[0] = 0;
+    z[0] = -SDF_FAR;
+    z[1] = SDF_FAR;
+    for (int q = 1; q < n; q++) {
+        // drop parabolas hidden below the one rooted at q
+        float s = ((line[q] + (float)q * q) - (line[v[k]] + (float)v[k] * v[k])) / (float)(2 * (q - v[k]));
+        while (s <= z[k]) {
+            k--;
+            s = ((line[q] + (float)q * q) - (line[v[k]] + (float)v[k] * v[k])) / (float)(2 * (q - v[k]));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = SDF_FAR;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < (float)q)
+            k++;
+        float d = (float)(q - v[k]);
+        f[(size_t)q * stride] = d * d + line[v[k]];
+    }
+}
+
+// squared distance from every cell to the nearest seed cell, seeds hold zero
+static void sdf_transform(float *grid, int width, int height, float *line, float *z, int *v) {
+    for (int x = 0; x < width; x++)
+        sdf_transform_line(grid + x, (size_t)width, height, line, z, v);
+    for (int y = 0; y < height; y++)
+        sdf_transform_line(grid + (size_t)y * width, 1, width, line, z, v);
+}
+
+int glyph_sdf_build(const uint8_t *coverage, int width, int height, int pitch, int left, int top, uint8_t **out,
+                    Glyph *glyph) {
+    const int scale = GLYPH_SDF_UPSCALE;
+    const int spread = GLYPH_SDF_SPREAD;
+    *out = NULL;
+
+    // field texels stay aligned to the pen so glyphs share one grid
+    int field_left = floor_div(left, scale) - spread;
+    int field_top = -floor_div(-top, scale) + spread;
+    int field_right = -floor_div(-(left + width), scale) + spread;
+    int field_bottom = floor_div(top - height, scale) - spread;
+    int field_width = field_right - field_left;
+    int field_height = field_top - field_bottom;
+
+    int grid_width = field_width * scale;
+    int grid_height = field_height * scale;
+    int offset_x = left - field_left * scale;
+    int offset_y = field_top * scale - top;
+    size_t cells = (size_t)grid_width * grid_height;
+    int longest = grid_width > grid_height ? grid_width : grid_height;
+
+    float *outside = malloc(cells * sizeof(float));
+    float *inside = malloc(cells * sizeof(float));
+    float *line = malloc((size_t)longest * sizeof(float));
+    float *z = malloc(((size_t)longest + 1) * sizeof(float));
+    int *v = malloc((size_t)longest * sizeof(int));
+    uint8_t *field = malloc((size_t)field_width * field_height);
+    if (!outside || !inside || !line || !z || !v || !field) {
+        free(outside);
+        free(inside);
+        free(line);
+        free(z);
+        free(v);
+        free(field);
+        return -1;
+    }
+
+    // seed each transform with the cells on the opposite side of the outline
+    for (int y = 0; y < grid_height; y++) {
+        for (int x = 0; x < grid_width; x++) {
+            int bx = x - offset_x;
+            int by = y - offset_y;
+            bool covered = bx >= 0 && by >= 0 && bx < width && by < height &&
+                           coverage[(size_t)by * pitch + bx] >= 128;
+            size_t i = (size_t)y * grid_width + x;
+            outside[i] = covered ? 0.0f : SDF_FAR;
+            inside[i] = covered ? SDF_FAR : 0.0f;
+        }
+    }
+    sdf_transform(outside, grid_width, grid_height, line, z, v);
+    sdf_transform(inside, grid_width, grid_height, line, z, v);
+
+    // sample the signed distance at each field texel center
+    for (int y = 0; y < field_height; y++) {
+        for (int x = 0; x < field_width; x++) {
+            size_t i = (size_t)(y * scale + scale / 2) * grid_width + (size_t)(x * scale + scale / 2);
+            float distance = (sqrtf(inside[i]) - sqrtf(outside[i])) / (float)scale;
+            float value = 128.0f + distance * (127.0f / (float)spread);
+            if (value < 0.0f)
+                value = 0.0f;
+            if (value > 255.0f)
+                value = 255.0f;
+            field[(size_t)y * field_width + x] = (uint8_t)lroundf(value);
+        }
+    }
+
+    free(outside);
+    free(inside);
+    free(line);
+    free(z);
+    free(v);
+
+    glyph->width = (uint16_t)field_width;
+    glyph->height = (uint16_t)field_height;
+    glyph->bearing_x = (int16_t)field_left;
+    glyph->bearing_y = (int16_t)field_top;
+    *out = field;
+    return 0;
+}
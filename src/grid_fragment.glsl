@@ -0,0 +1,143 @@
+#version 330 core
+out vec4 color;
+
+uniform sampler2DArray text;
+uniform usampler2D cells;    // atlas placement and style id of each cell by pool row
+uniform usampler2D styles;   // fg bg and instance flags of each style id
+uniform usampler2D rows;     // pool row holding each logical row
+uniform bool distance_field; // atlas holds distance fields with the outline at 0.5
+uniform vec2 origin;         // bottom left corner of the grid
+uniform vec2 cell_size;
+uniform ivec2 grid_size;     // columns and rows
+uniform float baseline;      // baseline height above the bottom of a row
+uniform float scale;
+uniform vec2 underline;      // bottom offset and height of underline bars
+uniform vec2 strike;         // bottom offset and height of strikethrough bars
+uniform ivec3 cursor;        // column row and visibility
+uniform vec3 default_fg;
+uniform vec3 default_bg;
+
+vec3 unpack_color(uint c)
+{
+    return vec3(c & 0xFFu, (c >> 8) & 0xFFu, (c >> 16) & 0xFFu) / 255.0;
+}
+
+// coverage of the glyph of a cell whose bottom left corner is at corner
+float glyph_alpha(uvec4 cell, vec2 corner, uint style_flags)
+{
+    vec2 rect = vec2(cell.r & 0xFFFFu, cell.r >> 16);
+    vec2 size = vec2(cell.g & 0xFFFFu, cell.g >> 16);
+    vec2 bearing = vec2(int(cell.b << 16) >> 16, int(cell.b) >> 16);
+    float page = float((cell.a >> 16) & 0xFFu);
+    uint kind = cell.a >> 24;
+    vec2 atlas = vec2(textureSize(text, 0).xy);
+    vec2 frag = gl_FragCoord.xy;
+    vec2 uv;
+    bool covered;
+
+    if ((kind & 2u) != 0u) {
+        // cell glyphs cover the cell exactly sampling texel centers like the instanced path
+        vec2 t = (frag - corner) / cell_size;
+        covered = all(greaterThanEqual(t, vec2(0.0))) && all(lessThan(t, vec2(1.0)));
+        uv = (rect + 0.5 + vec2(t.x, 1.0 - t.y) * (size - 1.0)) / atlas;
+    } else {
+        // same whole pixel origin and italic slant as the glyph quads
+        vec2 pen = corner + vec2(0.0, baseline);
+        vec2 base = floor(pen + vec2(bearing.x, bearing.y - size.y) * scale + 0.5);
+        if ((style_flags & 2u) != 0u)
+            frag.x -= (frag.y - pen.y) * 0.2;
+        vec2 texel = (frag - base) / scale;
+        covered = all(greaterThanEqual(texel, vec2(0.0))) && all(lessThan(texel, size));
+        uv = (rect + vec2(texel.x, size.y - texel.y)) / atlas;
+    }
+
+    // sampled outside any branch so derivatives stay defined for distance fields
+    float alpha = texture(text, vec3(uv, page)).r;
+    if (distance_field && (kind & 2u) == 0u) {
+        float width = max(fwidth(alpha) * 0.5, 1e-4);
+        alpha = smoothstep(0.5 - width, 0.5 + width, alpha);
+    }
+    return (kind & 1u) != 0u && covered ? alpha : 0.0;
+}
+
+// blend underline and strikethrough of a cell over its pixels
+vec3 decorate(vec3 result, vec3 fg, uint flags, vec2 corner)
+{
+    float pen = corner.y + baseline;
+    float thickness = underline.y;
+    if ((flags & 0x1Cu) != 0u) {
+        vec2 span = underline;
+        if ((flags & 8u) != 0u)
+            span = vec2(underline.x - 2.0 * thickness, 3.0 * thickness);
+        else if ((flags & 16u) != 0u)
+            span = vec2(underline.x - 2.5 * thickness, 4.0 * thickness);
+        float y = gl_FragCoord.y - (pen + span.x);
+        if (y >= 0.0 && y < span.y) {
+            float alpha = 1.0;
+            if ((flags & 8u) != 0u) {
+                alpha = abs(y - 1.5 * thickness) < 0.5 * thickness ? 0.0 : 1.0;
+            } else if ((flags & 16u) != 0u) {
+                float amplitude = 1.5 * thickness;
+                float k = 6.2831853 / cell_size.x;
+                float phase = gl_FragCoord.x * k;
+                float offset = y - 2.0 * thickness - amplitude * sin(phase);
+                float distance = abs(offset) / sqrt(1.0 + pow(amplitude * k * cos(phase), 2.0));
+                alpha = clamp(0.5 * thickness + 0.5 - distance, 0.0, 1.0);
+            }
+            result = mix(result, fg, alpha);
+        }
+    }
+    if ((flags & 32u) != 0u) {
+        float y = gl_FragCoord.y - (pen + strike.x);
+        if (y >= 0.0 && y < strike.y)
+            result = fg;
+    }
+    return result;
+}
+
+void main()
+{
+    ivec2 pos = ivec2(floor((gl_FragCoord.xy - origin) / cell_size));
+    bool inside = all(greaterThanEqual(pos, ivec2(0))) && all(lessThan(pos, grid_size));
+    ivec2 at = clamp(pos, ivec2(0), grid_size - 1);
+    int row = grid_size.y - 1 - at.y;
+    int pool = int(texelFetch(rows, ivec2(row, 0), 0).r);
+    bool cursor_row = cursor.z != 0 && cursor.y == row;
+
+    // backgrounds go first as the glyph quads of every cell are drawn over them
+    uvec4 own = texelFetch(cells, ivec2(at.x, pool), 0);
+    uint own_id = own.a & 0xFFFFu;
+    vec3 result = default_bg;
+    if (inside)
+        result = unpack_color(texelFetch(styles, ivec2(int(own_id & 255u), int(own_id >> 8)), 0).g);
+
+    // undercurls of the row above dip below its bottom edge
+    if (inside && row > 0 && !(cursor.z != 0 && cursor.y == row - 1 && cursor.x == at.x)) {
+        int above = int(texelFetch(rows, ivec2(row - 1, 0), 0).r);
+        uint id = texelFetch(cells, ivec2(at.x, above), 0).a & 0xFFFFu;
+        uvec4 style = texelFetch(styles, ivec2(int(id & 255u), int(id >> 8)), 0);
+        result = decorate(result, unpack_color(style.r), style.b, origin + vec2(at.x, at.y + 1) * cell_size);
+    }
+
+    // glyphs overhang into neighbours and are drawn left to right
+    for (int dx = -1; dx <= 1; dx++) {
+        int col = clamp(at.x + dx, 0, grid_size.x - 1);
+        uvec4 cell = texelFetch(cells, ivec2(col, pool), 0);
+        uint id = cell.a & 0xFFFFu;
+        uvec4 style = texelFetch(styles, ivec2(int(id & 255u), int(id >> 8)), 0);
+        vec2 corner = origin + vec2(col, at.y) * cell_size;
+        float alpha = glyph_alpha(cell, corner, style.b);
+        if (!inside || col != at.x + dx)
+            continue;
+
+        // the cursor block hides overhangs from the left and inverts its glyph
+        bool is_cursor = cursor_row && cursor.x == col;
+        vec3 fg = is_cursor ? default_bg : unpack_color(style.r);
+        if (dx == 0 && is_cursor)
+            result = default_fg;
+        result = mix(result, fg, alpha);
+        if (dx == 0 && !is_cursor)
+            result = decorate(result, fg, style.b, corner);
+    }
+    color = vec4(result, 1.0);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+void main()
+{
+    // one triangle covering the viewport with corners from the vertex id
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -1,6 +1,6 @@
-#include <app.h>
-
-int main(void) {
-    // delegate execution to application controller
-    return app_run();
-}
+#include <app.h>
+
+int main(int argc, char **argv) {
+    // delegate execution to application controller
+    return app_run(argc, argv);
+}
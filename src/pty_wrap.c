@@ -1,49 +1,172 @@
-#define _XOPEN_SOURCE 600
-
-#include <pty.h>        // forkpty helper
-#include <unistd.h>     // execlp read write
-#include <sys/ioctl.h>  // terminal sizing
-#include <fcntl.h>      
-#include <string.h>
-#include <stdlib.h>
-#include <sys/types.h>
-#include <stdint.h>
-
-int pty_spawn(const char* shell, int* out_master_fd, int* out_child_pid) {
-    int master_fd;
-    pid_t pid = forkpty(&master_fd, NULL, NULL, NULL);
-    if (pid < 0) return -1;
-
-    if (pid == 0) {
-        // launch interactive shell in child
-        if (shell == NULL) shell = "bash";
-        execlp(shell, shell, (char*)NULL);
-        _exit(127);
-    }
-
-    // switch master to non blocking mode
-    int flags = fcntl(master_fd, F_GETFL, 0);
-    fcntl(master_fd, F_SETFL, flags | O_NONBLOCK);
-    *out_master_fd = master_fd;
-    *out_child_pid = pid;
-    return 0;
-}
-
-int pty_set_winsize(int master_fd, int rows, int cols) {
-    struct winsize ws = {0};
-    ws.ws_row = (unsigned short)rows;
-    ws.ws_col = (unsigned short)cols;
-    // inform child of terminal dimensions
-    return ioctl(master_fd, TIOCSWINSZ, &ws);
-}
-
-ssize_t pty_write(int master_fd, const void* buf, size_t n) {
-    // forward bytes to pseudo terminal
-    return write(master_fd, buf, n);
-}
-
-ssize_t pty_read(int master_fd, uint8_t* buf, size_t cap) {
-    // read bytes produced by child process
-    return read(master_fd, buf, cap); 
-}
-
+#define _XOPEN_SOURCE 600
+
+#include <pty_wrap.h>
+
+#include <pty.h>        // forkpty helper
+#include <unistd.h>     // execlp read write
+#include <sys/ioctl.h>  // terminal sizing
+#include <fcntl.h>      
+#include <errno.h>
+#include <poll.h>       // readiness wakeups
+#include <string.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <stdint.h>
+
+int pty_spawn(const char* shell, int* out_master_fd, int* out_child_pid) {
+    int master_fd;
+    pid_t pid = forkpty(&master_fd, NULL, NULL, NULL);
+    if (pid < 0) return -1;
+
+    if (pid == 0) {
+        // launch interactive shell in child
+        if (shell == NULL) shell = "bash";
+        execlp(shell, shell, (char*)NULL);
+        _exit(127);
+    }
+
+    // switch master to non blocking mode
+    int flags = fcntl(master_fd, F_GETFL, 0);
+    fcntl(master_fd, F_SETFL, flags | O_NONBLOCK);
+    *out_master_fd = master_fd;
+    *out_child_pid = pid;
+    return 0;
+}
+
+int pty_set_winsize(int master_fd, int rows, int cols) {
+    struct winsize ws = {0};
+    ws.ws_row = (unsigned short)rows;
+    ws.ws_col = (unsigned short)cols;
+    // inform child of terminal dimensions
+    return ioctl(master_fd, TIOCSWINSZ, &ws);
+}
+
+ssize_t pty_write(int master_fd, const void* buf, size_t n) {
+    // forward bytes to pseudo terminal
+    return write(master_fd, buf, n);
+}
+
+ssize_t pty_read(int master_fd, uint8_t* buf, size_t cap) {
+    // read bytes produced by child process
+    return read(master_fd, buf, cap); 
+}
+
+
+#define PTY_READER_RESUME 'r'
+#define PTY_READER_QUIT   'q'
+
+// block until a control command arrives or the master becomes readable
+static char pty_reader_wait(PtyReader* reader, bool watch_master) {
+    struct pollfd fds[2] = {
+        { .fd = reader->control_pipe[0], .events = POLLIN },
+        { .fd = reader->master_fd, .events = POLLIN },
+    };
+    for (;;) {
+        if (poll(fds, watch_master ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            return PTY_READER_QUIT;
+        }
+        if (fds[0].revents & POLLIN) {
+            char cmd = PTY_READER_QUIT;
+            if (read(reader->control_pipe[0], &cmd, 1) != 1) return PTY_READER_QUIT;
+            return cmd;
+        }
+        if (watch_master && fds[1].revents) return 0;
+    }
+}
+
+static void pty_reader_notify(PtyReader* reader) {
+    // post a single wake until the consumer starts draining
+    if (!atomic_exchange(&reader->wake_pending, true)) reader->wake();
+}
+
+static void* pty_reader_main(void* arg) {
+    PtyReader* reader = arg;
+
+    for (;;) {
+        uint8_t* span;
+        size_t space = byte_ring_write_span(&reader->ring, &span);
+
+        if (space == 0) {
+            // ring full so stop reading and let the kernel apply backpressure
+            atomic_store(&reader->space_waiting, true);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (byte_ring_size(&reader->ring) == reader->ring.capacity &&
+                pty_reader_wait(reader, false) == PTY_READER_QUIT) break;
+            atomic_store(&reader->space_waiting, false);
+            continue;
+        }
+
+        ssize_t n = pty_read(reader->master_fd, span, space);
+        if (n > 0) {
+            byte_ring_commit(&reader->ring, (size_t)n);
+            pty_reader_notify(reader);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // master is non blocking so sleep in poll until readable
+            if (pty_reader_wait(reader, true) == PTY_READER_QUIT) break;
+            continue;
+        }
+
+        // eof or eio once the child has exited so idle until stopped
+        while (pty_reader_wait(reader, false) != PTY_READER_QUIT) {}
+        break;
+    }
+    return NULL;
+}
+
+int pty_reader_start(PtyReader* reader, int master_fd, size_t ring_capacity, pty_wake_fn wake) {
+    reader->master_fd = master_fd;
+    reader->wake = wake;
+    reader->running = false;
+    atomic_init(&reader->wake_pending, false);
+    atomic_init(&reader->space_waiting, false);
+
+    if (byte_ring_init(&reader->ring, ring_capacity) != 0) return -1;
+    if (pipe(reader->control_pipe) < 0) {
+        byte_ring_free(&reader->ring);
+        return -1;
+    }
+    if (pthread_create(&reader->thread, NULL, pty_reader_main, reader) != 0) {
+        close(reader->control_pipe[0]);
+        close(reader->control_pipe[1]);
+        byte_ring_free(&reader->ring);
+        return -1;
+    }
+    reader->running = true;
+    return 0;
+}
+
+size_t pty_reader_peek(PtyReader* reader, const uint8_t** out) {
+    if (!reader->running) return 0;
+    return byte_ring_read_span(&reader->ring, out);
+}
+
+void pty_reader_consume(PtyReader* reader, size_t n) {
+    byte_ring_consume(&reader->ring, n);
+    atomic_thread_fence(memory_order_seq_cst);
+    // resume a producer that parked on a full ring
+    if (atomic_exchange(&reader->space_waiting, false)) {
+        char cmd = PTY_READER_RESUME;
+        (void)!write(reader->control_pipe[1], &cmd, 1);
+    }
+}
+
+void pty_reader_begin_drain(PtyReader* reader) {
+    if (!reader->running) return;
+    atomic_store(&reader->wake_pending, false);
+}
+
+void pty_reader_stop(PtyReader* reader) {
+    if (!reader->running) return;
+    char cmd = PTY_READER_QUIT;
+    (void)!write(reader->control_pipe[1], &cmd, 1);
+    pthread_join(reader->thread, NULL);
+    close(reader->control_pipe[0]);
+    close(reader->control_pipe[1]);
+    byte_ring_free(&reader->ring);
+    reader->running = false;
+}
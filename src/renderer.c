@@ -0,0 +1,1026 @@
+#include <renderer.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cell_kernel.h>
+#include <renderer_grid.h>
+#include <text.h>
+
+// dirty rows needed before a repaint is matched against shifted rows
+#define RENDERER_GUESS_MIN_ROWS 4
+// cells a redraw needs before its instances are built on the pool
+#define RENDERER_PARALLEL_CELLS 16384
+// cells each job aims for so workers share the load evenly
+#define RENDERER_JOB_CELLS 2048
+// recent glyphs a job remembers, a power of two
+#define RENDERER_MEMO_SIZE 64
+// instance flag of a glyph left for the caller to look up, never drawn
+#define RENDERER_INSTANCE_PENDING 0x80u
+
+// glyph a job found for a codepoint, keyed with the italic bit on top
+typedef struct RendererMemo {
+    uint32_t key;
+    uint32_t id;
+    bool cell;
+} RendererMemo;
+
+// state shared by the bands of one frame
+typedef struct GridPass {
+    const Screen *screen;
+    bool cursor_visible;
+    uint8_t fg[4];
+    uint8_t bg[4];
+    float origin_x;
+    float origin_y;      // bottom of the lowest row
+} GridPass;
+
+// state of one job while it fills its slice
+typedef struct RendererWork {
+    RendererJob *job;
+    GlyphInstance *out;
+    uint32_t *touched;
+    RendererMemo memo[RENDERER_MEMO_SIZE];
+} RendererWork;
+
+// what every job of a frame reads
+typedef struct RendererBuild {
+    Renderer *renderer;
+    const GridPass *pass;
+    GlyphInstance *upload; // mapped range jobs are packed into
+} RendererBuild;
+
+static bool renderer_reserve(Renderer *renderer, size_t count);
+static void renderer_bind_instances(size_t offset);
+static bool renderer_prepare_frame(Renderer *renderer, const RendererFrameKey *key);
+static bool renderer_attach_target(GLuint *fbo, GLuint *texture, int width, int height);
+static bool renderer_reserve_hashes(Renderer *renderer, int rows);
+static uint64_t renderer_row_hash(const GridPass *pass, int row);
+static int renderer_guess_scroll(Renderer *renderer, const GridPass *pass, int *top, int *bottom);
+static void renderer_scroll_frame(Renderer *renderer, const GridPass *pass, int top, int bottom, int lines);
+static void renderer_emit_band(Renderer *renderer, GridPass *pass, int top, int bottom, int left, int right, bool whole);
+static void renderer_queue_jobs(Renderer *renderer, int top, int bottom, int left, int right, bool backgrounds);
+static bool renderer_build_instances(Renderer *renderer, const GridPass *pass, size_t *base);
+static void renderer_run_job(void *ctx, size_t index);
+static void renderer_copy_job(void *ctx, size_t index);
+static size_t renderer_settle_job(Renderer *renderer, RendererJob *job);
+static void renderer_push_glyph(RendererWork *work, int col, int row, uint32_t codepoint, const uint8_t color[4],
+                                uint32_t flags);
+static void renderer_push_solid(RendererWork *work, int col, int row, int span, const uint8_t color[4], uint32_t flags);
+static void renderer_layout(float text_scale, RendererLayout *layout);
+static void pack_color(const vec3 src, uint8_t dst[4]);
+
+int renderer_init(Renderer *renderer, GLuint shader_program) {
+    if (!renderer)
+        return -1;
+
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->shader_program = shader_program;
+
+    // TERMITE_RENDER_THREADS overrides the workers picked for this machine
+    const char *threads = getenv("TERMITE_RENDER_THREADS");
+    renderer->threads = threads ? (size_t)strtoul(threads, NULL, 10) : work_pool_default_threads();
+
+    // cache uniform locations once instead of per draw
+    renderer->origin_location = glGetUniformLocation(shader_program, "origin");
+    renderer->cell_size_location = glGetUniformLocation(shader_program, "cell_size");
+    renderer->scale_location = glGetUniformLocation(shader_program, "scale");
+    renderer->grid_rows_location = glGetUniformLocation(shader_program, "grid_rows");
+    renderer->solid_span_location = glGetUniformLocation(shader_program, "solid_span");
+    renderer->underline_location = glGetUniformLocation(shader_program, "underline");
+    renderer->strike_location = glGetUniformLocation(shader_program, "strike");
+    renderer->distance_field_location = glGetUniformLocation(shader_program, "distance_field");
+
+    // quad corners come from gl_VertexID so only per instance data is stored
+    glGenVertexArrays(1, &renderer->vao);
+    if (stream_buffer_init(&renderer->stream, GL_ARRAY_BUFFER, STREAM_BUFFER_DEFAULT_SIZE) != 0) {
+        renderer_free(renderer);
+        return -1;
+    }
+    glBindVertexArray(renderer->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer->stream.buffer);
+    for (GLuint attrib = 0; attrib < 5; attrib++) {
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, 1);
+    }
+    renderer_bind_instances(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    return 0;
+}
+
+void renderer_free(Renderer *renderer) {
+    if (!renderer)
+        return;
+
+    // release workers, gpu objects and staging array
+    work_pool_stop(&renderer->pool);
+    stream_buffer_free(&renderer->stream);
+    if (renderer->grid) {
+        renderer_grid_free(renderer->grid);
+        free(renderer->grid);
+    }
+    if (renderer->vao)
+        glDeleteVertexArrays(1, &renderer->vao);
+    if (renderer->frame_fbo)
+        glDeleteFramebuffers(1, &renderer->frame_fbo);
+    if (renderer->frame_texture)
+        glDeleteTextures(1, &renderer->frame_texture);
+    if (renderer->scratch_fbo)
+        glDeleteFramebuffers(1, &renderer->scratch_fbo);
+    if (renderer->scratch_texture)
+        glDeleteTextures(1, &renderer->scratch_texture);
+    free(renderer->instances);
+    free(renderer->jobs);
+    free(renderer->touched);
+    free(renderer->bands);
+    free(renderer->row_hashes);
+    free(renderer->next_hashes);
+    memset(renderer, 0, sizeof(*renderer));
+}
+
+int renderer_set_backend(Renderer *renderer, RendererBackend backend) {
+    if (!renderer)
+        return -1;
+
+    if (backend == RENDERER_BACKEND_GRID && !renderer->grid) {
+        RendererGrid *grid = malloc(sizeof(RendererGrid));
+        if (!grid)
+            return -1;
+        if (renderer_grid_init(grid) != 0) {
+            free(grid);
+            return -1;
+        }
+        renderer->grid = grid;
+    }
+
+    // whatever the other backend drew last is stale now
+    renderer->backend = backend;
+    renderer->frame_valid = false;
+    if (renderer->grid)
+        renderer->grid->valid = false;
+    return 0;
+}
+
+int renderer_backend_parse(const char *name, RendererBackend *backend) {
+    if (!name || !backend)
+        return -1;
+    if (strcmp(name, "instanced") == 0)
+        *backend = RENDERER_BACKEND_INSTANCED;
+    else if (strcmp(name, "grid") == 0)
+        *backend = RENDERER_BACKEND_GRID;
+    else
+        return -1;
+    return 0;
+}
+
+void renderer_set_threads(Renderer *renderer, size_t threads) {
+    if (!renderer)
+        return;
+
+    // the pool is started again with the new size by the next large redraw
+    work_pool_stop(&renderer->pool);
+    renderer->threads = threads;
+}
+
+void renderer_draw_grid(Renderer *renderer, const Screen *screen, bool cursor_visible, float text_scale, const vec3 fg_color,
+                        const vec3 bg_color) {
+    if (!renderer || !screen || !screen->cells)
+        return;
+
+    int cols = screen->cols;
+    int rows = screen->rows;
+
+    // glyphs drawn by the previous frame become evictable again
+    glyph_cache_begin_frame(&glyph_cache);
+
+    GridPass pass = { .screen = screen, .cursor_visible = cursor_visible };
+    pack_color(fg_color, pass.fg);
+    pack_color(bg_color, pass.bg);
+
+    RendererLayout layout;
+    renderer_layout(text_scale, &layout);
+    pass.origin_x = layout.origin_x;
+    pass.origin_y = layout.origin_y;
+    float glyph_scale = layout.glyph_scale;
+
+    // the grid backend shades every pixel from cell textures and keeps no frame
+    if (renderer->backend == RENDERER_BACKEND_GRID) {
+        renderer_grid_draw(renderer->grid, screen, cursor_visible, &layout, pass.fg, pass.bg, &renderer->stats);
+        return;
+    }
+
+    // anything besides cell contents changing invalidates the retained frame
+    RendererFrameKey key;
+    memset(&key, 0, sizeof(key));
+    key.width = x_resolution;
+    key.height = y_resolution;
+    key.cell_width = x_spacing;
+    key.cell_height = y_spacing;
+    key.origin_x = pass.origin_x;
+    key.origin_y = pass.origin_y;
+    key.glyph_scale = glyph_scale;
+    key.glyph_mode = (uint32_t)glyph_cache.mode;
+    memcpy(key.fg, pass.fg, 4);
+    memcpy(key.bg, pass.bg, 4);
+    bool full = !renderer_prepare_frame(renderer, &key) || screen->damage.all;
+    // hashes describe rows of the frame so a new grid height starts over
+    if (rows != renderer->hash_rows) {
+        full = true;
+        if (!renderer_reserve_hashes(renderer, rows))
+            return;
+    }
+
+    renderer->instance_count = 0;
+    renderer->job_count = 0;
+    renderer->band_count = 0;
+    renderer->stats.cells_redrawn = 0;
+    renderer->stats.rows_redrawn = 0;
+    renderer->stats.rows_scrolled = 0;
+    if (full) {
+        for (int y = 0; y < rows; y++)
+            renderer->row_hashes[y] = renderer_row_hash(&pass, y);
+        renderer_emit_band(renderer, &pass, 0, rows - 1, 0, cols, true);
+        renderer->stats.full_redraws++;
+    } else {
+        // scroll ops leave a hint and repaints of shifted screens are matched by hash
+        const ScreenDamage *damage = &screen->damage;
+        int shift_top = damage->scroll_top;
+        int shift_bottom = damage->scroll_bottom;
+        int shift = damage->scroll_lines;
+        bool hashed = false;
+        if (shift == 0) {
+            shift = renderer_guess_scroll(renderer, &pass, &shift_top, &shift_bottom);
+            hashed = shift != 0;
+        }
+        if (shift != 0)
+            renderer_scroll_frame(renderer, &pass, shift_top, shift_bottom, shift);
+        else
+            shift_bottom = shift_top - 1;
+
+        // rows already showing their contents are skipped
+        // and consecutive rows with the same dirty columns share one band
+        int top = -1;
+        int band_start = 0;
+        int band_end = 0;
+        for (int y = 0; y <= rows; y++) {
+            int start = 0;
+            int end = cols;
+            bool dirty = false;
+            if (y < rows && y >= shift_top && y <= shift_bottom) {
+                // shifted rows hold whatever moved in so only hashes can tell
+                dirty = true;
+            } else if (y < rows && screen_damage_row_dirty(damage, y)) {
+                screen_damage_span(damage, y, &start, &end);
+                dirty = start < end;
+            }
+            if (dirty) {
+                uint64_t hash = hashed ? renderer->next_hashes[y] : renderer_row_hash(&pass, y);
+                dirty = hash != renderer->row_hashes[y];
+                renderer->row_hashes[y] = hash;
+            }
+            if (top >= 0 && (!dirty || start != band_start || end != band_end)) {
+                renderer_emit_band(renderer, &pass, top, y - 1, band_start, band_end, false);
+                top = -1;
+            }
+            if (dirty && top < 0) {
+                top = y;
+                band_start = start;
+                band_end = end;
+            }
+        }
+    }
+    renderer->stats.bands = renderer->band_count;
+    renderer->stats.frames++;
+
+    // instances land in a fresh range of the ring so the upload never waits on earlier draws
+    size_t base = 0;
+    bool uploaded = renderer_build_instances(renderer, &pass, &base);
+
+    // the retained frame lives offscreen unless no framebuffer could be made
+    GLuint target = renderer->frame_fbo;
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+
+    glUseProgram(renderer->shader_program);
+    glUniform2f(renderer->origin_location, layout.origin_x, layout.origin_y + layout.baseline);
+    glUniform2f(renderer->cell_size_location, x_spacing, y_spacing);
+    glUniform1f(renderer->scale_location, glyph_scale);
+    glUniform1i(renderer->distance_field_location, glyph_cache.mode == GLYPH_MODE_SDF);
+    glUniform1i(renderer->grid_rows_location, rows);
+    glUniform2f(renderer->solid_span_location, -layout.baseline, y_spacing);
+    glUniform2f(renderer->underline_location, layout.underline[0], layout.underline[1]);
+    glUniform2f(renderer->strike_location, layout.strike[0], layout.strike[1]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, glyph_cache.texture);
+    glBindVertexArray(renderer->vao);
+
+    // clear and redraw each band with fragments confined to it
+    glClearColor(pass.bg[0] / 255.0f, pass.bg[1] / 255.0f, pass.bg[2] / 255.0f, 1.0f);
+    glEnable(GL_SCISSOR_TEST);
+    for (size_t b = 0; b < renderer->band_count; b++) {
+        const RendererBand *band = &renderer->bands[b];
+        glScissor(band->x, band->y, band->width, band->height);
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (band->count == 0 || !uploaded)
+            continue;
+        renderer_bind_instances(base + band->first * sizeof(GlyphInstance));
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)band->count);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    stream_buffer_fence(&renderer->stream);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // present the whole retained frame
+    if (target != 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, key.width, key.height, 0, 0, key.width, key.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+}
+
+// place the grid in the window for text_scale
+static void renderer_layout(float text_scale, RendererLayout *layout) {
+    // cursor block spans one line height centered on the reference glyph
+    // glyphs of the current size bucket are scaled to the cell size
+    float glyph_scale = text_glyph_scale(text_scale);
+    const Glyph *reference = text_lookup_glyph('X', 0);
+    float reference_height = reference ? reference->height : 0.0f;
+    float reference_bearing = reference ? reference->bearing_y : 0.0f;
+    float extra = (y_spacing - reference_height * glyph_scale) * 0.5f;
+    float solid_bottom = -(reference_height - reference_bearing) * glyph_scale - extra;
+
+    // row edges fall on whole pixels so rows can be blitted and scissored exactly
+    layout->origin_x = roundf(margin_x);
+    layout->origin_y = roundf(margin_y * 1.25f + solid_bottom);
+    layout->baseline = -solid_bottom;
+    layout->glyph_scale = glyph_scale;
+
+    // underline sits just below the baseline and scales with the line height
+    float underline_thickness = y_spacing / 16.0f < 1.0f ? 1.0f : y_spacing / 16.0f;
+    layout->underline[0] = -2.0f * underline_thickness;
+    layout->underline[1] = underline_thickness;
+
+    // strikethrough crosses the middle of lowercase letters
+    const Glyph *x_glyph = text_lookup_glyph('x', 0);
+    float strike_center = x_glyph ? (x_glyph->bearing_y - x_glyph->height * 0.5f) * glyph_scale : 0.0f;
+    layout->strike[0] = strike_center - underline_thickness * 0.5f;
+    layout->strike[1] = underline_thickness;
+}
+
+// point the instance attributes at the first instance of a band in the bound buffer
+// gl 3.3 has no base instance so bands rebind their offset instead
+static void renderer_bind_instances(size_t offset) {
+    const GLsizei stride = sizeof(GlyphInstance);
+    const char *base = (const char *)offset;
+    glVertexAttribIPointer(0, 2, GL_UNSIGNED_SHORT, stride, base + offsetof(GlyphInstance, col));
+    glVertexAttribIPointer(1, 4, GL_UNSIGNED_SHORT, stride, base + offsetof(GlyphInstance, atlas_x));
+    glVertexAttribIPointer(2, 2, GL_SHORT, stride, base + offsetof(GlyphInstance, bearing_x));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, base + offsetof(GlyphInstance, color));
+    glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, stride, base + offsetof(GlyphInstance, flags));
+}
+
+// size the offscreen frame to the window and return true when its contents can be reused
+static bool renderer_prepare_frame(Renderer *renderer, const RendererFrameKey *key) {
+    bool reusable = renderer->frame_valid && memcmp(&renderer->frame_key, key, sizeof(*key)) == 0;
+    bool resized = !renderer->frame_valid || renderer->frame_key.width != key->width ||
+                   renderer->frame_key.height != key->height;
+    renderer->frame_key = *key;
+    renderer->frame_valid = true;
+
+    if (resized && key->width > 0 && key->height > 0) {
+        // without a retained frame every frame is drawn straight to the window
+        // and without the scratch copy scrolled rows are redrawn in place
+        if (renderer_attach_target(&renderer->frame_fbo, &renderer->frame_texture, key->width, key->height))
+            renderer_attach_target(&renderer->scratch_fbo, &renderer->scratch_texture, key->width, key->height);
+    }
+    return reusable && renderer->frame_fbo != 0;
+}
+
+// size a color texture and its framebuffer, deleting both when incomplete
+static bool renderer_attach_target(GLuint *fbo, GLuint *texture, int width, int height) {
+    if (!*texture)
+        glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_2D, *texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!*fbo)
+        glGenFramebuffers(1, fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, fbo);
+        glDeleteTextures(1, texture);
+        *fbo = 0;
+        *texture = 0;
+        return false;
+    }
+    return true;
+}
+
+static bool renderer_reserve_hashes(Renderer *renderer, int rows) {
+    uint64_t *row_hashes = realloc(renderer->row_hashes, (size_t)rows * sizeof(uint64_t));
+    if (row_hashes)
+        renderer->row_hashes = row_hashes;
+    uint64_t *next_hashes = realloc(renderer->next_hashes, (size_t)rows * sizeof(uint64_t));
+    if (next_hashes)
+        renderer->next_hashes = next_hashes;
+    if (!row_hashes || !next_hashes) {
+        renderer->hash_rows = 0;
+        return false;
+    }
+    renderer->hash_rows = rows;
+    return true;
+}
+
+// hash a row as it would be drawn, resolved styles and cursor included
+// zero is never returned so it can mark rows whose pixels are unknown
+static uint64_t renderer_row_hash(const GridPass *pass, int row) {
+    const Screen *screen = pass->screen;
+    const Cell *line = screen_row(screen, row);
+    size_t cols = (size_t)screen->cols;
+    uint64_t h = cell_hash(line, cols);
+    for (size_t x = 0; x < cols;) {
+        // style ids are recycled so hash what each run's id stands for
+        uint32_t style_id = line[x].style;
+        const Style *style = style_table_get(&screen->styles, style_id);
+        h = (h ^ (style->fg | (uint64_t)style->attrs << 32)) * 0x100000001B3ull;
+        h = (h ^ (style->bg | (uint64_t)1 << 63)) * 0x100000001B3ull;
+        x += cell_style_run(line + x, cols - x, style_id);
+    }
+    if (pass->cursor_visible && screen->cursor_row == row)
+        h = (h ^ (screen->cursor_col | (uint64_t)1 << 62)) * 0x100000001B3ull;
+    h ^= h >> 29;
+    return h | 1;
+}
+
+// find the shift that lands most redrawn rows on a row the frame already shows
+// return its lines (positive up) and the region it moves or zero when none pays off
+static int renderer_guess_scroll(Renderer *renderer, const GridPass *pass, int *top, int *bottom) {
+    const Screen *screen = pass->screen;
+    int rows = screen->rows;
+    const uint64_t *drawn = renderer->row_hashes;
+    uint64_t *next = renderer->next_hashes;
+    if (!renderer->scratch_fbo)
+        return 0;
+
+    // a few dirty rows are cheaper to redraw than to match
+    int dirty = 0;
+    for (int y = 0; y < rows; y++)
+        dirty += screen_damage_row_dirty(&screen->damage, y);
+    if (dirty < RENDERER_GUESS_MIN_ROWS)
+        return 0;
+
+    for (int y = 0; y < rows; y++)
+        next[y] = renderer_row_hash(pass, y);
+
+    // erased rows match each other everywhere and are cheap to redraw anyway
+    int best = 0;
+    int best_count = 0;
+    for (int lines = 1 - rows; lines < rows; lines++) {
+        if (lines == 0)
+            continue;
+        int count = 0;
+        int first = lines < 0 ? -lines : 0;
+        int last = lines > 0 ? rows - lines : rows;
+        for (int y = first; y < last; y++) {
+            if (next[y] != drawn[y] && next[y] == drawn[y + lines] &&
+                screen_line(screen, y)->blank == SCREEN_LINE_MIXED)
+                count++;
+        }
+        if (count > best_count) {
+            best = lines;
+            best_count = count;
+        }
+    }
+    if (best_count < RENDERER_GUESS_MIN_ROWS)
+        return 0;
+
+    // the region covers the matched rows and the rows they came from
+    int first = rows;
+    int last = -1;
+    for (int y = best < 0 ? -best : 0; y < (best > 0 ? rows - best : rows); y++) {
+        if (next[y] != drawn[y] && next[y] == drawn[y + best] && screen_line(screen, y)->blank == SCREEN_LINE_MIXED) {
+            if (first == rows)
+                first = y;
+            last = y;
+        }
+    }
+    *top = best > 0 ? first : first + best;
+    *bottom = best > 0 ? last + best : last;
+    renderer->stats.scroll_guesses++;
+    return best;
+}
+
+// move rows [top, bottom] of the frame up by lines rows along with their hashes
+// rows left uncovered are marked unknown so the caller redraws them
+static void renderer_scroll_frame(Renderer *renderer, const GridPass *pass, int top, int bottom, int lines) {
+    int rows = pass->screen->rows;
+    int n = lines > 0 ? lines : -lines;
+    if (top < 0 || bottom >= rows || bottom - top + 1 <= n)
+        return;
+
+    // rows that survive the shift and where their pixels start
+    int src_top = lines > 0 ? top + n : top;
+    int src_bottom = lines > 0 ? bottom : bottom - n;
+    int row_height = (int)y_spacing;
+    int y0 = (int)pass->origin_y + (rows - 1 - src_bottom) * row_height;
+    int y1 = (int)pass->origin_y + (rows - src_top) * row_height;
+    if (!renderer_shift_frame(renderer, y0, y1, lines * row_height))
+        return;
+
+    uint64_t *hashes = renderer->row_hashes;
+    if (lines > 0) {
+        memmove(hashes + top, hashes + top + n, (size_t)(bottom - top + 1 - n) * sizeof(uint64_t));
+        memset(hashes + bottom - n + 1, 0, (size_t)n * sizeof(uint64_t));
+    } else {
+        memmove(hashes + top + n, hashes + top, (size_t)(bottom - top + 1 - n) * sizeof(uint64_t));
+        memset(hashes + top, 0, (size_t)n * sizeof(uint64_t));
+    }
+    renderer->stats.rows_scrolled = (size_t)(bottom - top + 1 - n);
+    renderer->stats.scroll_blits++;
+}
+
+bool renderer_shift_frame(Renderer *renderer, int y0, int y1, int dy) {
+    if (!renderer || !renderer->frame_fbo || !renderer->scratch_fbo || !renderer->frame_valid)
+        return false;
+
+    // clip so both the source and the destination stay inside the frame
+    int height = renderer->frame_key.height;
+    int width = renderer->frame_key.width;
+    if (y0 < 0)
+        y0 = 0;
+    if (y1 > height)
+        y1 = height;
+    if (y0 + dy < 0)
+        y0 = -dy;
+    if (y1 + dy > height)
+        y1 = height - dy;
+    if (y0 >= y1)
+        return true;
+
+    // blits within one framebuffer may not overlap so go through the scratch copy
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->frame_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->scratch_fbo);
+    glBlitFramebuffer(0, y0, width, y1, 0, y0, width, y1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->scratch_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->frame_fbo);
+    glBlitFramebuffer(0, y0, width, y1, 0, y0 + dy, width, y1 + dy, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return true;
+}
+
+// queue a scissored band over rows [top, bottom] and columns [left, right)
+// whole bands also clear the margins around the grid
+static void renderer_emit_band(Renderer *renderer, GridPass *pass, int top, int bottom, int left, int right, bool whole) {
+    const Screen *screen = pass->screen;
+    int rows = screen->rows;
+    int cols = screen->cols;
+
+    if (renderer->band_count == renderer->band_capacity) {
+        size_t capacity = renderer->band_capacity ? renderer->band_capacity * 2 : 16;
+        RendererBand *bands = realloc(renderer->bands, capacity * sizeof(RendererBand));
+        if (!bands)
+            return;
+        renderer->bands = bands;
+        renderer->band_capacity = capacity;
+    }
+
+    // round outward and extend bands touching the grid edge into the margin
+    int width = renderer->frame_key.width;
+    int height = renderer->frame_key.height;
+    int x0 = left == 0 || whole ? 0 : (int)floorf(pass->origin_x + left * x_spacing);
+    int x1 = right == cols || whole ? width : (int)ceilf(pass->origin_x + right * x_spacing);
+    int y0 = bottom == rows - 1 || whole ? 0 : (int)floorf(pass->origin_y + (rows - 1 - bottom) * y_spacing);
+    int y1 = top == 0 || whole ? height : (int)ceilf(pass->origin_y + (rows - top) * y_spacing);
+
+    RendererBand *band = &renderer->bands[renderer->band_count++];
+    band->x = x0;
+    band->y = y0;
+    band->width = x1 > x0 ? x1 - x0 : 0;
+    band->height = y1 > y0 ? y1 - y0 : 0;
+    band->first = 0;
+    band->count = 0;
+    band->first_job = renderer->job_count;
+
+    // neighbouring cells are drawn too so overhangs into the band survive the clear
+    // backgrounds go first so every glyph is drawn over them
+    int emit_top = whole || top == 0 ? top : top - 1;
+    int emit_bottom = whole || bottom == rows - 1 ? bottom : bottom + 1;
+    int emit_left = whole || left == 0 ? left : left - 1;
+    int emit_right = whole || right == cols ? right : right + 1;
+    renderer_queue_jobs(renderer, emit_top, emit_bottom, emit_left, emit_right, true);
+    renderer_queue_jobs(renderer, emit_top, emit_bottom, emit_left, emit_right, false);
+    band->job_count = renderer->job_count - band->first_job;
+
+    renderer->stats.rows_redrawn += (size_t)(bottom - top + 1);
+    renderer->stats.cells_redrawn += (size_t)(bottom - top + 1) * (size_t)(right - left);
+}
+
+// split rows [top, bottom] and columns [left, right) into jobs of about RENDERER_JOB_CELLS
+static void renderer_queue_jobs(Renderer *renderer, int top, int bottom, int left, int right, bool backgrounds) {
+    int width = right - left;
+    int step = width > 0 && width < RENDERER_JOB_CELLS ? RENDERER_JOB_CELLS / width : 1;
+    for (int y = top; y <= bottom; y += step) {
+        if (renderer->job_count == renderer->job_capacity) {
+            size_t capacity = renderer->job_capacity ? renderer->job_capacity * 2 : 64;
+            RendererJob *jobs = realloc(renderer->jobs, capacity * sizeof(RendererJob));
+            if (!jobs)
+                return;
+            renderer->jobs = jobs;
+            renderer->job_capacity = capacity;
+        }
+        RendererJob *job = &renderer->jobs[renderer->job_count++];
+        memset(job, 0, sizeof(*job));
+        job->top = y;
+        job->bottom = y + step - 1 < bottom ? y + step - 1 : bottom;
+        job->left = left;
+        job->right = right;
+        job->backgrounds = backgrounds;
+    }
+}
+
+// fill the slices of every queued job, pack them into the ring and place the bands
+// return false when nothing could be uploaded
+static bool renderer_build_instances(Renderer *renderer, const GridPass *pass, size_t *base) {
+    // a background run or a glyph underline and strike per cell plus the cursor block
+    size_t slots = 0;
+    size_t touches = 0;
+    size_t cells = 0;
+    for (size_t j = 0; j < renderer->job_count; j++) {
+        RendererJob *job = &renderer->jobs[j];
+        size_t job_cells = (size_t)(job->bottom - job->top + 1) * (size_t)(job->right - job->left);
+        job->first = slots;
+        job->touch_first = touches;
+        slots += job->backgrounds ? job_cells : job_cells * 3 + 1;
+        touches += job->backgrounds ? 0 : job_cells;
+        cells += job_cells;
+    }
+    if (!renderer_reserve(renderer, slots))
+        return false;
+    if (touches > renderer->touch_capacity) {
+        uint32_t *touched = realloc(renderer->touched, touches * sizeof(uint32_t));
+        if (!touched)
+            return false;
+        renderer->touched = touched;
+        renderer->touch_capacity = touches;
+    }
+
+    // small redraws cost less than waking the workers
+    WorkPool *pool = NULL;
+    if (cells >= RENDERER_PARALLEL_CELLS && renderer->threads > 0) {
+        if (!renderer->pool.running && work_pool_start(&renderer->pool, renderer->threads) != 0)
+            renderer->threads = 0;
+        if (renderer->pool.running)
+            pool = &renderer->pool;
+    }
+    RendererBuild build = { .renderer = renderer, .pass = pass, .upload = NULL };
+    work_pool_run(pool, renderer->job_count, renderer_run_job, &build);
+    renderer->stats.jobs = renderer->job_count;
+    renderer->stats.threads = pool ? pool->thread_count + 1 : 1;
+
+    // marking found glyphs first keeps them in place while misses are rasterized
+    for (size_t j = 0; j < renderer->job_count; j++) {
+        const RendererJob *job = &renderer->jobs[j];
+        for (size_t i = 0; i < job->touch_count; i++)
+            glyph_cache_use(&glyph_cache, renderer->touched[job->touch_first + i]);
+    }
+    size_t total = 0;
+    for (size_t j = 0; j < renderer->job_count; j++) {
+        RendererJob *job = &renderer->jobs[j];
+        if (job->misses > 0)
+            job->count = renderer_settle_job(renderer, job);
+        job->offset = total;
+        total += job->count;
+    }
+    for (size_t b = 0; b < renderer->band_count; b++) {
+        RendererBand *band = &renderer->bands[b];
+        band->first = band->job_count ? renderer->jobs[band->first_job].offset : total;
+        band->count = 0;
+        for (size_t j = band->first_job; j < band->first_job + band->job_count; j++)
+            band->count += renderer->jobs[j].count;
+    }
+    renderer->instance_count = total;
+    if (total == 0)
+        return false;
+
+    // a mapped ring takes the slices straight from the jobs
+    size_t bytes = total * sizeof(GlyphInstance);
+    build.upload = stream_buffer_reserve(&renderer->stream, bytes, base);
+    if (build.upload) {
+        work_pool_run(pool, renderer->job_count, renderer_copy_job, &build);
+        return true;
+    }
+
+    // otherwise slices are packed in place, each one moving down to its offset
+    for (size_t j = 0; j < renderer->job_count; j++) {
+        const RendererJob *job = &renderer->jobs[j];
+        if (job->offset != job->first && job->count > 0)
+            memmove(renderer->instances + job->offset, renderer->instances + job->first,
+                    job->count * sizeof(GlyphInstance));
+    }
+    return stream_buffer_upload(&renderer->stream, renderer->instances, bytes, base) == 0;
+}
+
+// fill the slice of one job, safe on any thread while the caller waits
+// glyphs are only found in the cache, misses are settled by the caller
+static void renderer_run_job(void *ctx, size_t index) {
+    const RendererBuild *build = ctx;
+    Renderer *renderer = build->renderer;
+    const GridPass *pass = build->pass;
+    const Screen *screen = pass->screen;
+    const StyleTable *styles = &screen->styles;
+
+    RendererWork work;
+    work.job = &renderer->jobs[index];
+    work.out = renderer->instances + work.job->first;
+    work.touched = renderer->touched + work.job->touch_first;
+    const RendererJob *job = work.job;
+
+    // neighbouring cells usually share a style so resolve it once per run
+    CellPaint paint;
+    uint32_t paint_style = UINT32_MAX;
+
+    if (job->backgrounds) {
+        for (int y = job->top; y <= job->bottom; y++) {
+            const Cell *line = screen_row(screen, y);
+            int run_start = -1;
+            uint8_t run_color[4];
+            for (int x = job->left; x <= job->right; x++) {
+                bool has_bg = false;
+                if (x < job->right) {
+                    if (line[x].style != paint_style) {
+                        paint_style = line[x].style;
+                        renderer_resolve(style_table_get(styles, paint_style), pass->fg, pass->bg, &paint);
+                    }
+                    has_bg = paint.has_bg;
+                }
+
+                // close the current run when the background changes
+                if (run_start >= 0 && (!has_bg || memcmp(run_color, paint.bg, 4) != 0)) {
+                    renderer_push_solid(&work, run_start, y, x - run_start, run_color, 0);
+                    run_start = -1;
+                }
+                if (has_bg && run_start < 0) {
+                    run_start = x;
+                    memcpy(run_color, paint.bg, 4);
+                }
+            }
+        }
+        return;
+    }
+
+    // emit one instance per visible glyph and skip blank cells
+    for (size_t i = 0; i < RENDERER_MEMO_SIZE; i++)
+        work.memo[i].key = UINT32_MAX;
+    int cursor_row = screen->cursor_row;
+    int cursor_col = screen->cursor_col;
+    for (int y = job->top; y <= job->bottom; y++) {
+        const Cell *line = screen_row(screen, y);
+        for (int x = job->left; x < job->right; x++) {
+            if (line[x].style != paint_style) {
+                paint_style = line[x].style;
+                renderer_resolve(style_table_get(styles, paint_style), pass->fg, pass->bg, &paint);
+            }
+            uint32_t flags = paint.attrs & STYLE_ITALIC ? GLYPH_INSTANCE_ITALIC : 0;
+
+            if (pass->cursor_visible && y == cursor_row && x == cursor_col) {
+                // cursor block then glyph in inverted colors keeps draw order
+                renderer_push_solid(&work, x, y, 1, pass->fg, 0);
+                renderer_push_glyph(&work, x, y, line[x].codepoint, pass->bg, flags);
+            } else {
+                renderer_push_glyph(&work, x, y, line[x].codepoint, paint.fg, flags);
+                // decorations are shaped in the shader from the instance flags
+                if (paint.attrs & STYLE_UNDERLINE_MASK)
+                    renderer_push_solid(&work, x, y, 1, paint.fg, renderer_underline_flag(paint.attrs));
+                if (paint.attrs & STYLE_STRIKE)
+                    renderer_push_solid(&work, x, y, 1, paint.fg, GLYPH_INSTANCE_STRIKE);
+            }
+        }
+    }
+}
+
+// copy the slice of one job to its place in the mapped ring
+static void renderer_copy_job(void *ctx, size_t index) {
+    const RendererBuild *build = ctx;
+    const RendererJob *job = &build->renderer->jobs[index];
+    if (job->count > 0)
+        memcpy(build->upload + job->offset, build->renderer->instances + job->first, job->count * sizeof(GlyphInstance));
+}
+
+// fill in glyphs a job could not find, rasterizing them now, and return the instances kept
+static size_t renderer_settle_job(Renderer *renderer, RendererJob *job) {
+    GlyphInstance *instances = renderer->instances + job->first;
+    size_t kept = 0;
+    for (size_t i = 0; i < job->count; i++) {
+        GlyphInstance inst = instances[i];
+        if (inst.flags & RENDERER_INSTANCE_PENDING) {
+            // box drawing and blocks fill the cell upright so they join their neighbours
+            uint32_t codepoint = inst.atlas_x | (uint32_t)inst.atlas_y << 16;
+            uint32_t flags = inst.flags & ~RENDERER_INSTANCE_PENDING;
+            const Glyph *glyph = text_lookup_cell_glyph(codepoint);
+            if (glyph)
+                flags = GLYPH_INSTANCE_CELL;
+            else
+                glyph = text_lookup_glyph(codepoint, flags & GLYPH_INSTANCE_ITALIC ? STYLE_ITALIC : 0);
+
+            // glyphs without a bitmap such as space produce no fragments
+            if (!glyph || glyph->width == 0 || glyph->height == 0)
+                continue;
+            inst.atlas_x = glyph->x;
+            inst.atlas_y = glyph->y;
+            inst.atlas_w = glyph->width;
+            inst.atlas_h = glyph->height;
+            inst.bearing_x = glyph->bearing_x;
+            inst.bearing_y = glyph->bearing_y;
+            inst.flags = flags | (uint32_t)glyph->page << GLYPH_INSTANCE_PAGE_SHIFT;
+        }
+        instances[kept++] = inst;
+    }
+    return kept;
+}
+
+static bool renderer_reserve(Renderer *renderer, size_t count) {
+    if (count <= renderer->instance_capacity)
+        return true;
+
+    // grow staging array geometrically to avoid per frame reallocations
+    size_t capacity = renderer->instance_capacity ? renderer->instance_capacity : 1024;
+    while (capacity < count)
+        capacity *= 2;
+
+    GlyphInstance *instances = realloc(renderer->instances, capacity * sizeof(GlyphInstance));
+    if (!instances)
+        return false;
+
+    renderer->instances = instances;
+    renderer->instance_capacity = capacity;
+    return true;
+}
+
+static void renderer_push_glyph(RendererWork *work, int col, int row, uint32_t codepoint, const uint8_t color[4],
+                                uint32_t flags) {
+    // runs of the same character are common so each job keeps the glyphs it found last
+    uint32_t key = codepoint | (flags & GLYPH_INSTANCE_ITALIC ? 1u << 31 : 0);
+    RendererMemo *memo = &work->memo[(codepoint ^ codepoint >> 6) & (RENDERER_MEMO_SIZE - 1)];
+    if (memo->key != key) {
+        memo->key = key;
+        memo->id = text_find_glyph(codepoint, flags & GLYPH_INSTANCE_ITALIC ? STYLE_ITALIC : 0, &memo->cell);
+        if (memo->id != GLYPH_ENTRY_NONE)
+            work->touched[work->job->touch_count++] = memo->id;
+    }
+
+    GlyphInstance *inst = &work->out[work->job->count];
+    inst->col = (uint16_t)col;
+    inst->row = (uint16_t)row;
+    inst->color[0] = color[0];
+    inst->color[1] = color[1];
+    inst->color[2] = color[2];
+    inst->color[3] = color[3];
+
+    // a miss keeps the codepoint in the atlas fields until the caller looks it up
+    if (memo->id == GLYPH_ENTRY_NONE) {
+        inst->atlas_x = (uint16_t)codepoint;
+        inst->atlas_y = (uint16_t)(codepoint >> 16);
+        inst->flags = flags | RENDERER_INSTANCE_PENDING;
+        work->job->count++;
+        work->job->misses++;
+        return;
+    }
+
+    // glyphs without a bitmap such as space produce no fragments
+    const Glyph *glyph = &glyph_cache.entries[memo->id].glyph;
+    if (glyph->width == 0 || glyph->height == 0)
+        return;
+
+    // box drawing and blocks fill the cell upright so they join their neighbours
+    if (memo->cell)
+        flags = GLYPH_INSTANCE_CELL;
+    inst->atlas_x = glyph->x;
+    inst->atlas_y = glyph->y;
+    inst->atlas_w = glyph->width;
+    inst->atlas_h = glyph->height;
+    inst->bearing_x = glyph->bearing_x;
+    inst->bearing_y = glyph->bearing_y;
+    inst->flags = flags | (uint32_t)glyph->page << GLYPH_INSTANCE_PAGE_SHIFT;
+    work->job->count++;
+}
+
+uint32_t renderer_underline_flag(uint32_t attrs) {
+    if (attrs & STYLE_DOUBLE_UNDERLINE)
+        return GLYPH_INSTANCE_DOUBLE_UNDERLINE;
+    if (attrs & STYLE_UNDERCURL)
+        return GLYPH_INSTANCE_UNDERCURL;
+    return GLYPH_INSTANCE_UNDERLINE;
+}
+
+static void renderer_push_solid(RendererWork *work, int col, int row, int span, const uint8_t color[4], uint32_t flags) {
+    GlyphInstance *inst = &work->out[work->job->count++];
+    inst->col = (uint16_t)col;
+    inst->row = (uint16_t)row;
+    inst->atlas_x = 0;
+    inst->atlas_y = 0;
+    inst->atlas_w = (uint16_t)span;
+    inst->atlas_h = 0;
+    inst->bearing_x = 0;
+    inst->bearing_y = 0;
+    inst->color[0] = color[0];
+    inst->color[1] = color[1];
+    inst->color[2] = color[2];
+    inst->color[3] = color[3];
+    inst->flags = GLYPH_INSTANCE_SOLID | flags;
+}
+
+// return the rgb value of a 256 color palette index
+static void palette_color(int index, uint8_t out[4]) {
+    // xterm default values for the 16 ansi colors
+    static const uint8_t ansi[16][3] = {
+        {0, 0, 0},       {205, 0, 0},     {0, 205, 0},     {205, 205, 0},
+        {0, 0, 238},     {205, 0, 205},   {0, 205, 205},   {229, 229, 229},
+        {127, 127, 127}, {255, 0, 0},     {0, 255, 0},     {255, 255, 0},
+        {92, 92, 255},   {255, 0, 255},   {0, 255, 255},   {255, 255, 255},
+    };
+
+    if (index < 16) {
+        out[0] = ansi[index][0];
+        out[1] = ansi[index][1];
+        out[2] = ansi[index][2];
+    } else if (index < 232) {
+        // 6x6x6 color cube
+        static const uint8_t levels[6] = {0, 95, 135, 175, 215, 255};
+        int cube = index - 16;
+        out[0] = levels[cube / 36];
+        out[1] = levels[(cube / 6) % 6];
+        out[2] = levels[cube % 6];
+    } else {
+        // 24 step grayscale ramp
+        uint8_t gray = (uint8_t)(8 + (index - 232) * 10);
+        out[0] = gray;
+        out[1] = gray;
+        out[2] = gray;
+    }
+    out[3] = 255;
+}
+
+static void resolve_color(uint32_t color, bool bold, const uint8_t fallback[4], uint8_t out[4]) {
+    switch (STYLE_COLOR_KIND(color)) {
+    case STYLE_COLOR_INDEXED:
+        {
+            // bold brightens the eight base colors
+            int index = (int)STYLE_COLOR_VALUE(color);
+            palette_color(bold && index < 8 ? index + 8 : index, out);
+        }
+        break;
+    case STYLE_COLOR_RGB:
+        out[0] = (uint8_t)(color >> 16);
+        out[1] = (uint8_t)(color >> 8);
+        out[2] = (uint8_t)color;
+        out[3] = 255;
+        break;
+    default:
+        memcpy(out, fallback, 4);
+        break;
+    }
+}
+
+void renderer_resolve(const Style *style, const uint8_t fg[4], const uint8_t bg[4], CellPaint *paint) {
+    resolve_color(style->fg, style->attrs & STYLE_BOLD, fg, paint->fg);
+    resolve_color(style->bg, false, bg, paint->bg);
+    paint->has_bg = STYLE_COLOR_KIND(style->bg) != STYLE_COLOR_DEFAULT;
+    paint->attrs = style->attrs;
+
+    if (style->attrs & STYLE_INVERSE) {
+        uint8_t swap[4];
+        memcpy(swap, paint->fg, 4);
+        memcpy(paint->fg, paint->bg, 4);
+        memcpy(paint->bg, swap, 4);
+        paint->has_bg = true;
+    }
+
+    // dim blends the foreground a third of the way toward the background
+    if (style->attrs & STYLE_DIM) {
+        for (int i = 0; i < 3; i++)
+            paint->fg[i] = (uint8_t)((paint->fg[i] * 2 + paint->bg[i]) / 3);
+    }
+}
+
+static void pack_color(const vec3 src, uint8_t dst[4]) {
+    // convert normalized color into rgba8 for compact instances
+    for (int i = 0; i < 3; i++) {
+        float v = src[i] < 0.0f ? 0.0f : (src[i] > 1.0f ? 1.0f : src[i]);
+        dst[i] = (uint8_t)(v * 255.0f + 0.5f);
+    }
+    dst[3] = 255;
+}
@@ -0,0 +1,279 @@
+#include <renderer_grid.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <shader.h>
+#include <text.h>
+
+// create an integer texture sampled texel by texel
+static void renderer_grid_texture(GLuint texture, GLenum internal, GLenum format, int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, (GLint)internal, width, height, 0, format, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+int renderer_grid_init(RendererGrid *grid) {
+    if (!grid)
+        return -1;
+
+    memset(grid, 0, sizeof(*grid));
+    grid->program = initialize_grid_shader();
+    if (!grid->program)
+        return -1;
+
+    GLuint program = grid->program;
+    grid->origin_location = glGetUniformLocation(program, "origin");
+    grid->cell_size_location = glGetUniformLocation(program, "cell_size");
+    grid->grid_size_location = glGetUniformLocation(program, "grid_size");
+    grid->baseline_location = glGetUniformLocation(program, "baseline");
+    grid->scale_location = glGetUniformLocation(program, "scale");
+    grid->underline_location = glGetUniformLocation(program, "underline");
+    grid->strike_location = glGetUniformLocation(program, "strike");
+    grid->cursor_location = glGetUniformLocation(program, "cursor");
+    grid->default_fg_location = glGetUniformLocation(program, "default_fg");
+    grid->default_bg_location = glGetUniformLocation(program, "default_bg");
+    grid->distance_field_location = glGetUniformLocation(program, "distance_field");
+
+    glGenVertexArrays(1, &grid->vao);
+    glGenTextures(1, &grid->cell_texture);
+    glGenTextures(1, &grid->style_texture);
+    glGenTextures(1, &grid->row_texture);
+    return 0;
+}
+
+void renderer_grid_free(RendererGrid *grid) {
+    if (!grid)
+        return;
+
+    if (grid->program)
+        glDeleteProgram(grid->program);
+    if (grid->vao)
+        glDeleteVertexArrays(1, &grid->vao);
+    if (grid->cell_texture)
+        glDeleteTextures(1, &grid->cell_texture);
+    if (grid->style_texture)
+        glDeleteTextures(1, &grid->style_texture);
+    if (grid->row_texture)
+        glDeleteTextures(1, &grid->row_texture);
+    free(grid->texels);
+    free(grid->styles);
+    free(grid->row_map);
+    memset(grid, 0, sizeof(*grid));
+}
+
+// size staging and textures for a new grid whose pool holds pool_rows rows
+static int renderer_grid_resize(RendererGrid *grid, int cols, int rows, int pool_rows) {
+    uint32_t *texels = realloc(grid->texels, (size_t)cols * 4 * sizeof(uint32_t));
+    if (texels)
+        grid->texels = texels;
+    uint32_t *row_map = realloc(grid->row_map, (size_t)rows * sizeof(uint32_t));
+    if (row_map)
+        grid->row_map = row_map;
+    if (!texels || !row_map)
+        return -1;
+
+    renderer_grid_texture(grid->cell_texture, GL_RGBA32UI, GL_RGBA_INTEGER, cols, pool_rows);
+    renderer_grid_texture(grid->row_texture, GL_R32UI, GL_RED_INTEGER, rows, 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return 0;
+}
+
+// rebuild columns [start, end) of a row in the texture row of its pool slot
+static void renderer_grid_upload_row(RendererGrid *grid, const Screen *screen, int row, int start, int end) {
+    const Cell *cells = screen_row(screen, row);
+    int pool = screen_pool_row(screen, row);
+    uint32_t style_id = UINT32_MAX;
+    uint32_t glyph_style = 0;
+    uint32_t *texel = grid->texels;
+
+    for (int x = start; x < end; x++, texel += 4) {
+        // italic text looks up its own glyph variant
+        if (cells[x].style != style_id) {
+            style_id = cells[x].style;
+            glyph_style = style_table_get(&screen->styles, style_id)->attrs & STYLE_ITALIC;
+        }
+
+        uint32_t flags = RENDERER_GRID_GLYPH | RENDERER_GRID_CELL_GLYPH;
+        const Glyph *glyph = text_lookup_cell_glyph(cells[x].codepoint);
+        if (!glyph) {
+            flags = RENDERER_GRID_GLYPH;
+            glyph = text_lookup_glyph(cells[x].codepoint, glyph_style);
+        }
+        if (!glyph || glyph->width == 0 || glyph->height == 0) {
+            texel[0] = 0;
+            texel[1] = 0;
+            texel[2] = 0;
+            texel[3] = style_id;
+            continue;
+        }
+        texel[0] = glyph->x | (uint32_t)glyph->y << 16;
+        texel[1] = glyph->width | (uint32_t)glyph->height << 16;
+        texel[2] = (uint16_t)glyph->bearing_x | (uint32_t)(uint16_t)glyph->bearing_y << 16;
+        texel[3] = style_id | (uint32_t)(glyph->page & 0xFF) << 16 | flags << 24;
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, start, pool, end - start, 1, GL_RGBA_INTEGER, GL_UNSIGNED_INT, grid->texels);
+}
+
+// resolve every style id and upload the table when anything changed
+static void renderer_grid_upload_styles(RendererGrid *grid, const StyleTable *table, const uint8_t fg[4],
+                                        const uint8_t bg[4]) {
+    size_t count = table->count;
+    bool changed = count != grid->style_count;
+    if (count > grid->style_capacity) {
+        size_t capacity = (count + RENDERER_GRID_STYLE_WIDTH - 1) / RENDERER_GRID_STYLE_WIDTH * RENDERER_GRID_STYLE_WIDTH;
+        uint32_t *styles = calloc(capacity * 4, sizeof(uint32_t));
+        if (!styles)
+            return;
+        free(grid->styles);
+        grid->styles = styles;
+        grid->style_capacity = capacity;
+        renderer_grid_texture(grid->style_texture, GL_RGBA32UI, GL_RGBA_INTEGER, RENDERER_GRID_STYLE_WIDTH,
+                              (int)(capacity / RENDERER_GRID_STYLE_WIDTH));
+        changed = true;
+    }
+
+    // ids are few so resolving all of them costs less than tracking changes
+    for (size_t id = 0; id < count; id++) {
+        CellPaint paint;
+        renderer_resolve(style_table_get(table, (uint32_t)id), fg, bg, &paint);
+        uint32_t flags = paint.attrs & STYLE_ITALIC ? GLYPH_INSTANCE_ITALIC : 0;
+        if (paint.attrs & STYLE_UNDERLINE_MASK)
+            flags |= renderer_underline_flag(paint.attrs);
+        if (paint.attrs & STYLE_STRIKE)
+            flags |= GLYPH_INSTANCE_STRIKE;
+
+        uint32_t texel[4] = {
+            paint.fg[0] | (uint32_t)paint.fg[1] << 8 | (uint32_t)paint.fg[2] << 16,
+            paint.bg[0] | (uint32_t)paint.bg[1] << 8 | (uint32_t)paint.bg[2] << 16,
+            flags,
+            0,
+        };
+        if (memcmp(&grid->styles[id * 4], texel, sizeof(texel)) != 0) {
+            memcpy(&grid->styles[id * 4], texel, sizeof(texel));
+            changed = true;
+        }
+    }
+    grid->style_count = count;
+
+    if (changed) {
+        int height = (int)((count + RENDERER_GRID_STYLE_WIDTH - 1) / RENDERER_GRID_STYLE_WIDTH);
+        glBindTexture(GL_TEXTURE_2D, grid->style_texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, RENDERER_GRID_STYLE_WIDTH, height, GL_RGBA_INTEGER, GL_UNSIGNED_INT,
+                        grid->styles);
+    }
+}
+
+void renderer_grid_draw(RendererGrid *grid, const Screen *screen, bool cursor_visible, const RendererLayout *layout,
+                        const uint8_t fg[4], const uint8_t bg[4], RendererStats *stats) {
+    if (!grid || !screen || !screen->cells)
+        return;
+
+    int cols = screen->cols;
+    int rows = screen->rows;
+
+    // cells store atlas placements so anything moving glyphs invalidates them
+    RendererGridKey key;
+    memset(&key, 0, sizeof(key));
+    key.cols = cols;
+    key.rows = rows;
+    key.pool_rows = screen->pool_rows;
+    key.cell_width = x_spacing;
+    key.cell_height = y_spacing;
+    key.glyph_scale = layout->glyph_scale;
+    key.glyph_pixel_size = glyph_pixel_size;
+    key.glyph_mode = (uint32_t)glyph_cache.mode;
+    key.glyph_moves = glyph_cache.stats.evictions + glyph_cache.stats.compactions;
+
+    if (!grid->valid || grid->key.cols != cols || grid->key.rows != rows || grid->key.pool_rows != key.pool_rows) {
+        if (renderer_grid_resize(grid, cols, rows, key.pool_rows) != 0) {
+            grid->valid = false;
+            return;
+        }
+    }
+    bool full = !grid->valid || memcmp(&grid->key, &key, sizeof(key)) != 0 || screen->damage.all;
+
+    stats->cells_redrawn = 0;
+    stats->rows_redrawn = 0;
+    stats->rows_scrolled = 0;
+    stats->bands = 0;
+
+    // only damaged cells are uploaded, scrolled rows keep their pool slot
+    glBindTexture(GL_TEXTURE_2D, grid->cell_texture);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int y = 0; y < rows; y++) {
+            int start = 0;
+            int end = cols;
+            if (!full) {
+                if (!screen_damage_row_dirty(&screen->damage, y))
+                    continue;
+                screen_damage_span(&screen->damage, y, &start, &end);
+                if (start >= end)
+                    continue;
+            }
+            renderer_grid_upload_row(grid, screen, y, start, end);
+            stats->cells_redrawn += (size_t)(end - start);
+            stats->rows_redrawn++;
+        }
+
+        // lookups may have evicted glyphs that untouched rows still point at
+        // a full pass keeps every glyph it placed so one more is enough
+        uint64_t moves = glyph_cache.stats.evictions + glyph_cache.stats.compactions;
+        if (full || moves == key.glyph_moves)
+            break;
+        full = true;
+    }
+    if (full)
+        stats->full_redraws++;
+    key.glyph_moves = glyph_cache.stats.evictions + glyph_cache.stats.compactions;
+    grid->key = key;
+    grid->valid = true;
+
+    // the row map is what scrolls move so it is sent every frame
+    for (int y = 0; y < rows; y++)
+        grid->row_map[y] = (uint32_t)screen_pool_row(screen, y);
+    glBindTexture(GL_TEXTURE_2D, grid->row_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, rows, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, grid->row_map);
+    renderer_grid_upload_styles(grid, &screen->styles, fg, bg);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    stats->frames++;
+
+    glUseProgram(grid->program);
+    glUniform2f(grid->origin_location, layout->origin_x, layout->origin_y);
+    glUniform2f(grid->cell_size_location, x_spacing, y_spacing);
+    glUniform2i(grid->grid_size_location, cols, rows);
+    glUniform1f(grid->baseline_location, layout->baseline);
+    glUniform1f(grid->scale_location, layout->glyph_scale);
+    glUniform2f(grid->underline_location, layout->underline[0], layout->underline[1]);
+    glUniform2f(grid->strike_location, layout->strike[0], layout->strike[1]);
+    glUniform3i(grid->cursor_location, screen->cursor_col, screen->cursor_row, cursor_visible);
+    glUniform3f(grid->default_fg_location, fg[0] / 255.0f, fg[1] / 255.0f, fg[2] / 255.0f);
+    glUniform3f(grid->default_bg_location, bg[0] / 255.0f, bg[1] / 255.0f, bg[2] / 255.0f);
+    glUniform1i(grid->distance_field_location, glyph_cache.mode == GLYPH_MODE_SDF);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, glyph_cache.texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, grid->cell_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, grid->style_texture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, grid->row_texture);
+
+    // every pixel of the window is shaded so nothing needs clearing
+    glBindVertexArray(grid->vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
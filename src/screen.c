@@ -0,0 +1,948 @@
+#include <screen.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cell_kernel.h>
+#include <scrollback.h>
+
+// decoded codepoints buffered between flushes
+#define SCREEN_TEXT_POOL 16384
+// cells a print is staged in before comparing with the row
+#define SCREEN_PRINT_STAGE 256
+// pools reserve this fraction more rows and columns than the grid shows
+#define SCREEN_SPARE_DIVISOR 4
+
+// one logical line of the grid, rows joined by soft wraps
+typedef struct ScreenReflowLine {
+    int row;        // first row it starts on
+    int rows;       // rows it spans
+    size_t length;  // cells up to the last one that is not a default blank
+    int target;     // first row of the rewrapped layout
+    int targets;    // rows it takes at the new width
+} ScreenReflowLine;
+
+static void screen_emit(Screen *screen, ScreenOp op);
+static void screen_apply(Screen *screen, const ScreenOp *op);
+static void screen_apply_queued(Screen *screen);
+static void screen_acquire_cells(Screen *screen, const Cell *cells, size_t count);
+static void screen_release_cells(Screen *screen, const Cell *cells, size_t count);
+
+// rows or columns a pool holds for a grid of n, spare room absorbs window drags
+static int screen_capacity(int n) {
+    return n + n / SCREEN_SPARE_DIVISOR;
+}
+
+// allocate a blank row pool and point lines at consecutive rows
+static int screen_alloc_rows(int stride, int rows, Cell **out_cells, Line **out_lines) {
+    Cell *cells = malloc((size_t)stride * (size_t)rows * sizeof(Cell));
+    Line *lines = malloc((size_t)rows * sizeof(Line));
+    if (!cells || !lines) {
+        free(cells);
+        free(lines);
+        return -1;
+    }
+
+    cell_fill(cells, (size_t)stride * (size_t)rows, (Cell){ ' ', STYLE_DEFAULT_ID });
+    for (int r = 0; r < rows; r++)
+        lines[r] = (Line){ cells + (size_t)r * stride, STYLE_DEFAULT_ID, false };
+
+    *out_cells = cells;
+    *out_lines = lines;
+    return 0;
+}
+
+int screen_init(Screen *screen, int cols, int rows) {
+    if (!screen || cols < 1 || rows < 1)
+        return -1;
+
+    // reset cursor margins and queued operations
+    screen->cells = NULL;
+    screen->lines = NULL;
+    screen->back_cells = NULL;
+    screen->back_lines = NULL;
+    screen->line_base = 0;
+    screen->cols = cols;
+    screen->rows = rows;
+    screen->stride = screen_capacity(cols);
+    screen->pool_rows = screen_capacity(rows);
+    screen->cursor_row = 0;
+    screen->cursor_col = 0;
+    screen->scroll_top = 0;
+    screen->scroll_bottom = rows - 1;
+    screen->pen = (Style){0};
+    screen->pen_style = STYLE_DEFAULT_ID;
+    screen->erase_style = STYLE_DEFAULT_ID;
+    screen->ops = (ScreenOpList){0};
+    screen->damage = (ScreenDamage){0};
+    screen->text_used = 0;
+    screen->text_capacity = SCREEN_TEXT_POOL;
+    screen->trace = NULL;
+    screen->history = NULL;
+
+    if (style_table_init(&screen->styles) != 0)
+        return -1;
+    screen->text = malloc(SCREEN_TEXT_POOL * sizeof(uint32_t));
+    if (!screen->text)
+        return -1;
+    if (screen_alloc_rows(screen->stride, screen->pool_rows, &screen->cells, &screen->lines) != 0)
+        return -1;
+    return screen_damage_init(&screen->damage, cols, rows);
+}
+
+// return the cells of a row up to the last one that is not a default blank
+static size_t screen_text_length(const Cell *cells, size_t cols) {
+    while (cols > 0 && cells[cols - 1].codepoint == ' ' && cells[cols - 1].style == STYLE_DEFAULT_ID)
+        cols--;
+    return cols;
+}
+
+// hand a row leaving the top of the screen to history
+// soft wrapped rows keep their trailing blanks since the text carries on after them
+static void screen_keep_line(Screen *screen, const Line *line) {
+    size_t length = line->wrapped                      ? (size_t)screen->cols
+                    : line->blank == STYLE_DEFAULT_ID ? 0
+                                                       : screen_text_length(line->cells, (size_t)screen->cols);
+    scrollback_push(screen->history, line->cells, length, line->wrapped);
+}
+
+// drop the references of a whole row of cols cells
+static void screen_release_line(Screen *screen, const Line *line, int cols) {
+    if (line->blank != SCREEN_LINE_MIXED)
+        style_table_release(&screen->styles, line->blank, (uint32_t)cols);
+    else
+        screen_release_cells(screen, line->cells, (size_t)cols);
+}
+
+// split the grid into logical lines and lay them out at a new width
+// returns the line count, the layout position of the cursor and the rows up to the last text
+static int screen_reflow_layout(const Screen *screen, int cols, ScreenReflowLine *layout, int *cursor_row,
+                                int *cursor_col, int *used) {
+    size_t old_cols = (size_t)screen->cols;
+    int count = 0;
+    int target = 0;
+    *cursor_row = 0;
+    *cursor_col = 0;
+    *used = 0;
+
+    for (int row = 0; row < screen->rows;) {
+        ScreenReflowLine *line = &layout[count++];
+        line->row = row;
+        while (row < screen->rows - 1 && screen_line(screen, row)->wrapped)
+            row++;
+        row++;
+        line->rows = row - line->row;
+
+        // wrapped rows were filled by text so only the last one can end in blanks
+        size_t end = screen_text_length(screen_row(screen, row - 1), old_cols);
+        line->length = (size_t)(line->rows - 1) * old_cols + end;
+
+        // the cursor keeps its offset into the line even past the text
+        size_t needed = line->length;
+        bool cursor = screen->cursor_row >= line->row && screen->cursor_row < row;
+        if (cursor) {
+            size_t offset = (size_t)(screen->cursor_row - line->row) * old_cols + (size_t)screen->cursor_col;
+            *cursor_row = target + (int)(offset / (size_t)cols);
+            *cursor_col = (int)(offset % (size_t)cols);
+            if (needed < offset + 1)
+                needed = offset + 1;
+        }
+
+        // text ending on the last column keeps the empty row it wrapped onto
+        int text_rows = (int)((line->length + (size_t)cols - 1) / (size_t)cols);
+        if (line->rows > 1 && end == 0 && line->length % (size_t)cols == 0 && needed < line->length + 1)
+            needed = line->length + 1;
+
+        line->target = target;
+        line->targets = needed > 0 ? (int)((needed + (size_t)cols - 1) / (size_t)cols) : 1;
+        if (line->length > 0)
+            *used = target + text_rows;
+        if (cursor && *used < *cursor_row + 1)
+            *used = *cursor_row + 1;
+        target += line->targets;
+    }
+    return count;
+}
+
+// fill rows [0, rows) of lines with layout rows [skip, skip + rows) at the new width
+// layout rows above skip are built in the first row and go to history
+static void screen_reflow_copy(Screen *screen, const ScreenReflowLine *layout, int count, Line *lines, int cols,
+                               int rows, int skip) {
+    size_t old_cols = (size_t)screen->cols;
+    int i = 0;
+    for (int target = screen->history ? 0 : skip; target < skip + rows; target++) {
+        while (i < count && layout[i].target + layout[i].targets <= target)
+            i++;
+
+        bool kept = target < skip;
+        Line *dst = &lines[kept ? 0 : target - skip];
+        Cell *out = dst->cells;
+        dst->wrapped = false;
+        if (i < count) {
+            const ScreenReflowLine *line = &layout[i];
+            size_t from = (size_t)(target - line->target) * (size_t)cols;
+            size_t to = from + (size_t)cols < line->length ? from + (size_t)cols : line->length;
+            // the last row keeps the wrap of text printed up to the last column
+            if (target < line->target + line->targets - 1)
+                dst->wrapped = true;
+            else
+                dst->wrapped = screen_line(screen, line->row + line->rows - 1)->wrapped;
+
+            // a row of the new width can take cells from two old rows
+            while (from < to) {
+                const Cell *src = screen_row(screen, line->row + (int)(from / old_cols));
+                size_t col = from % old_cols;
+                size_t span = old_cols - col < to - from ? old_cols - col : to - from;
+                cell_copy(out, src + col, span);
+                out += span;
+                from += span;
+            }
+        }
+
+        size_t filled = (size_t)(out - dst->cells);
+        if (kept) {
+            // soft wrapped rows go whole so their line joins up again in history
+            if (dst->wrapped) {
+                cell_fill(out, (size_t)cols - filled, (Cell){ ' ', STYLE_DEFAULT_ID });
+                filled = (size_t)cols;
+            }
+            scrollback_push(screen->history, dst->cells, filled, dst->wrapped);
+            continue;
+        }
+        screen_acquire_cells(screen, dst->cells, filled);
+
+        // the pool is reused so the rest of the row is blanked explicitly
+        cell_fill(out, (size_t)cols - filled, (Cell){ ' ', STYLE_DEFAULT_ID });
+        dst->blank = filled > 0 ? SCREEN_LINE_MIXED : STYLE_DEFAULT_ID;
+    }
+}
+
+// return true when a new width leaves the text of every row on that row
+static bool screen_fits_width(const Screen *screen, int cols) {
+    if (screen->cursor_col >= cols)
+        return false;
+    for (int r = 0; r < screen->rows; r++) {
+        const Line *line = screen_line(screen, r);
+        // wrapped lines would be joined or split
+        if (line->wrapped)
+            return false;
+        // rows erased in a colour count as text and rewrap like it
+        if (cols < screen->cols && line->blank != STYLE_DEFAULT_ID &&
+            (line->blank != SCREEN_LINE_MIXED || screen_text_length(line->cells, (size_t)screen->cols) > (size_t)cols))
+            return false;
+    }
+    return true;
+}
+
+// return the rows up to the last one holding text or the cursor
+static int screen_used_rows(const Screen *screen) {
+    for (int r = screen->rows - 1; r > screen->cursor_row; r--) {
+        const Line *line = screen_line(screen, r);
+        if (line->blank == SCREEN_LINE_MIXED ? screen_text_length(line->cells, (size_t)screen->cols) > 0
+                                             : line->blank != STYLE_DEFAULT_ID)
+            return r + 1;
+    }
+    return screen->cursor_row + 1;
+}
+
+// reverse lines [first, last)
+static void screen_reverse_lines(Line *lines, int first, int last) {
+    for (last--; first < last; first++, last--) {
+        Line saved = lines[first];
+        lines[first] = lines[last];
+        lines[last] = saved;
+    }
+}
+
+// resize inside the pool moving row pointers but no cells
+// logical row skip becomes the top row and rows past the new height turn spare
+static void screen_resize_in_place(Screen *screen, int cols, int rows, int skip) {
+    int old_cols = screen->cols;
+    int old_rows = screen->rows;
+    Line *lines = screen->lines;
+    const Cell blank = { ' ', STYLE_DEFAULT_ID };
+
+    if (screen->history) {
+        for (int r = 0; r < skip; r++)
+            screen_keep_line(screen, screen_line(screen, r));
+    }
+
+    // rotate the ring so it starts at slot zero with the first kept row
+    int shift = (screen->line_base + skip) % old_rows;
+    screen_reverse_lines(lines, 0, shift);
+    screen_reverse_lines(lines, shift, old_rows);
+    screen_reverse_lines(lines, 0, old_rows);
+
+    for (int r = rows; r < old_rows; r++)
+        screen_release_line(screen, &lines[r], old_cols);
+
+    // kept rows gain blank columns or lose default blanks at the right edge
+    int kept = rows < old_rows ? rows : old_rows;
+    for (int r = 0; r < kept; r++) {
+        Line *line = &lines[r];
+        if (cols > old_cols) {
+            cell_fill(line->cells + old_cols, (size_t)(cols - old_cols), blank);
+            if (line->blank != STYLE_DEFAULT_ID)
+                line->blank = SCREEN_LINE_MIXED;
+        }
+    }
+
+    // spare rows still hold whatever they showed last
+    for (int r = old_rows; r < rows; r++) {
+        cell_fill(lines[r].cells, (size_t)cols, blank);
+        lines[r].blank = STYLE_DEFAULT_ID;
+        lines[r].wrapped = false;
+    }
+    screen->line_base = 0;
+    screen->cursor_row -= skip;
+}
+
+// rewrap every logical line into the back pool and swap the pools
+static int screen_resize_reflow(Screen *screen, int cols, int rows) {
+    // a grid past the pool gets a larger pool and the old one is dropped after the copy
+    int stride = screen->stride;
+    int pool_rows = screen->pool_rows;
+    bool grow = cols > stride || rows > pool_rows;
+    if (grow) {
+        stride = cols > stride ? screen_capacity(cols) : stride;
+        pool_rows = rows > pool_rows ? screen_capacity(rows) : pool_rows;
+    }
+    if (grow || !screen->back_cells) {
+        Cell *cells;
+        Line *lines;
+        if (screen_alloc_rows(stride, pool_rows, &cells, &lines) != 0)
+            return -1;
+        free(screen->back_cells);
+        free(screen->back_lines);
+        screen->back_cells = cells;
+        screen->back_lines = lines;
+    }
+
+    ScreenReflowLine *layout = malloc((size_t)screen->rows * sizeof(ScreenReflowLine));
+    if (!layout)
+        return -1;
+    if (screen_damage_resize(&screen->damage, cols, rows, pool_rows) != 0) {
+        free(layout);
+        return -1;
+    }
+
+    // rewrap logical lines and keep the cursor line when they no longer fit
+    int cursor_row;
+    int cursor_col;
+    int used;
+    int count = screen_reflow_layout(screen, cols, layout, &cursor_row, &cursor_col, &used);
+    int skip = used > rows ? used - rows : 0;
+    if (skip > cursor_row)
+        skip = cursor_row;
+    screen_reflow_copy(screen, layout, count, screen->back_lines, cols, rows, skip);
+    free(layout);
+
+    // copies took their own references so the old rows drop all of theirs
+    for (int r = 0; r < screen->rows; r++)
+        screen_release_line(screen, screen_line(screen, r), screen->cols);
+
+    Cell *cells = screen->cells;
+    Line *lines = screen->lines;
+    screen->cells = screen->back_cells;
+    screen->lines = screen->back_lines;
+    if (grow) {
+        free(cells);
+        free(lines);
+        screen->back_cells = NULL;
+        screen->back_lines = NULL;
+    } else {
+        screen->back_cells = cells;
+        screen->back_lines = lines;
+    }
+    screen->stride = stride;
+    screen->pool_rows = pool_rows;
+    screen->line_base = 0;
+    screen->cursor_row = cursor_row - skip;
+    screen->cursor_col = cursor_col;
+    return 0;
+}
+
+int screen_resize(Screen *screen, int cols, int rows) {
+    if (!screen || !screen->cells || cols < 1 || rows < 1)
+        return -1;
+    if (cols == screen->cols && rows == screen->rows)
+        return 0;
+
+    // queued operations still address the old geometry
+    screen_apply_queued(screen);
+
+    // a full screen region keeps covering the whole screen
+    bool full_region = screen->scroll_top == 0 && screen->scroll_bottom == screen->rows - 1;
+
+    bool in_place = cols <= screen->stride && rows <= screen->pool_rows &&
+                    (cols == screen->cols || screen_fits_width(screen, cols));
+    if (in_place) {
+        if (screen_damage_resize(&screen->damage, cols, rows, screen->pool_rows) != 0)
+            return -1;
+        int skip = 0;
+        if (rows < screen->rows) {
+            int used = screen_used_rows(screen);
+            skip = used > rows ? used - rows : 0;
+            if (skip > screen->cursor_row)
+                skip = screen->cursor_row;
+        }
+        screen_resize_in_place(screen, cols, rows, skip);
+    } else if (screen_resize_reflow(screen, cols, rows) != 0) {
+        return -1;
+    }
+    screen->cols = cols;
+    screen->rows = rows;
+
+    // clamp margins into the new bounds
+    if (full_region) {
+        screen->scroll_top = 0;
+        screen->scroll_bottom = rows - 1;
+    } else {
+        if (screen->scroll_top >= rows)
+            screen->scroll_top = rows - 1;
+        if (screen->scroll_bottom >= rows)
+            screen->scroll_bottom = rows - 1;
+        if (screen->scroll_bottom < screen->scroll_top)
+            screen->scroll_bottom = screen->scroll_top;
+    }
+    return 0;
+}
+
+void screen_free(Screen *screen) {
+    if (!screen)
+        return;
+    free(screen->cells);
+    free(screen->lines);
+    free(screen->back_cells);
+    free(screen->back_lines);
+    free(screen->text);
+    screen->cells = NULL;
+    screen->lines = NULL;
+    screen->back_cells = NULL;
+    screen->back_lines = NULL;
+    screen->text = NULL;
+    screen_damage_free(&screen->damage);
+    screen_ops_free(&screen->ops);
+    style_table_free(&screen->styles);
+}
+
+// apply every queued operation in order
+static void screen_apply_queued(Screen *screen) {
+    ScreenOpList *list = &screen->ops;
+    if (list->count == 0)
+        return;
+
+    // trace records the stream as the parser produced it
+    if (screen->trace)
+        screen_ops_trace(screen->trace, list->ops, list->count);
+
+    screen_ops_coalesce(list);
+    for (size_t i = 0; i < list->count; i++)
+        screen_apply(screen, &list->ops[i]);
+    list->count = 0;
+}
+
+void screen_flush(Screen *screen) {
+    screen_apply_queued(screen);
+
+    // styles released by the applied ops can be reused from here on
+    style_table_collect(&screen->styles);
+
+    // carriage returns and wraps move the cursor without queueing a move
+    screen_damage_cursor(&screen->damage, screen->cursor_row, screen->cursor_col);
+}
+
+void screen_print_run(Screen *screen, const uint8_t *data, size_t len) {
+    // queue as much of the run as fits on each row and wrap once per line
+    while (len > 0) {
+        size_t space = (size_t)(screen->cols - screen->cursor_col);
+        size_t chunk = len < space ? len : space;
+
+        screen_emit(screen, (ScreenOp){
+            .type = SCREEN_OP_PRINT,
+            .flags = chunk == space ? SCREEN_OP_WRAPS : 0,
+            .row = (uint16_t)screen->cursor_row,
+            .col = (uint16_t)screen->cursor_col,
+            .count = (uint32_t)chunk,
+            .style = screen->pen_style,
+            .text = data,
+        });
+
+        data += chunk;
+        len -= chunk;
+        screen->cursor_col += (int)chunk;
+        if (screen->cursor_col >= screen->cols) {
+            screen->cursor_col = 0;
+            screen_line_feed(screen);
+        }
+    }
+}
+
+// queue codepoints from the text pool wrapping once per filled line
+static void screen_print_codepoints(Screen *screen, const uint32_t *codepoints, size_t len) {
+    while (len > 0) {
+        size_t space = (size_t)(screen->cols - screen->cursor_col);
+        size_t chunk = len < space ? len : space;
+
+        screen_emit(screen, (ScreenOp){
+            .type = SCREEN_OP_PRINT_CODEPOINTS,
+            .flags = chunk == space ? SCREEN_OP_WRAPS : 0,
+            .row = (uint16_t)screen->cursor_row,
+            .col = (uint16_t)screen->cursor_col,
+            .count = (uint32_t)chunk,
+            .style = screen->pen_style,
+            .codepoints = codepoints,
+        });
+
+        codepoints += chunk;
+        len -= chunk;
+        screen->cursor_col += (int)chunk;
+        if (screen->cursor_col >= screen->cols) {
+            screen->cursor_col = 0;
+            screen_line_feed(screen);
+        }
+    }
+}
+
+size_t screen_print_utf8(Screen *screen, Utf8Decoder *decoder, const uint8_t *data, size_t len) {
+    // queued prints may still reference the pool until the queue drains
+    if (screen->ops.count == 0)
+        screen->text_used = 0;
+    if (screen->text_used == screen->text_capacity) {
+        screen_flush(screen);
+        screen->text_used = 0;
+    }
+
+    uint32_t *out = screen->text + screen->text_used;
+    size_t produced;
+    size_t consumed = utf8_decode_text(decoder, data, len, out, screen->text_capacity - screen->text_used, &produced);
+    screen->text_used += produced;
+    screen_print_codepoints(screen, out, produced);
+    return consumed;
+}
+
+void screen_execute(Screen *screen, uint8_t byte) {
+    switch (byte) {
+    case '\r':
+        // return carriage to column zero
+        screen_move_to(screen, screen->cursor_row, 0);
+        break;
+    case '\n':
+    case '\v':
+    case '\f':
+        screen->cursor_col = 0;
+        screen_line_feed(screen);
+        break;
+    case '\b':
+        if (screen->cursor_col > 0)
+            screen_move_to(screen, screen->cursor_row, screen->cursor_col - 1);
+        break;
+    case 0x7F:
+        // delete erases the cell left of the cursor
+        if (screen->cursor_col > 0) {
+            screen->cursor_col--;
+            screen_emit(screen, (ScreenOp){
+                .type = SCREEN_OP_ERASE,
+                .row = (uint16_t)screen->cursor_row,
+                .col = (uint16_t)screen->cursor_col,
+                .end = (uint16_t)(screen->cursor_col + 1),
+                .style = screen->erase_style,
+            });
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void screen_line_feed(Screen *screen) {
+    screen->cursor_row++;
+    if (screen->cursor_row > screen->scroll_bottom) {
+        // scroll region upward when leaving bottom
+        screen_scroll_up(screen, 1);
+        screen->cursor_row = screen->scroll_bottom;
+    }
+}
+
+void screen_index(Screen *screen) {
+    // index moves down and scrolls only at the bottom margin
+    if (screen->cursor_row >= screen->scroll_top && screen->cursor_row <= screen->scroll_bottom) {
+        if (screen->cursor_row == screen->scroll_bottom) {
+            screen_scroll_up(screen, 1);
+        } else {
+            screen->cursor_row++;
+        }
+    } else if (screen->cursor_row < screen->rows - 1) {
+        screen->cursor_row++;
+    }
+}
+
+void screen_reverse_index(Screen *screen) {
+    // reverse index moves up and scrolls only at the top margin
+    if (screen->cursor_row >= screen->scroll_top && screen->cursor_row <= screen->scroll_bottom) {
+        if (screen->cursor_row == screen->scroll_top) {
+            screen_scroll_down(screen, 1);
+        } else {
+            screen->cursor_row--;
+        }
+    } else if (screen->cursor_row > 0) {
+        screen->cursor_row--;
+    }
+}
+
+void screen_move_to(Screen *screen, int row, int col) {
+    row = row < 0 ? 0 : (row >= screen->rows ? screen->rows - 1 : row);
+    col = col < 0 ? 0 : (col >= screen->cols ? screen->cols - 1 : col);
+    screen->cursor_row = row;
+    screen->cursor_col = col;
+    screen_emit(screen, (ScreenOp){ .type = SCREEN_OP_MOVE, .row = (uint16_t)row, .col = (uint16_t)col });
+}
+
+static void screen_erase_span(Screen *screen, int row, int start_col, int end_col) {
+    if (start_col >= end_col)
+        return;
+    screen_emit(screen, (ScreenOp){
+        .type = SCREEN_OP_ERASE,
+        .row = (uint16_t)row,
+        .col = (uint16_t)start_col,
+        .end = (uint16_t)end_col,
+        .style = screen->erase_style,
+    });
+}
+
+static void screen_erase_rows(Screen *screen, int start_row, int end_row) {
+    if (start_row >= end_row)
+        return;
+    screen_emit(screen, (ScreenOp){
+        .type = SCREEN_OP_ERASE_ROWS,
+        .row = (uint16_t)start_row,
+        .end = (uint16_t)end_row,
+        .style = screen->erase_style,
+    });
+}
+
+void screen_erase_display(Screen *screen, int mode) {
+    int row = screen->cursor_row;
+    if (mode == 0) {
+        // cursor to end of display
+        screen_erase_span(screen, row, screen->cursor_col, screen->cols);
+        screen_erase_rows(screen, row + 1, screen->rows);
+    } else if (mode == 1) {
+        // start of display through cursor
+        screen_erase_rows(screen, 0, row);
+        screen_erase_span(screen, row, 0, screen->cursor_col + 1);
+    } else if (mode == 2) {
+        screen_erase_rows(screen, 0, screen->rows);
+    } else if (mode == 3 && screen->history) {
+        // queued scrolls still push rows so they land before the clear
+        screen_apply_queued(screen);
+        scrollback_clear(screen->history);
+    }
+}
+
+void screen_erase_line(Screen *screen, int mode) {
+    int row = screen->cursor_row;
+    if (mode == 0)
+        screen_erase_span(screen, row, screen->cursor_col, screen->cols);
+    else if (mode == 1)
+        screen_erase_span(screen, row, 0, screen->cursor_col + 1);
+    else
+        screen_erase_span(screen, row, 0, screen->cols);
+}
+
+static void screen_scroll_rows(Screen *screen, uint8_t type, int top, int bottom, int count, uint8_t flags) {
+    if (count <= 0 || top > bottom)
+        return;
+    int limit = bottom - top + 1;
+    screen_emit(screen, (ScreenOp){
+        .type = type,
+        .flags = flags,
+        .row = (uint16_t)top,
+        .end = (uint16_t)bottom,
+        .count = (uint32_t)(count > limit ? limit : count),
+        .style = screen->erase_style,
+    });
+}
+
+void screen_insert_lines(Screen *screen, int count) {
+    if (screen->cursor_row < screen->scroll_top || screen->cursor_row > screen->scroll_bottom)
+        return;
+    // inserting lines scrolls the rest of the region down
+    screen_scroll_rows(screen, SCREEN_OP_SCROLL_DOWN, screen->cursor_row, screen->scroll_bottom, count, 0);
+}
+
+void screen_delete_lines(Screen *screen, int count) {
+    if (screen->cursor_row < screen->scroll_top || screen->cursor_row > screen->scroll_bottom)
+        return;
+    // deleting lines scrolls the rest of the region up
+    screen_scroll_rows(screen, SCREEN_OP_SCROLL_UP, screen->cursor_row, screen->scroll_bottom, count, 0);
+}
+
+void screen_scroll_up(Screen *screen, int count) {
+    // only a region starting at the top row pushes lines off the screen
+    uint8_t flags = screen->history && screen->scroll_top == 0 ? SCREEN_OP_KEEPS : 0;
+    screen_scroll_rows(screen, SCREEN_OP_SCROLL_UP, screen->scroll_top, screen->scroll_bottom, count, flags);
+}
+
+void screen_scroll_down(Screen *screen, int count) {
+    screen_scroll_rows(screen, SCREEN_OP_SCROLL_DOWN, screen->scroll_top, screen->scroll_bottom, count, 0);
+}
+
+void screen_set_pen(Screen *screen, const Style *pen) {
+    if (style_equal(pen, &screen->pen))
+        return;
+
+    // erases use only the pen background as in xterm
+    Style erase = { .fg = STYLE_COLOR(STYLE_COLOR_DEFAULT, 0), .bg = pen->bg, .attrs = 0 };
+    uint32_t pen_style = style_table_intern(&screen->styles, pen);
+    uint32_t erase_style = style_table_intern(&screen->styles, &erase);
+
+    // the screen holds one reference to each so they outlive queued ops
+    style_table_acquire(&screen->styles, pen_style, 1);
+    style_table_acquire(&screen->styles, erase_style, 1);
+    style_table_release(&screen->styles, screen->pen_style, 1);
+    style_table_release(&screen->styles, screen->erase_style, 1);
+    screen->pen = *pen;
+    screen->pen_style = pen_style;
+    screen->erase_style = erase_style;
+}
+
+void screen_set_region(Screen *screen, int top, int bottom) {
+    // invalid or empty margins reset to the full screen
+    if (top < 0)
+        top = 0;
+    if (top >= screen->rows)
+        top = screen->rows - 1;
+    if (bottom >= screen->rows)
+        bottom = screen->rows - 1;
+    if (top >= bottom) {
+        top = 0;
+        bottom = screen->rows - 1;
+    }
+    screen->scroll_top = top;
+    screen->scroll_bottom = bottom;
+    screen_emit(screen, (ScreenOp){ .type = SCREEN_OP_SET_REGION, .row = (uint16_t)top, .end = (uint16_t)bottom });
+
+    int row = screen->cursor_row;
+    if (row < top)
+        row = top;
+    if (row > bottom)
+        row = bottom;
+    screen_move_to(screen, row, 0);
+}
+
+static void screen_emit(Screen *screen, ScreenOp op) {
+    // fall back to applying in order when the queue cannot grow
+    if (screen_ops_push(&screen->ops, op) != 0) {
+        screen_apply_queued(screen);
+        screen_apply(screen, &op);
+    }
+}
+
+// add the style references of cells copied into the grid
+static void screen_acquire_cells(Screen *screen, const Cell *cells, size_t count) {
+    for (size_t i = 0; i < count;) {
+        uint32_t style = cells[i].style;
+        size_t run = cell_style_run(cells + i, count - i, style);
+        style_table_acquire(&screen->styles, style, (uint32_t)run);
+        i += run;
+    }
+}
+
+// drop the style references held by cells about to be overwritten
+// one release per run of a style, so a default row costs a single scan
+static void screen_release_cells(Screen *screen, const Cell *cells, size_t count) {
+    for (size_t i = 0; i < count;) {
+        uint32_t style = cells[i].style;
+        size_t run = cell_style_run(cells + i, count - i, style);
+        style_table_release(&screen->styles, style, (uint32_t)run);
+        i += run;
+    }
+}
+
+// move the references of cells about to take a new style
+static void screen_restyle_cells(Screen *screen, const Cell *cells, size_t count, uint32_t style) {
+    uint32_t restyled = 0;
+    for (size_t i = 0; i < count;) {
+        uint32_t old = cells[i].style;
+        size_t run = cell_style_run(cells + i, count - i, old);
+        if (old != style) {
+            style_table_release(&screen->styles, old, (uint32_t)run);
+            restyled += (uint32_t)run;
+        }
+        i += run;
+    }
+    style_table_acquire(&screen->styles, style, restyled);
+}
+
+// blank cells with a style counting all of them in one step
+static void screen_fill(Screen *screen, Cell *cells, size_t count, uint32_t style) {
+    screen_release_cells(screen, cells, count);
+    cell_fill(cells, count, (Cell){ ' ', style });
+    style_table_acquire(&screen->styles, style, (uint32_t)count);
+}
+
+// map a logical row to its slot in the line ring
+static inline int screen_slot(const Screen *screen, int row) {
+    int slot = screen->line_base + row;
+    return slot >= screen->rows ? slot - screen->rows : slot;
+}
+
+// blank count logical rows starting at first with one fill and row copies
+// rows already blank in the style are skipped and need no per cell work
+static void screen_blank_rows(Screen *screen, int first, int count, uint32_t style) {
+    size_t cols = (size_t)screen->cols;
+    const Cell *seed = NULL;
+    size_t blanked = 0;
+
+    for (int r = first; r < first + count; r++) {
+        Line *line = screen_line(screen, r);
+        line->wrapped = false;
+        if (line->blank == style)
+            continue;
+
+        // a uniform row drops all its references at once
+        if (line->blank == SCREEN_LINE_MIXED)
+            screen_release_cells(screen, line->cells, cols);
+        else
+            style_table_release(&screen->styles, line->blank, (uint32_t)cols);
+
+        if (seed) {
+            cell_copy(line->cells, seed, cols);
+        } else {
+            cell_fill(line->cells, cols, (Cell){ ' ', style });
+            seed = line->cells;
+        }
+        line->blank = style;
+        blanked += cols;
+    }
+    style_table_acquire(&screen->styles, style, (uint32_t)blanked);
+}
+
+// reverse logical rows [first, last) through their ring slots
+static void screen_reverse_rows(Screen *screen, int first, int last) {
+    Line *lines = screen->lines;
+    for (last--; first < last; first++, last--) {
+        int a = screen_slot(screen, first);
+        int b = screen_slot(screen, last);
+        Line saved = lines[a];
+        lines[a] = lines[b];
+        lines[b] = saved;
+    }
+}
+
+// rotate logical rows [top, bottom] so that row top + n lands on top
+// three reversals move every row once without a buffer as large as the region
+static void screen_rotate_rows(Screen *screen, int top, int bottom, int n) {
+    screen_reverse_rows(screen, top, top + n);
+    screen_reverse_rows(screen, top + n, bottom + 1);
+    screen_reverse_rows(screen, top, bottom + 1);
+}
+
+static void screen_apply_scroll(Screen *screen, const ScreenOp *op) {
+    int top = op->row;
+    int bottom = op->end;
+    int height = bottom - top + 1;
+    int n = (int)op->count;
+    bool up = op->type == SCREEN_OP_SCROLL_UP;
+
+    screen_damage_scroll(&screen->damage, top, bottom, up ? n : -n);
+    if (op->flags & SCREEN_OP_KEEPS) {
+        for (int r = 0; r < n && r < height; r++)
+            screen_keep_line(screen, screen_line(screen, top + r));
+    }
+    if (n >= height) {
+        screen_blank_rows(screen, top, height, op->style);
+        // merged scrolls count blank lines that entered and left within the batch
+        // they go as the blanked top row so history keeps their erase style however the input was split
+        if (op->flags & SCREEN_OP_KEEPS) {
+            for (int r = height; r < n; r++)
+                screen_keep_line(screen, screen_line(screen, top));
+        }
+        return;
+    }
+
+    if (top == 0 && bottom == screen->rows - 1) {
+        // full screen scrolls only move the ring base
+        screen->line_base = (screen->line_base + (up ? n : screen->rows - n)) % screen->rows;
+    } else {
+        // margin scrolls shuffle row pointers inside the region
+        screen_rotate_rows(screen, top, bottom, up ? n : height - n);
+    }
+
+    // recycled rows enter blank at the exposed edge
+    screen_blank_rows(screen, up ? bottom - n + 1 : top, n, op->style);
+}
+
+// write printed cells from the first one that changes
+// repaints of unchanged text leave the row and its damage untouched
+static void screen_apply_print(Screen *screen, const ScreenOp *op) {
+    Line *line = screen_line(screen, op->row);
+    Cell staged[SCREEN_PRINT_STAGE];
+    int first = -1;
+    int end = 0;
+    if (op->flags & SCREEN_OP_WRAPS)
+        line->wrapped = true;
+
+    for (uint32_t done = 0; done < op->count;) {
+        size_t count = op->count - done < SCREEN_PRINT_STAGE ? op->count - done : SCREEN_PRINT_STAGE;
+        if (op->type == SCREEN_OP_PRINT)
+            cell_store_bytes(staged, op->text + done, count, op->style);
+        else
+            cell_store_codepoints(staged, op->codepoints + done, count, op->style);
+
+        Cell *dst = line->cells + op->col + done;
+        size_t start = cell_diff(dst, staged, count);
+        if (start < count) {
+            // only cells changing style touch the reference counts
+            screen_restyle_cells(screen, dst + start, count - start, op->style);
+            cell_copy(dst + start, staged + start, count - start);
+            if (first < 0)
+                first = op->col + (int)(done + start);
+            end = op->col + (int)(done + count);
+        }
+        done += (uint32_t)count;
+    }
+
+    if (first >= 0) {
+        line->blank = SCREEN_LINE_MIXED;
+        screen_damage_mark(&screen->damage, op->row, first, end);
+    }
+}
+
+static void screen_apply(Screen *screen, const ScreenOp *op) {
+    switch (op->type) {
+    case SCREEN_OP_PRINT:
+    case SCREEN_OP_PRINT_CODEPOINTS:
+        screen_apply_print(screen, op);
+        break;
+    case SCREEN_OP_ERASE:
+        {
+            Line *line = screen_line(screen, op->row);
+            // a line cleared to its end no longer continues on the next row
+            if (op->end == screen->cols)
+                line->wrapped = false;
+            if (line->blank == op->style)
+                break;
+            if (op->col == 0 && op->end == screen->cols) {
+                screen_blank_rows(screen, op->row, 1, op->style);
+            } else {
+                screen_fill(screen, line->cells + op->col, (size_t)(op->end - op->col), op->style);
+                line->blank = SCREEN_LINE_MIXED;
+            }
+            screen_damage_mark(&screen->damage, op->row, op->col, op->end);
+        }
+        break;
+    case SCREEN_OP_ERASE_ROWS:
+        screen_blank_rows(screen, op->row, op->end - op->row, op->style);
+        screen_damage_mark_rows(&screen->damage, op->row, op->end - op->row);
+        break;
+    case SCREEN_OP_SCROLL_UP:
+    case SCREEN_OP_SCROLL_DOWN:
+        screen_apply_scroll(screen, op);
+        break;
+    default:
+        // cursor and margins were already updated when the op was queued
+        break;
+    }
+}
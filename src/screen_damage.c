@@ -0,0 +1,227 @@
+#include <screen_damage.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static size_t damage_words(int rows) {
+    return ((size_t)rows + 63) / 64;
+}
+
+int screen_damage_init(ScreenDamage *damage, int cols, int rows) {
+    if (!damage || cols < 1 || rows < 1 || cols > UINT16_MAX)
+        return -1;
+
+    damage->row_bits = calloc(damage_words(rows), sizeof(uint64_t));
+    damage->span_start = malloc((size_t)rows * sizeof(uint16_t));
+    damage->span_end = malloc((size_t)rows * sizeof(uint16_t));
+    if (!damage->row_bits || !damage->span_start || !damage->span_end) {
+        screen_damage_free(damage);
+        return -1;
+    }
+
+    damage->cols = cols;
+    damage->rows = rows;
+    damage->capacity = rows;
+    damage->scroll_top = 0;
+    damage->scroll_bottom = rows - 1;
+    damage->scroll_lines = 0;
+    damage->cursor_row = 0;
+    damage->cursor_col = 0;
+
+    // a fresh grid has never been drawn
+    damage->all = true;
+    return 0;
+}
+
+int screen_damage_resize(ScreenDamage *damage, int cols, int rows, int capacity) {
+    if (!damage || cols < 1 || rows < 1 || cols > UINT16_MAX)
+        return -1;
+    if (capacity < rows)
+        capacity = rows;
+
+    // storage only grows so shrinking and growing back reuse it
+    if (capacity > damage->capacity) {
+        uint64_t *row_bits = calloc(damage_words(capacity), sizeof(uint64_t));
+        uint16_t *span_start = malloc((size_t)capacity * sizeof(uint16_t));
+        uint16_t *span_end = malloc((size_t)capacity * sizeof(uint16_t));
+        if (!row_bits || !span_start || !span_end) {
+            free(row_bits);
+            free(span_start);
+            free(span_end);
+            return -1;
+        }
+        screen_damage_free(damage);
+        damage->row_bits = row_bits;
+        damage->span_start = span_start;
+        damage->span_end = span_end;
+        damage->capacity = capacity;
+    }
+
+    memset(damage->row_bits, 0, damage_words(rows) * sizeof(uint64_t));
+    damage->cols = cols;
+    damage->rows = rows;
+    damage->scroll_top = 0;
+    damage->scroll_bottom = rows - 1;
+    damage->scroll_lines = 0;
+    damage->cursor_row = 0;
+    damage->cursor_col = 0;
+
+    // a resized grid is redrawn from scratch
+    damage->all = true;
+    return 0;
+}
+
+void screen_damage_free(ScreenDamage *damage) {
+    if (!damage)
+        return;
+    free(damage->row_bits);
+    free(damage->span_start);
+    free(damage->span_end);
+    damage->row_bits = NULL;
+    damage->span_start = NULL;
+    damage->span_end = NULL;
+}
+
+void screen_damage_mark(ScreenDamage *damage, int row, int start, int end) {
+    if (damage->all || row < 0 || row >= damage->rows)
+        return;
+    if (start < 0)
+        start = 0;
+    if (end > damage->cols)
+        end = damage->cols;
+    if (start >= end)
+        return;
+
+    uint64_t bit = (uint64_t)1 << (row & 63);
+    uint64_t *word = &damage->row_bits[row >> 6];
+    if (!(*word & bit)) {
+        // first damage of the row sets its span
+        *word |= bit;
+        damage->span_start[row] = (uint16_t)start;
+        damage->span_end[row] = (uint16_t)end;
+        return;
+    }
+
+    // widen the existing span to cover the new columns
+    if (start < damage->span_start[row])
+        damage->span_start[row] = (uint16_t)start;
+    if (end > damage->span_end[row])
+        damage->span_end[row] = (uint16_t)end;
+}
+
+void screen_damage_mark_rows(ScreenDamage *damage, int first, int count) {
+    for (int r = first; r < first + count; r++)
+        screen_damage_mark(damage, r, 0, damage->cols);
+}
+
+void screen_damage_mark_all(ScreenDamage *damage) {
+    damage->all = true;
+    damage->scroll_lines = 0;
+}
+
+// move the damage state of row src onto row dst
+static void damage_move_row(ScreenDamage *damage, int dst, int src) {
+    uint64_t dst_bit = (uint64_t)1 << (dst & 63);
+    if (damage->row_bits[src >> 6] >> (src & 63) & 1u) {
+        damage->row_bits[dst >> 6] |= dst_bit;
+        damage->span_start[dst] = damage->span_start[src];
+        damage->span_end[dst] = damage->span_end[src];
+    } else {
+        damage->row_bits[dst >> 6] &= ~dst_bit;
+    }
+}
+
+void screen_damage_scroll(ScreenDamage *damage, int top, int bottom, int lines) {
+    if (damage->all || lines == 0 || top < 0 || bottom >= damage->rows || top > bottom)
+        return;
+
+    int height = bottom - top + 1;
+    int n = lines > 0 ? lines : -lines;
+    if (n >= height) {
+        // nothing survives so there is nothing to shift
+        screen_damage_mark_rows(damage, top, height);
+        return;
+    }
+
+    // a hint describes a single region so switching regions repaints both
+    if (damage->scroll_lines != 0 && (damage->scroll_top != top || damage->scroll_bottom != bottom)) {
+        screen_damage_mark_rows(damage, damage->scroll_top, damage->scroll_bottom - damage->scroll_top + 1);
+        screen_damage_mark_rows(damage, top, height);
+        damage->scroll_lines = 0;
+        return;
+    }
+
+    // the drawn cursor moves with the content so repaint where it lands
+    if (damage->cursor_row >= top && damage->cursor_row <= bottom)
+        screen_damage_mark(damage, damage->cursor_row, damage->cursor_col, damage->cursor_col + 1);
+
+    // existing damage travels with its rows and exposed rows become dirty
+    if (lines > 0) {
+        for (int r = top; r + n <= bottom; r++)
+            damage_move_row(damage, r, r + n);
+        for (int r = bottom - n + 1; r <= bottom; r++)
+            damage->row_bits[r >> 6] &= ~((uint64_t)1 << (r & 63));
+        screen_damage_mark_rows(damage, bottom - n + 1, n);
+    } else {
+        for (int r = bottom; r - n >= top; r--)
+            damage_move_row(damage, r, r - n);
+        for (int r = top; r < top + n; r++)
+            damage->row_bits[r >> 6] &= ~((uint64_t)1 << (r & 63));
+        screen_damage_mark_rows(damage, top, n);
+    }
+
+    damage->scroll_top = top;
+    damage->scroll_bottom = bottom;
+    damage->scroll_lines += lines;
+    if (damage->scroll_lines <= -height || damage->scroll_lines >= height) {
+        // the accumulated shift moved everything out of view
+        screen_damage_mark_rows(damage, top, height);
+        damage->scroll_lines = 0;
+    }
+}
+
+void screen_damage_cursor(ScreenDamage *damage, int row, int col) {
+    if (row == damage->cursor_row && col == damage->cursor_col)
+        return;
+
+    // repaint both the cell the cursor left and the one it entered
+    screen_damage_mark(damage, damage->cursor_row, damage->cursor_col, damage->cursor_col + 1);
+    screen_damage_mark(damage, row, col, col + 1);
+    damage->cursor_row = row;
+    damage->cursor_col = col;
+}
+
+void screen_damage_clear(ScreenDamage *damage) {
+    memset(damage->row_bits, 0, damage_words(damage->rows) * sizeof(uint64_t));
+    damage->scroll_lines = 0;
+    damage->all = false;
+}
+
+bool screen_damage_any(const ScreenDamage *damage) {
+    if (damage->all || damage->scroll_lines != 0)
+        return true;
+    return screen_damage_next_row(damage, 0) >= 0;
+}
+
+int screen_damage_next_row(const ScreenDamage *damage, int row) {
+    if (row < 0)
+        row = 0;
+    if (row >= damage->rows)
+        return -1;
+    if (damage->all)
+        return row;
+
+    // skip clean rows a word at a time
+    size_t words = damage_words(damage->rows);
+    size_t index = (size_t)row >> 6;
+    uint64_t word = damage->row_bits[index] & (~(uint64_t)0 << (row & 63));
+    for (;;) {
+        if (word) {
+            int found = (int)(index * 64) + __builtin_ctzll(word);
+            return found < damage->rows ? found : -1;
+        }
+        if (++index >= words)
+            return -1;
+        word = damage->row_bits[index];
+    }
+}
@@ -0,0 +1,261 @@
+#include <screen_ops.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <utf8.h>
+
+// marker for operations removed by the coalescing passes
+#define SCREEN_OP_DROPPED 0xFF
+// how far back an erase looks for writes it overwrites
+#define SCREEN_OP_ERASE_WINDOW 64
+
+void screen_ops_free(ScreenOpList *list) {
+    if (!list)
+        return;
+    free(list->ops);
+    list->ops = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+int screen_ops_push(ScreenOpList *list, ScreenOp op) {
+    if (list->count == list->capacity) {
+        // grow geometrically so bursts of small ops stay cheap
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        ScreenOp *ops = realloc(list->ops, capacity * sizeof(ScreenOp));
+        if (!ops)
+            return -1;
+        list->ops = ops;
+        list->capacity = capacity;
+    }
+    list->ops[list->count++] = op;
+    return 0;
+}
+
+static bool is_scroll(const ScreenOp *op) {
+    return op->type == SCREEN_OP_SCROLL_UP || op->type == SCREEN_OP_SCROLL_DOWN;
+}
+
+static bool same_scroll(const ScreenOp *a, const ScreenOp *b) {
+    return a->type == b->type && a->row == b->row && a->end == b->end && a->style == b->style &&
+           a->flags == b->flags;
+}
+
+// report whether op can be reordered across a scroll of the given region
+static bool commutes_with_scroll(const ScreenOp *op, const ScreenOp *scroll) {
+    switch (op->type) {
+    case SCREEN_OP_PRINT:
+    case SCREEN_OP_PRINT_CODEPOINTS:
+    case SCREEN_OP_ERASE:
+    case SCREEN_OP_MOVE:
+    case SCREEN_OP_SET_REGION:
+    case SCREEN_OP_DROPPED:
+        return true;
+    case SCREEN_OP_ERASE_ROWS:
+        // row ranges must be fully inside or fully outside the region
+        return op->end <= scroll->row || op->row > scroll->end ||
+               (op->row >= scroll->row && op->end <= scroll->end + 1);
+    default:
+        return false;
+    }
+}
+
+// rewrite op as if it ran before the scrolls that followed it
+static void shift_across_scroll(ScreenOp *op, const ScreenOp *scroll, int lines) {
+    int top = scroll->row;
+    int bottom = scroll->end;
+    bool up = scroll->type == SCREEN_OP_SCROLL_UP;
+
+    switch (op->type) {
+    case SCREEN_OP_PRINT:
+    case SCREEN_OP_PRINT_CODEPOINTS:
+    case SCREEN_OP_ERASE:
+        {
+            if (op->row < top || op->row > bottom)
+                return;
+            int row = up ? op->row - lines : op->row + lines;
+            // writes pushed out of the region are never visible
+            if (row < top || row > bottom)
+                op->type = SCREEN_OP_DROPPED;
+            else
+                op->row = (uint16_t)row;
+        }
+        break;
+    case SCREEN_OP_ERASE_ROWS:
+        {
+            if (op->end <= top || op->row > bottom)
+                return;
+            int start = up ? op->row - lines : op->row + lines;
+            int end = up ? op->end - lines : op->end + lines;
+            if (start < top)
+                start = top;
+            if (end > bottom + 1)
+                end = bottom + 1;
+            if (start >= end)
+                op->type = SCREEN_OP_DROPPED;
+            else {
+                op->row = (uint16_t)start;
+                op->end = (uint16_t)end;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// merge runs of identical scrolls into one multi line scroll
+static void coalesce_scrolls(ScreenOpList *list) {
+    ScreenOp *ops = list->ops;
+    size_t i = 0;
+
+    while (i < list->count) {
+        if (!is_scroll(&ops[i])) {
+            i++;
+            continue;
+        }
+
+        // extend the group while every op commutes with this scroll
+        const ScreenOp anchor = ops[i];
+        size_t end = i + 1;
+        int scrolls = 0;
+        while (end < list->count) {
+            const ScreenOp *op = &ops[end];
+            if (is_scroll(op)) {
+                if (!same_scroll(op, &anchor))
+                    break;
+                scrolls++;
+            } else if (!commutes_with_scroll(op, &anchor)) {
+                break;
+            } else if ((anchor.flags & SCREEN_OP_KEEPS) && op->type != SCREEN_OP_MOVE &&
+                       op->type != SCREEN_OP_SET_REGION && op->type != SCREEN_OP_DROPPED) {
+                // writes to rows that move into history must land before they leave
+                break;
+            }
+            end++;
+        }
+        if (scrolls == 0) {
+            i = end;
+            continue;
+        }
+
+        // walk back so each op is shifted by the scrolls that follow it
+        int after = 0;
+        for (size_t k = end; k-- > i + 1;) {
+            if (is_scroll(&ops[k])) {
+                after += (int)ops[k].count;
+                ops[k].type = SCREEN_OP_DROPPED;
+            } else if (after > 0) {
+                shift_across_scroll(&ops[k], &anchor, after);
+            }
+        }
+
+        // rows kept in history count every blank line that passed through
+        int height = anchor.end - anchor.row + 1;
+        int total = (int)anchor.count + after;
+        ops[i].count = (uint32_t)(total > height && !(anchor.flags & SCREEN_OP_KEEPS) ? height : total);
+        i = end;
+    }
+}
+
+// drop prints that a later erase on the same row fully covers
+static void drop_overwritten_writes(ScreenOpList *list) {
+    ScreenOp *ops = list->ops;
+
+    for (size_t i = 0; i < list->count; i++) {
+        const ScreenOp *erase = &ops[i];
+        if (erase->type != SCREEN_OP_ERASE && erase->type != SCREEN_OP_ERASE_ROWS)
+            continue;
+
+        size_t stop = i > SCREEN_OP_ERASE_WINDOW ? i - SCREEN_OP_ERASE_WINDOW : 0;
+        for (size_t k = i; k-- > stop;) {
+            ScreenOp *op = &ops[k];
+            if (is_scroll(op))
+                break;
+            if (op->type != SCREEN_OP_PRINT && op->type != SCREEN_OP_PRINT_CODEPOINTS)
+                continue;
+
+            bool covered;
+            if (erase->type == SCREEN_OP_ERASE_ROWS)
+                covered = op->row >= erase->row && op->row < erase->end;
+            else
+                covered = op->row == erase->row && op->col >= erase->col && op->col + op->count <= erase->end;
+            if (covered)
+                op->type = SCREEN_OP_DROPPED;
+        }
+    }
+}
+
+void screen_ops_coalesce(ScreenOpList *list) {
+    if (!list || list->count == 0)
+        return;
+
+    coalesce_scrolls(list);
+    drop_overwritten_writes(list);
+
+    // only the last cursor move and margin change of a batch matter
+    bool seen_move = false;
+    bool seen_region = false;
+    for (size_t k = list->count; k-- > 0;) {
+        ScreenOp *op = &list->ops[k];
+        if (op->type == SCREEN_OP_MOVE) {
+            if (seen_move)
+                op->type = SCREEN_OP_DROPPED;
+            seen_move = true;
+        } else if (op->type == SCREEN_OP_SET_REGION) {
+            if (seen_region)
+                op->type = SCREEN_OP_DROPPED;
+            seen_region = true;
+        }
+    }
+
+    // compact surviving operations in order
+    size_t out = 0;
+    for (size_t k = 0; k < list->count; k++) {
+        if (list->ops[k].type != SCREEN_OP_DROPPED)
+            list->ops[out++] = list->ops[k];
+    }
+    list->count = out;
+}
+
+void screen_ops_trace(FILE *out, const ScreenOp *ops, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const ScreenOp *op = &ops[i];
+        switch (op->type) {
+        case SCREEN_OP_PRINT:
+            fprintf(out, "print %u,%u \"%.*s\"%s\n", op->row, op->col, (int)op->count, (const char *)op->text,
+                    op->flags & SCREEN_OP_WRAPS ? " wrap" : "");
+            break;
+        case SCREEN_OP_PRINT_CODEPOINTS:
+            fprintf(out, "print %u,%u \"", op->row, op->col);
+            for (uint32_t k = 0; k < op->count; k++) {
+                char bytes[4];
+                fwrite(bytes, 1, utf8_encode(op->codepoints[k], bytes), out);
+            }
+            fputs(op->flags & SCREEN_OP_WRAPS ? "\" wrap\n" : "\"\n", out);
+            break;
+        case SCREEN_OP_ERASE:
+            fprintf(out, "erase %u,%u-%u\n", op->row, op->col, op->end);
+            break;
+        case SCREEN_OP_ERASE_ROWS:
+            fprintf(out, "erase-rows %u-%u\n", op->row, op->end);
+            break;
+        case SCREEN_OP_SCROLL_UP:
+            fprintf(out, "scroll-up %u-%u %u%s\n", op->row, op->end, op->count,
+                    op->flags & SCREEN_OP_KEEPS ? " keep" : "");
+            break;
+        case SCREEN_OP_SCROLL_DOWN:
+            fprintf(out, "scroll-down %u-%u %u\n", op->row, op->end, op->count);
+            break;
+        case SCREEN_OP_MOVE:
+            fprintf(out, "move %u,%u\n", op->row, op->col);
+            break;
+        case SCREEN_OP_SET_REGION:
+            fprintf(out, "region %u-%u\n", op->row, op->end);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,731 @@
+#include <scrollback.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cell_kernel.h>
+
+// longest row a page takes, wider rows are cut
+#define SCROLLBACK_ROW_CELLS (SCROLLBACK_PAGE_CELLS - 1)
+// fewest pages the cold tier leaves uncompressed, the newest one is still filling
+#define SCROLLBACK_MIN_HOT_PAGES 2
+// pages kept for reuse, the rest go back once deflated
+#define SCROLLBACK_POOL_PAGES 4
+
+static ScrollbackBlock *scrollback_block(const Scrollback *history, size_t index) {
+    return &history->blocks[(history->block_head + index) % history->block_capacity];
+}
+
+// return the block holding history row number, the oldest one for rows already evicted
+static size_t scrollback_find(const Scrollback *history, uint64_t number) {
+    // blocks are numbered in order so the newest is checked first and the rest bisected
+    size_t low = 0;
+    size_t high = history->block_count - 1;
+    if (scrollback_block(history, high)->first <= number)
+        return high;
+    while (low < high) {
+        size_t mid = (low + high + 1) / 2;
+        if (scrollback_block(history, mid)->first <= number)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+// add or drop one reference per cell a style run at a time
+static void scrollback_count_styles(Scrollback *history, const Cell *cells, size_t length, bool acquire) {
+    size_t col = 0;
+    while (col < length) {
+        uint32_t style = cells[col].style;
+        size_t run = cell_style_run(cells + col, length - col, style);
+        if (acquire)
+            style_table_acquire(history->styles, style, (uint32_t)run);
+        else
+            style_table_release(history->styles, style, (uint32_t)run);
+        col += run;
+    }
+}
+
+// drop the references of rows [from, page->count) of a page
+static void scrollback_release_rows(Scrollback *history, const ScrollbackPage *page, size_t from) {
+    for (size_t row = from; row < page->count; row++) {
+        const ScrollbackSlot *slot = scrollback_slot(page, row);
+        scrollback_count_styles(history, page->data + slot->start, slot->length, false);
+    }
+}
+
+static void scrollback_pool_page(Scrollback *history, ScrollbackPage *page) {
+    if (history->free_count >= SCROLLBACK_POOL_PAGES) {
+        free(page);
+        return;
+    }
+    page->next = history->free_pages;
+    history->free_pages = page;
+    history->free_count++;
+}
+
+static ScrollbackPage *scrollback_take_page(Scrollback *history) {
+    ScrollbackPage *page = history->free_pages;
+    if (page) {
+        history->free_pages = page->next;
+        history->free_count--;
+    } else {
+        page = malloc(SCROLLBACK_PAGE_SIZE);
+    }
+    return page;
+}
+
+// return bytes the byte cap is checked against
+static size_t scrollback_memory_used(const Scrollback *history) {
+    size_t pages = history->page_count + history->free_count;
+    for (size_t i = 0; i < SCROLLBACK_CACHE_PAGES; i++)
+        pages += history->cache[i].page != NULL;
+    return pages * SCROLLBACK_PAGE_SIZE + history->cold_bytes;
+}
+
+// forget what width aware reads measured of a block once its lines change
+static void scrollback_unfold(Scrollback *history, ScrollbackBlock *block) {
+    block->fold_width = 0;
+    if (block->spans) {
+        history->span_bytes -= block->span_count * sizeof(uint32_t);
+        free(block->spans);
+        block->spans = NULL;
+    }
+}
+
+// release everything a block holds, rows before from were already released
+static void scrollback_drop_block(Scrollback *history, ScrollbackBlock *block, size_t from) {
+    if (block->job) {
+        scrollback_worker_cancel(&history->worker, block->job);
+        free(block->job->data);
+        free(block->job);
+        block->job = NULL;
+    }
+
+    if (block->settled) {
+        for (size_t i = 0; i < block->style_count; i++)
+            style_table_release(history->styles, block->styles[i].style, block->styles[i].count);
+        free(block->styles);
+    } else if (block->page) {
+        scrollback_release_rows(history, block->page, from);
+    }
+
+    if (block->page) {
+        scrollback_pool_page(history, block->page);
+        history->page_count--;
+    }
+    if (block->data) {
+        free(block->data);
+        history->cold_bytes -= block->size;
+    }
+    if (block->spill >= 0)
+        scrollback_spill_release(&history->spill, (size_t)block->spill + block->size);
+
+    for (size_t i = 0; i < SCROLLBACK_CACHE_PAGES; i++) {
+        if (history->cache[i].first == block->first)
+            history->cache[i].first = UINT64_MAX;
+    }
+    scrollback_unfold(history, block);
+}
+
+// take the oldest block out of the ring along with what is left of its rows
+static void scrollback_pop_head(Scrollback *history) {
+    ScrollbackBlock *block = scrollback_block(history, 0);
+    size_t remaining = block->count - history->head_row;
+    scrollback_drop_block(history, block, history->head_row);
+    history->lines -= remaining;
+    history->dropped += remaining;
+    history->head_row = 0;
+
+    // the oldest block belongs to the first tier that has any
+    size_t in_memory = history->block_count - history->spilled - history->compressing - history->hot;
+    if (history->spilled > 0)
+        history->spilled--;
+    else if (in_memory == 0 && history->compressing > 0)
+        history->compressing--;
+    else if (in_memory == 0)
+        history->hot--;
+    history->block_head = (history->block_head + 1) % history->block_capacity;
+    history->block_count--;
+    // the new oldest block starts at its first row whatever line that row belongs to
+    if (history->block_count > 0)
+        scrollback_unfold(history, scrollback_block(history, 0));
+}
+
+// drop the oldest row and its block once the block is empty
+static void scrollback_evict_row(Scrollback *history) {
+    ScrollbackBlock *block = scrollback_block(history, 0);
+    if (!block->settled) {
+        const ScrollbackSlot *slot = scrollback_slot(block->page, history->head_row);
+        scrollback_count_styles(history, block->page->data + slot->start, slot->length, false);
+    }
+    history->head_row++;
+    history->lines--;
+    history->dropped++;
+    if (history->head_row == block->count)
+        scrollback_pop_head(history);
+    else
+        scrollback_unfold(history, block);
+}
+
+// hand the references of rows [from, count) over to a per style summary
+// so they can be returned without inflating the block again
+static int scrollback_settle(Scrollback *history, ScrollbackBlock *block, size_t from) {
+    const ScrollbackPage *page = block->page;
+    uint32_t *tally = history->tally;
+    size_t styles = 0;
+    for (size_t row = from; row < page->count; row++) {
+        const ScrollbackSlot *slot = scrollback_slot(page, row);
+        const Cell *cells = page->data + slot->start;
+        for (size_t col = 0; col < slot->length;) {
+            uint32_t style = cells[col].style;
+            size_t run = cell_style_run(cells + col, slot->length - col, style);
+            if (style != STYLE_DEFAULT_ID && tally[style]++ == 0)
+                styles++;
+            tally[style] += (uint32_t)run - 1;
+            col += run;
+        }
+    }
+
+    // the tally is cleared while the summary is written
+    ScrollbackStyleCount *counts = styles ? malloc(styles * sizeof(*counts)) : NULL;
+    size_t count = 0;
+    for (size_t row = from; row < page->count && count < styles; row++) {
+        const ScrollbackSlot *slot = scrollback_slot(page, row);
+        const Cell *cells = page->data + slot->start;
+        for (size_t col = 0; col < slot->length; col++) {
+            uint32_t style = cells[col].style;
+            if (style == STYLE_DEFAULT_ID || tally[style] == 0)
+                continue;
+            if (counts)
+                counts[count] = (ScrollbackStyleCount){ style, tally[style] };
+            count++;
+            tally[style] = 0;
+        }
+    }
+    if (styles && !counts)
+        return -1;
+
+    block->styles = counts;
+    block->style_count = styles;
+    block->settled = true;
+    return 0;
+}
+
+// attach what the thread has deflated, jobs finish in the order they were submitted
+static void scrollback_attach(Scrollback *history) {
+    while (history->compressing > 0) {
+        ScrollbackBlock *block = scrollback_block(history, history->block_count - history->hot - history->compressing);
+        if (!scrollback_worker_done(&history->worker, block->job))
+            break;
+        ScrollbackJob *job = block->job;
+        block->job = NULL;
+        // a page that failed to compress stays as it is
+        if (job->data) {
+            block->data = job->data;
+            block->size = job->size;
+            history->cold_bytes += job->size;
+            scrollback_pool_page(history, block->page);
+            history->page_count--;
+            block->page = NULL;
+        }
+        free(job);
+        history->compressing--;
+    }
+}
+
+// attach finished jobs when the thread has finished any since the last look
+static void scrollback_collect(Scrollback *history) {
+    size_t finished = atomic_load_explicit(&history->worker.finished, memory_order_acquire);
+    if (finished == history->finished_seen)
+        return;
+    history->finished_seen = finished;
+    scrollback_attach(history);
+}
+
+// move the oldest block held in memory to the spill file
+static int scrollback_spill_block(Scrollback *history) {
+    // spilled offsets follow the live bytes when they move to the front
+    size_t moved = scrollback_spill_compact(&history->spill);
+    for (size_t i = 0; moved > 0 && i < history->spilled; i++) {
+        ScrollbackBlock *block = scrollback_block(history, i);
+        if (block->spill >= 0)
+            block->spill -= (int64_t)moved;
+    }
+
+    ScrollbackBlock *block = scrollback_block(history, history->spilled);
+    if (block->data) {
+        int64_t offset = scrollback_spill_write(&history->spill, block->data, block->size);
+        if (offset < 0)
+            return -1;
+        block->spill = offset;
+        free(block->data);
+        block->data = NULL;
+        history->cold_bytes -= block->size;
+    }
+    history->spilled++;
+    return 0;
+}
+
+// queue pages past the hot ones for compression and keep memory under the byte cap
+static void scrollback_cool(Scrollback *history) {
+    scrollback_collect(history);
+
+    while (history->hot > history->hot_pages) {
+        size_t index = history->block_count - history->hot;
+        ScrollbackBlock *block = scrollback_block(history, index);
+        ScrollbackJob *job = malloc(sizeof(*job));
+        if (!job || scrollback_settle(history, block, index == 0 ? history->head_row : 0) != 0) {
+            free(job);
+            break;
+        }
+        job->page = block->page;
+        block->job = job;
+        scrollback_worker_submit(&history->worker, job);
+        history->hot--;
+        history->compressing++;
+    }
+
+    // pooled and cached pages go first, then pages waiting on the thread are deflated
+    // then deflated blocks move to the spill file and the oldest rows are dropped only when nothing else is left
+    while (scrollback_memory_used(history) > history->max_bytes && history->block_count > 1) {
+        size_t in_memory = history->block_count - history->spilled - history->compressing - history->hot;
+        ScrollbackCache *cached = NULL;
+        for (size_t i = 0; i < SCROLLBACK_CACHE_PAGES && !cached; i++)
+            cached = history->cache[i].page ? &history->cache[i] : NULL;
+        if (history->free_pages) {
+            ScrollbackPage *page = history->free_pages;
+            history->free_pages = page->next;
+            history->free_count--;
+            free(page);
+        } else if (cached) {
+            // rows read out of the cache are only valid until the next push
+            free(cached->page);
+            *cached = (ScrollbackCache){ NULL, UINT64_MAX, 0 };
+        } else if (history->compressing > 0) {
+            // output faster than the thread is slowed to its pace rather than costing rows
+            size_t oldest = history->block_count - history->hot - history->compressing;
+            scrollback_worker_wait(&history->worker, scrollback_block(history, oldest)->job);
+            scrollback_attach(history);
+        } else if (history->spill.fd < 0 || in_memory == 0 || scrollback_spill_block(history) != 0) {
+            scrollback_pop_head(history);
+        }
+    }
+}
+
+// return an empty block appended to the ring
+// without the cold tier the oldest block is evicted and reused at the byte cap
+static ScrollbackBlock *scrollback_append_block(Scrollback *history) {
+    if (!history->cold && history->block_count > 0 &&
+        (history->page_count + 1) * SCROLLBACK_PAGE_SIZE > history->max_bytes)
+        scrollback_pop_head(history);
+
+    ScrollbackPage *page = scrollback_take_page(history);
+    if (!page)
+        return NULL;
+
+    // the ring doubles and is unrolled so growth stays amortized
+    if (history->block_count == history->block_capacity) {
+        size_t capacity = history->block_capacity ? history->block_capacity * 2 : 16;
+        ScrollbackBlock *blocks = malloc(capacity * sizeof(*blocks));
+        if (!blocks) {
+            scrollback_pool_page(history, page);
+            return NULL;
+        }
+        for (size_t i = 0; i < history->block_count; i++)
+            blocks[i] = *scrollback_block(history, i);
+        free(history->blocks);
+        history->blocks = blocks;
+        history->block_capacity = capacity;
+        history->block_head = 0;
+    }
+
+    page->next = NULL;
+    page->count = 0;
+    page->used = 0;
+    ScrollbackBlock *block = scrollback_block(history, history->block_count);
+    *block = (ScrollbackBlock){
+        .page = page,
+        .spill = -1,
+        .first = history->dropped + history->lines,
+        .continued = history->line_open,
+    };
+    history->block_count++;
+    history->page_count++;
+    history->hot++;
+
+    if (history->cold)
+        scrollback_cool(history);
+    return block;
+}
+
+int scrollback_init(Scrollback *history, StyleTable *styles, size_t max_lines, size_t max_bytes) {
+    if (!history || !styles)
+        return -1;
+
+    memset(history, 0, sizeof(*history));
+    history->styles = styles;
+    history->max_lines = max_lines;
+    history->max_bytes = max_bytes < SCROLLBACK_PAGE_SIZE ? SCROLLBACK_PAGE_SIZE : max_bytes;
+    history->spill.fd = -1;
+    for (size_t i = 0; i < SCROLLBACK_CACHE_PAGES; i++)
+        history->cache[i].first = UINT64_MAX;
+    return 0;
+}
+
+int scrollback_start_cold(Scrollback *history, size_t hot_bytes, bool spill) {
+    if (!history || history->cold)
+        return -1;
+
+    history->hot_pages = hot_bytes / SCROLLBACK_PAGE_SIZE;
+    if (history->hot_pages < SCROLLBACK_MIN_HOT_PAGES)
+        history->hot_pages = SCROLLBACK_MIN_HOT_PAGES;
+    history->scratch = malloc(SCROLLBACK_PACKED_SIZE);
+    history->tally = calloc(STYLE_MAX_IDS, sizeof(uint32_t));
+    if (!history->scratch || !history->tally || scrollback_worker_start(&history->worker) != 0) {
+        free(history->scratch);
+        free(history->tally);
+        history->scratch = NULL;
+        history->tally = NULL;
+        return -1;
+    }
+    history->cold = true;
+    if (spill && scrollback_spill_open(&history->spill) != 0)
+        return -1;
+    return 0;
+}
+
+void scrollback_free(Scrollback *history) {
+    if (!history)
+        return;
+
+    // the style table goes away with the screen so references are not returned
+    for (size_t i = 0; i < history->block_count; i++) {
+        ScrollbackBlock *block = scrollback_block(history, i);
+        if (block->job) {
+            scrollback_worker_cancel(&history->worker, block->job);
+            free(block->job->data);
+            free(block->job);
+        }
+        free(block->page);
+        free(block->data);
+        free(block->styles);
+        free(block->spans);
+    }
+    scrollback_worker_stop(&history->worker);
+    scrollback_spill_close(&history->spill);
+
+    while (history->free_pages) {
+        ScrollbackPage *next = history->free_pages->next;
+        free(history->free_pages);
+        history->free_pages = next;
+    }
+    for (size_t i = 0; i < SCROLLBACK_CACHE_PAGES; i++)
+        free(history->cache[i].page);
+    free(history->blocks);
+    free(history->view);
+    free(history->scratch);
+    free(history->tally);
+    memset(history, 0, sizeof(*history));
+    history->spill.fd = -1;
+}
+
+int scrollback_push(Scrollback *history, const Cell *cells, size_t length, bool wrapped) {
+    if (!history || history->max_lines == 0)
+        return 0;
+    if (length > SCROLLBACK_ROW_CELLS)
+        length = SCROLLBACK_ROW_CELLS;
+
+    // a row takes its cells plus one slot from the newest page
+    ScrollbackBlock *block = history->block_count > 0 ? scrollback_block(history, history->block_count - 1) : NULL;
+    ScrollbackPage *page = block ? block->page : NULL;
+    if (!page || page->used + page->count + length + 1 > SCROLLBACK_PAGE_CELLS) {
+        block = scrollback_append_block(history);
+        if (!block)
+            return -1;
+        page = block->page;
+    }
+
+    // repeated lines share the cells of the first one
+    ScrollbackSlot *slot = scrollback_slot(page, page->count);
+    *slot = (ScrollbackSlot){ page->used, (uint16_t)length, wrapped };
+    if (length > 0) {
+        const ScrollbackSlot *prev = page->count > 0 ? scrollback_slot(page, page->count - 1) : NULL;
+        // the wrap flag has to match too so a deflated page never outgrows the page
+        if (prev && prev->length == length && prev->wrapped == wrapped &&
+            cell_equal(page->data + prev->start, cells, length)) {
+            slot->start = prev->start;
+        } else {
+            cell_copy(page->data + page->used, cells, length);
+            page->used += (uint32_t)length;
+        }
+        scrollback_count_styles(history, cells, length, true);
+    }
+    // the block the line of this row starts in lays out differently now
+    uint64_t number = history->dropped + history->lines;
+    if (!history->line_open)
+        history->line_first = number;
+    scrollback_unfold(history, scrollback_block(history, scrollback_find(history, history->line_first)));
+
+    page->count++;
+    block->count++;
+    history->lines++;
+    history->line_open = wrapped;
+
+    if (history->lines > history->max_lines)
+        scrollback_evict_row(history);
+    return 0;
+}
+
+void scrollback_clear(Scrollback *history) {
+    if (!history)
+        return;
+    while (history->block_count > 0)
+        scrollback_pop_head(history);
+    history->line_open = false;
+}
+
+// return the rows of a block, inflating a cold one into the cache
+static const ScrollbackPage *scrollback_block_page(Scrollback *history, const ScrollbackBlock *block) {
+    if (block->page)
+        return block->page;
+
+    // pages already used by this read are kept so its rows stay valid
+    ScrollbackCache *victim = NULL;
+    for (size_t i = 0; i < SCROLLBACK_CACHE_PAGES; i++) {
+        ScrollbackCache *entry = &history->cache[i];
+        if (entry->first == block->first) {
+            entry->read = history->reads;
+            return entry->page;
+        }
+        if (entry->read != history->reads &&
+            (!victim || (victim->first != UINT64_MAX && (entry->first == UINT64_MAX || entry->read < victim->read))))
+            victim = entry;
+    }
+    if (!victim)
+        return NULL;
+    if (!victim->page && !(victim->page = malloc(SCROLLBACK_PAGE_SIZE)))
+        return NULL;
+
+    const uint8_t *data = block->data;
+    void *base = NULL;
+    size_t length = 0;
+    if (!data)
+        data = scrollback_spill_map(&history->spill, block->spill, block->size, &base, &length);
+    int status = data ? scrollback_decode(data, block->size, victim->page, history->scratch) : -1;
+    if (base)
+        scrollback_spill_unmap(base, length);
+    if (status != 0 || victim->page->count != block->count) {
+        victim->first = UINT64_MAX;
+        return NULL;
+    }
+    victim->first = block->first;
+    victim->read = history->reads;
+    return victim->page;
+}
+
+size_t scrollback_read(Scrollback *history, size_t first, size_t count, ScrollbackLine *out) {
+    if (!history || !out || first >= history->lines)
+        return 0;
+    if (count > history->lines - first)
+        count = history->lines - first;
+    if (history->cold)
+        scrollback_collect(history);
+    history->reads++;
+
+    uint64_t number = history->dropped + first;
+    size_t index = scrollback_find(history, number);
+    const ScrollbackBlock *block = scrollback_block(history, index);
+    size_t row = (size_t)(number - block->first);
+    const ScrollbackPage *page = scrollback_block_page(history, block);
+    for (size_t i = 0; i < count; i++) {
+        if (row == block->count) {
+            block = scrollback_block(history, ++index);
+            row = 0;
+            page = scrollback_block_page(history, block);
+        }
+        if (!page)
+            return i;
+        const ScrollbackSlot *slot = scrollback_slot(page, row++);
+        out[i] = (ScrollbackLine){ page->data + slot->start, slot->length, slot->wrapped != 0 };
+    }
+    return count;
+}
+
+// position in history while lines are laid out at a width
+typedef struct ScrollbackWalk {
+    size_t index;               // block
+    size_t row;                 // row in the block
+    const ScrollbackPage *page; // rows of the block, NULL when it could not be read
+} ScrollbackWalk;
+
+// load the rows of block index, each block counts as its own read so a long walk never runs out of cache
+static void scrollback_walk_to(Scrollback *history, ScrollbackWalk *walk, size_t index, size_t row) {
+    history->reads++;
+    walk->index = index;
+    walk->row = row;
+    walk->page = scrollback_block_page(history, scrollback_block(history, index));
+}
+
+static bool scrollback_walk_done(const Scrollback *history, const ScrollbackWalk *walk) {
+    return !walk->page || walk->row == scrollback_block(history, walk->index)->count;
+}
+
+// step to the next row, crossing into the next block when this one runs out
+static void scrollback_walk_step(Scrollback *history, ScrollbackWalk *walk) {
+    walk->row++;
+    if (walk->row == scrollback_block(history, walk->index)->count && walk->index + 1 < history->block_count)
+        scrollback_walk_to(history, walk, walk->index + 1, 0);
+}
+
+// position the walk at the first line starting in block index
+// returns false when every row of the block carries on an older line or it cannot be read
+static bool scrollback_walk_block(Scrollback *history, ScrollbackWalk *walk, size_t index) {
+    const ScrollbackBlock *block = scrollback_block(history, index);
+    scrollback_walk_to(history, walk, index, index == 0 ? history->head_row : 0);
+    if (index == 0 || !block->continued)
+        return walk->page != NULL;
+
+    // skip the rest of the line the block before started
+    while (walk->page && walk->index == index && walk->row < block->count) {
+        bool wrapped = scrollback_slot(walk->page, walk->row)->wrapped != 0;
+        scrollback_walk_step(history, walk);
+        if (!wrapped)
+            break;
+    }
+    return walk->page && walk->index == index && walk->row < block->count;
+}
+
+// return rows a line of length cells takes at width, an empty one still takes a row
+static size_t scrollback_line_rows(size_t length, size_t width) {
+    return length == 0 ? 1 : (length + width - 1) / width;
+}
+
+// note the lengths of the lines starting in block index, false when a block they cross cannot be read
+static bool scrollback_measure(Scrollback *history, size_t index) {
+    ScrollbackBlock *block = scrollback_block(history, index);
+    // every line starts on a row of its own so the block count bounds them
+    uint32_t *spans = malloc(block->count * sizeof(uint32_t));
+    if (!spans)
+        return false;
+
+    ScrollbackWalk walk;
+    uint32_t count = 0;
+    if (scrollback_walk_block(history, &walk, index)) {
+        while (walk.index == index && !scrollback_walk_done(history, &walk)) {
+            size_t length = 0;
+            bool wrapped;
+            do {
+                const ScrollbackSlot *slot = scrollback_slot(walk.page, walk.row);
+                length += slot->length;
+                wrapped = slot->wrapped != 0;
+                scrollback_walk_step(history, &walk);
+            } while (wrapped && !scrollback_walk_done(history, &walk));
+            spans[count++] = length < UINT32_MAX ? (uint32_t)length : UINT32_MAX;
+        }
+    }
+    if (!walk.page) {
+        free(spans);
+        return false;
+    }
+
+    uint32_t *fitted = realloc(spans, (count > 0 ? count : 1) * sizeof(uint32_t));
+    block->spans = fitted ? fitted : spans;
+    block->span_count = count;
+    history->span_bytes += count * sizeof(uint32_t);
+    return true;
+}
+
+// return rows the lines starting in block index take at width, counted once per width
+static size_t scrollback_fold(Scrollback *history, size_t index, size_t width) {
+    ScrollbackBlock *block = scrollback_block(history, index);
+    if (block->fold_width == width)
+        return block->fold_rows;
+    if (!block->spans && !scrollback_measure(history, index))
+        return 0;
+
+    size_t rows = 0;
+    for (uint32_t i = 0; i < block->span_count; i++)
+        rows += scrollback_line_rows(block->spans[i], width);
+    block->fold_width = (uint32_t)width;
+    block->fold_rows = (uint32_t)rows;
+    return rows;
+}
+
+size_t scrollback_read_width(Scrollback *history, size_t width, size_t back, size_t count, ScrollbackLine *out) {
+    if (!history || !out || width == 0 || width > UINT32_MAX || count == 0 || history->lines == 0)
+        return 0;
+    if (width > SIZE_MAX / sizeof(Cell) / count)
+        return 0;
+    if (history->view_capacity < count * width) {
+        Cell *view = realloc(history->view, count * width * sizeof(Cell));
+        if (!view)
+            return 0;
+        history->view = view;
+        history->view_capacity = count * width;
+    }
+    if (history->cold)
+        scrollback_collect(history);
+
+    // measure blocks from the newest back until their lines cover the viewport
+    size_t want = back > SIZE_MAX - count ? SIZE_MAX : back + count;
+    size_t below = 0;
+    size_t index = history->block_count;
+    while (index > 0 && below < want)
+        below += scrollback_fold(history, --index, width);
+    if (below <= back)
+        return 0;
+    size_t skip = below > want ? below - want : 0;
+    size_t total = below - back < count ? below - back : count;
+
+    // lay out lines from the first one starting in that block, copying cells that land in the viewport
+    ScrollbackWalk walk;
+    if (!scrollback_walk_block(history, &walk, index))
+        return 0;
+    size_t filled = 0;
+    while (filled < total && !scrollback_walk_done(history, &walk)) {
+        size_t from = skip * width;
+        size_t to = from + (total - filled) * width;
+        Cell *view = history->view + filled * width;
+        size_t length = 0;
+        bool wrapped;
+        do {
+            const ScrollbackSlot *slot = scrollback_slot(walk.page, walk.row);
+            size_t start = length > from ? length : from;
+            size_t end = length + slot->length < to ? length + slot->length : to;
+            if (start < end)
+                cell_copy(view + (start - from), walk.page->data + slot->start + (start - length), end - start);
+            length += slot->length;
+            wrapped = slot->wrapped != 0;
+            scrollback_walk_step(history, &walk);
+        } while (wrapped && !scrollback_walk_done(history, &walk));
+        if (!walk.page)
+            break;
+
+        size_t rows = scrollback_line_rows(length, width);
+        if (skip >= rows) {
+            skip -= rows;
+            continue;
+        }
+        // only the last row of a line still open at the bottom keeps the wrap
+        for (size_t row = skip; row < rows && filled < total; row++, filled++) {
+            size_t start = row * width;
+            size_t cells = length - start < width ? length - start : width;
+            out[filled] = (ScrollbackLine){ history->view + filled * width, cells, row + 1 < rows || wrapped };
+        }
+        skip = 0;
+    }
+    return filled;
+}
+
+size_t scrollback_memory(const Scrollback *history) {
+    if (!history)
+        return 0;
+    return scrollback_memory_used(history) + history->block_capacity * sizeof(ScrollbackBlock) +
+           history->view_capacity * sizeof(Cell) + history->span_bytes;
+}
+
+size_t scrollback_spilled(const Scrollback *history) {
+    return history && history->spill.fd >= 0 ? history->spill.end - history->spill.start : 0;
+}
@@ -0,0 +1,372 @@
+#define _XOPEN_SOURCE 700
+
+#include <scrollback_cold.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>     // pread pwrite ftruncate
+
+#include <zlib.h>
+
+#include <cell_kernel.h>
+#include <scrollback.h>
+
+// deflate level, higher ones cost three times the time for a fifth less
+#define SCROLLBACK_DEFLATE_LEVEL 1
+// bytes moved per read when compacting the spill file
+#define SCROLLBACK_SPILL_CHUNK (64 * 1024)
+
+// append v seven bits at a time, the high bit marks more to come
+static size_t scrollback_put_varint(uint8_t *out, uint32_t v) {
+    size_t at = 0;
+    while (v >= 0x80) {
+        out[at++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[at++] = (uint8_t)v;
+    return at;
+}
+
+// read a varint at *at, returns false past end or on one longer than 32 bits
+static bool scrollback_get_varint(const uint8_t *data, size_t end, size_t *at, uint32_t *v) {
+    *v = 0;
+    for (unsigned shift = 0; shift < 35 && *at < end; shift += 7) {
+        uint8_t byte = data[(*at)++];
+        *v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+// pack a page as records of a repeat count, length, wrap flag, codepoints and style runs
+// rows sharing the previous row's cells or blank like it collapse into its record
+// varints keep ascii to a byte so deflate sees an eighth of the cell bytes
+static size_t scrollback_encode(const ScrollbackPage *page, uint8_t *out) {
+    size_t at = 0;
+    size_t repeat_at = 0;
+    const ScrollbackSlot *prev = NULL;
+    for (uint32_t row = 0; row < page->count; row++) {
+        const ScrollbackSlot *slot = scrollback_slot(page, row);
+        if (prev && slot->length == prev->length && slot->wrapped == prev->wrapped &&
+            (slot->length == 0 || slot->start == prev->start)) {
+            uint32_t repeat;
+            memcpy(&repeat, out + repeat_at, sizeof(repeat));
+            repeat++;
+            memcpy(out + repeat_at, &repeat, sizeof(repeat));
+            continue;
+        }
+        prev = slot;
+
+        repeat_at = at;
+        uint32_t repeat = 1;
+        memcpy(out + at, &repeat, sizeof(repeat));
+        at += sizeof(repeat);
+        at += scrollback_put_varint(out + at, slot->length);
+        out[at++] = (uint8_t)slot->wrapped;
+        const Cell *cells = page->data + slot->start;
+        for (size_t col = 0; col < slot->length; col++)
+            at += scrollback_put_varint(out + at, cells[col].codepoint);
+        for (size_t col = 0; col < slot->length;) {
+            size_t run = cell_style_run(cells + col, slot->length - col, cells[col].style);
+            at += scrollback_put_varint(out + at, cells[col].style);
+            at += scrollback_put_varint(out + at, (uint32_t)run);
+            col += run;
+        }
+    }
+    return at;
+}
+
+// the stream is reset rather than set up again, its tables cost more than a page to clear
+static void scrollback_compress(ScrollbackJob *job, uint8_t *scratch, z_stream *stream) {
+    job->data = NULL;
+    job->size = 0;
+    if (!scratch || deflateReset(stream) != Z_OK)
+        return;
+
+    // records never outgrow twice the page they came from
+    size_t length = scrollback_encode(job->page, scratch);
+    uLong bound = deflateBound(stream, (uLong)length);
+    uint8_t *data = malloc(bound);
+    if (!data)
+        return;
+    stream->next_in = scratch;
+    stream->avail_in = (uInt)length;
+    stream->next_out = data;
+    stream->avail_out = (uInt)bound;
+    if (deflate(stream, Z_FINISH) != Z_STREAM_END) {
+        free(data);
+        return;
+    }
+    uint8_t *shrunk = realloc(data, stream->total_out);
+    job->data = shrunk ? shrunk : data;
+    job->size = stream->total_out;
+}
+
+static void *scrollback_worker_main(void *arg) {
+    ScrollbackWorker *worker = arg;
+    uint8_t *scratch = malloc(SCROLLBACK_PACKED_SIZE);
+    z_stream stream = { 0 };
+    if (deflateInit(&stream, SCROLLBACK_DEFLATE_LEVEL) != Z_OK) {
+        free(scratch);
+        scratch = NULL;
+    }
+
+    pthread_mutex_lock(&worker->lock);
+    for (;;) {
+        while (!worker->stop && !worker->head)
+            pthread_cond_wait(&worker->work, &worker->lock);
+        if (worker->stop)
+            break;
+        ScrollbackJob *job = worker->head;
+        worker->head = job->next;
+        if (!worker->head)
+            worker->tail = NULL;
+        worker->active = job;
+        pthread_mutex_unlock(&worker->lock);
+
+        scrollback_compress(job, scratch, &stream);
+
+        pthread_mutex_lock(&worker->lock);
+        job->done = true;
+        worker->active = NULL;
+        atomic_fetch_add_explicit(&worker->finished, 1, memory_order_release);
+        pthread_cond_broadcast(&worker->done);
+    }
+    pthread_mutex_unlock(&worker->lock);
+    if (scratch)
+        deflateEnd(&stream);
+    free(scratch);
+    return NULL;
+}
+
+int scrollback_worker_start(ScrollbackWorker *worker) {
+    if (!worker)
+        return -1;
+
+    memset(worker, 0, sizeof(*worker));
+    if (pthread_mutex_init(&worker->lock, NULL) != 0)
+        return -1;
+    if (pthread_cond_init(&worker->work, NULL) != 0) {
+        pthread_mutex_destroy(&worker->lock);
+        return -1;
+    }
+    if (pthread_cond_init(&worker->done, NULL) != 0) {
+        pthread_cond_destroy(&worker->work);
+        pthread_mutex_destroy(&worker->lock);
+        return -1;
+    }
+    if (pthread_create(&worker->thread, NULL, scrollback_worker_main, worker) != 0) {
+        pthread_cond_destroy(&worker->done);
+        pthread_cond_destroy(&worker->work);
+        pthread_mutex_destroy(&worker->lock);
+        return -1;
+    }
+    worker->running = true;
+    return 0;
+}
+
+void scrollback_worker_stop(ScrollbackWorker *worker) {
+    if (!worker || !worker->running)
+        return;
+
+    pthread_mutex_lock(&worker->lock);
+    worker->stop = true;
+    pthread_cond_broadcast(&worker->work);
+    pthread_mutex_unlock(&worker->lock);
+    pthread_join(worker->thread, NULL);
+
+    pthread_cond_destroy(&worker->done);
+    pthread_cond_destroy(&worker->work);
+    pthread_mutex_destroy(&worker->lock);
+    memset(worker, 0, sizeof(*worker));
+}
+
+void scrollback_worker_submit(ScrollbackWorker *worker, ScrollbackJob *job) {
+    job->next = NULL;
+    job->data = NULL;
+    job->size = 0;
+    job->done = false;
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->tail)
+        worker->tail->next = job;
+    else
+        worker->head = job;
+    worker->tail = job;
+    pthread_cond_signal(&worker->work);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+void scrollback_worker_cancel(ScrollbackWorker *worker, ScrollbackJob *job) {
+    pthread_mutex_lock(&worker->lock);
+    // a queued job is unlinked, the running one is waited for
+    ScrollbackJob *prev = NULL;
+    for (ScrollbackJob *it = worker->head; it; prev = it, it = it->next) {
+        if (it != job)
+            continue;
+        if (prev)
+            prev->next = it->next;
+        else
+            worker->head = it->next;
+        if (worker->tail == it)
+            worker->tail = prev;
+        job->done = true;
+        break;
+    }
+    while (!job->done)
+        pthread_cond_wait(&worker->done, &worker->lock);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+bool scrollback_worker_done(ScrollbackWorker *worker, ScrollbackJob *job) {
+    pthread_mutex_lock(&worker->lock);
+    bool done = job->done;
+    pthread_mutex_unlock(&worker->lock);
+    return done;
+}
+
+void scrollback_worker_wait(ScrollbackWorker *worker, ScrollbackJob *job) {
+    pthread_mutex_lock(&worker->lock);
+    while (!job->done)
+        pthread_cond_wait(&worker->done, &worker->lock);
+    pthread_mutex_unlock(&worker->lock);
+}
+
+int scrollback_decode(const uint8_t *data, size_t size, ScrollbackPage *page, uint8_t *scratch) {
+    uLongf length = SCROLLBACK_PACKED_SIZE;
+    if (uncompress(scratch, &length, data, (uLong)size) != Z_OK)
+        return -1;
+
+    // every row of a record points at the same cells
+    page->count = 0;
+    page->used = 0;
+    size_t at = 0;
+    while (at < length) {
+        uint32_t repeat, cols, value, run;
+        if (at + sizeof(repeat) > length)
+            return -1;
+        memcpy(&repeat, scratch + at, sizeof(repeat));
+        at += sizeof(repeat);
+        if (!scrollback_get_varint(scratch, length, &at, &cols) || at >= length)
+            return -1;
+        uint16_t wrapped = scratch[at++];
+        if ((size_t)page->used + page->count + cols + repeat > SCROLLBACK_PAGE_CELLS)
+            return -1;
+
+        Cell *cells = page->data + page->used;
+        for (size_t col = 0; col < cols; col++) {
+            if (!scrollback_get_varint(scratch, length, &at, &value))
+                return -1;
+            cells[col].codepoint = value;
+        }
+        for (size_t col = 0; col < cols; col += run) {
+            if (!scrollback_get_varint(scratch, length, &at, &value) ||
+                !scrollback_get_varint(scratch, length, &at, &run) || run == 0 || run > cols - col)
+                return -1;
+            for (size_t i = 0; i < run; i++)
+                cells[col + i].style = value;
+        }
+        for (uint32_t i = 0; i < repeat; i++)
+            *scrollback_slot(page, page->count++) = (ScrollbackSlot){ page->used, (uint16_t)cols, wrapped };
+        page->used += cols;
+    }
+    return 0;
+}
+
+int scrollback_spill_open(ScrollbackSpill *spill) {
+    if (!spill)
+        return -1;
+
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/termite-scrollback-XXXXXX", dir && *dir ? dir : "/tmp");
+    spill->fd = mkstemp(path);
+    spill->start = 0;
+    spill->end = 0;
+    if (spill->fd < 0)
+        return -1;
+    // nothing else ever opens it and the space goes away with the descriptor
+    unlink(path);
+    return 0;
+}
+
+void scrollback_spill_close(ScrollbackSpill *spill) {
+    if (!spill || spill->fd < 0)
+        return;
+    close(spill->fd);
+    spill->fd = -1;
+    spill->start = 0;
+    spill->end = 0;
+}
+
+int64_t scrollback_spill_write(ScrollbackSpill *spill, const uint8_t *data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = pwrite(spill->fd, data + written, size - written, (off_t)(spill->end + written));
+        if (n <= 0)
+            return -1;
+        written += (size_t)n;
+    }
+    int64_t offset = (int64_t)spill->end;
+    spill->end += size;
+    return offset;
+}
+
+// drop the file past the live bytes
+static void scrollback_spill_truncate(ScrollbackSpill *spill) {
+    // failing only leaves dead bytes at the end of the file
+    if (ftruncate(spill->fd, (off_t)spill->end) != 0)
+        return;
+}
+
+void scrollback_spill_release(ScrollbackSpill *spill, size_t end) {
+    spill->start = end;
+    if (spill->start == spill->end) {
+        spill->start = 0;
+        spill->end = 0;
+        scrollback_spill_truncate(spill);
+    }
+}
+
+size_t scrollback_spill_compact(ScrollbackSpill *spill) {
+    // only a dead prefix at least as large as the live bytes is worth moving
+    // and then the copy never writes over bytes it has not read
+    size_t moved = spill->start;
+    if (moved == 0 || moved < spill->end - moved)
+        return 0;
+
+    uint8_t chunk[SCROLLBACK_SPILL_CHUNK];
+    for (size_t at = spill->start; at < spill->end;) {
+        size_t want = spill->end - at < sizeof(chunk) ? spill->end - at : sizeof(chunk);
+        ssize_t n = pread(spill->fd, chunk, want, (off_t)at);
+        if (n <= 0 || pwrite(spill->fd, chunk, (size_t)n, (off_t)(at - moved)) != n)
+            return 0;
+        at += (size_t)n;
+    }
+    spill->end -= moved;
+    spill->start = 0;
+    scrollback_spill_truncate(spill);
+    return moved;
+}
+
+const uint8_t *scrollback_spill_map(const ScrollbackSpill *spill, int64_t offset, size_t size, void **base,
+                                    size_t *length) {
+    // mappings start on a page boundary
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t aligned = (size_t)offset & ~(page - 1);
+    *length = (size_t)offset - aligned + size;
+    *base = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, spill->fd, (off_t)aligned);
+    if (*base == MAP_FAILED) {
+        *base = NULL;
+        return NULL;
+    }
+    return (const uint8_t *)*base + ((size_t)offset - aligned);
+}
+
+void scrollback_spill_unmap(void *base, size_t length) {
+    munmap(base, length);
+}
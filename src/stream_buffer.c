@@ -0,0 +1,195 @@
+#include <stream_buffer.h>
+
+#include <string.h>
+
+// wait for the gpu to pass a fence and count the wait when it had not yet
+static void stream_buffer_wait(StreamBuffer *stream, GLsync sync) {
+    GLenum status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+        return;
+
+    stream->stats.fence_waits++;
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+}
+
+// forget every fence once the storage they guard is going away
+static void stream_buffer_drop_fences(StreamBuffer *stream) {
+    for (size_t i = 0; i < stream->fence_count; i++)
+        glDeleteSync(stream->fences[(stream->fence_first + i) % STREAM_BUFFER_MAX_FENCES].sync);
+    stream->fence_first = 0;
+    stream->fence_count = 0;
+}
+
+// make fresh storage of size bytes, mapped for good when buffer storage exists
+static int stream_buffer_allocate(StreamBuffer *stream, size_t size) {
+    // immutable storage cannot be respecified so a new buffer replaces it
+    // the driver keeps the old one alive until draws reading it finish
+    stream_buffer_drop_fences(stream);
+    if (stream->buffer)
+        glDeleteBuffers(1, &stream->buffer);
+    stream->buffer = 0;
+    stream->mapped = NULL;
+
+    glGenBuffers(1, &stream->buffer);
+    glBindBuffer(stream->target, stream->buffer);
+    if (GLAD_GL_ARB_buffer_storage && glBufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(stream->target, (GLsizeiptr)size, NULL, flags);
+        stream->mapped = glMapBufferRange(stream->target, 0, (GLsizeiptr)size, flags);
+        if (!stream->mapped) {
+            glDeleteBuffers(1, &stream->buffer);
+            glGenBuffers(1, &stream->buffer);
+            glBindBuffer(stream->target, stream->buffer);
+        }
+    }
+    if (!stream->mapped)
+        glBufferData(stream->target, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+
+    stream->size = size;
+    stream->head = 0;
+    stream->fenced = 0;
+    stream->retired = 0;
+    return stream->buffer ? 0 : -1;
+}
+
+int stream_buffer_init(StreamBuffer *stream, GLenum target, size_t size) {
+    if (!stream)
+        return -1;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->target = target;
+    if (size < STREAM_BUFFER_ALIGN)
+        size = STREAM_BUFFER_DEFAULT_SIZE;
+    size = (size + STREAM_BUFFER_ALIGN - 1) & ~(size_t)(STREAM_BUFFER_ALIGN - 1);
+    if (stream_buffer_allocate(stream, size) != 0) {
+        stream_buffer_free(stream);
+        return -1;
+    }
+    return 0;
+}
+
+void stream_buffer_free(StreamBuffer *stream) {
+    if (!stream)
+        return;
+
+    stream_buffer_drop_fences(stream);
+    if (stream->mapped) {
+        glBindBuffer(stream->target, stream->buffer);
+        glUnmapBuffer(stream->target);
+    }
+    if (stream->buffer)
+        glDeleteBuffers(1, &stream->buffer);
+    memset(stream, 0, sizeof(*stream));
+}
+
+// claim bytes of the ring, waiting or orphaning as needed, and return where they start
+static int stream_buffer_claim(StreamBuffer *stream, size_t bytes, size_t *offset) {
+    if (!stream || !stream->buffer || bytes == 0)
+        return -1;
+
+    // a frame larger than the ring gets a ring with room for two of them
+    if (bytes > stream->size) {
+        size_t size = stream->size;
+        while (size < bytes * 2)
+            size *= 2;
+        if (stream_buffer_allocate(stream, size) != 0)
+            return -1;
+        stream->stats.grows++;
+    }
+
+    // uploads never straddle the end so each one is a single range
+    size_t pos = (stream->head + STREAM_BUFFER_ALIGN - 1) & ~(size_t)(STREAM_BUFFER_ALIGN - 1);
+    size_t start = pos % stream->size;
+    if (start + bytes > stream->size) {
+        pos += stream->size - start;
+        start = 0;
+    }
+    glBindBuffer(stream->target, stream->buffer);
+
+    if (stream->mapped) {
+        // the range was last written one lap ago and must be done being read
+        size_t limit = pos + bytes > stream->size ? pos + bytes - stream->size : 0;
+        while (stream->retired < limit) {
+            if (stream->fence_count == 0) {
+                // only unfenced uploads of this frame are left so fence them now
+                stream_buffer_fence(stream);
+                if (stream->fence_count == 0)
+                    break;
+            }
+            StreamFence *fence = &stream->fences[stream->fence_first];
+            stream_buffer_wait(stream, fence->sync);
+            glDeleteSync(fence->sync);
+            stream->retired = fence->end;
+            stream->fence_first = (stream->fence_first + 1) % STREAM_BUFFER_MAX_FENCES;
+            stream->fence_count--;
+        }
+    } else if (start == 0 && stream->head > 0) {
+        // a wrap orphans the storage rather than waiting for draws still reading it
+        glBufferData(stream->target, (GLsizeiptr)stream->size, NULL, GL_STREAM_DRAW);
+        stream->stats.orphans++;
+    }
+
+    stream->head = pos + bytes;
+    stream->stats.bytes_uploaded += bytes;
+    stream->stats.uploads++;
+    *offset = start;
+    return 0;
+}
+
+int stream_buffer_upload(StreamBuffer *stream, const void *data, size_t bytes, size_t *offset) {
+    size_t start;
+    if (stream_buffer_claim(stream, bytes, &start) != 0)
+        return -1;
+
+    if (stream->mapped) {
+        memcpy(stream->mapped + start, data, bytes);
+    } else {
+        GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+        void *range = glMapBufferRange(stream->target, (GLintptr)start, (GLsizeiptr)bytes, access);
+        if (range) {
+            memcpy(range, data, bytes);
+            glUnmapBuffer(stream->target);
+        } else {
+            glBufferSubData(stream->target, (GLintptr)start, (GLsizeiptr)bytes, data);
+        }
+    }
+    *offset = start;
+    return 0;
+}
+
+void *stream_buffer_reserve(StreamBuffer *stream, size_t bytes, size_t *offset) {
+    // without a lasting mapping the range could not be written after returning
+    if (!stream || !stream->mapped)
+        return NULL;
+
+    size_t start;
+    if (stream_buffer_claim(stream, bytes, &start) != 0)
+        return NULL;
+    *offset = start;
+    return stream->mapped + start;
+}
+
+void stream_buffer_fence(StreamBuffer *stream) {
+    // orphaned storage needs no fences since written ranges are never reused
+    if (!stream || !stream->mapped || stream->fenced == stream->head)
+        return;
+
+    GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (!sync)
+        return;
+
+    // a later fence also covers everything before it so a full queue replaces its newest
+    if (stream->fence_count == STREAM_BUFFER_MAX_FENCES) {
+        StreamFence *newest = &stream->fences[(stream->fence_first + stream->fence_count - 1) % STREAM_BUFFER_MAX_FENCES];
+        glDeleteSync(newest->sync);
+        newest->sync = sync;
+        newest->end = stream->head;
+    } else {
+        StreamFence *fence = &stream->fences[(stream->fence_first + stream->fence_count) % STREAM_BUFFER_MAX_FENCES];
+        fence->sync = sync;
+        fence->end = stream->head;
+        stream->fence_count++;
+    }
+    stream->fenced = stream->head;
+}
@@ -0,0 +1,159 @@
+#include <style.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STYLE_INITIAL_CAPACITY 64
+
+static size_t style_hash(const Style *style) {
+    uint64_t h = style->fg * 0x9E3779B97F4A7C15ull;
+    h ^= (style->bg + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint64_t)style->attrs * 0x165667B19E3779F9ull;
+    return (size_t)(h ^ (h >> 29));
+}
+
+// allocate arrays for capacity ids and rehash the live ones
+static int style_table_grow(StyleTable *table, size_t capacity) {
+    Style *styles = realloc(table->styles, capacity * sizeof(Style));
+    if (styles)
+        table->styles = styles;
+    uint32_t *refs = realloc(table->refs, capacity * sizeof(uint32_t));
+    if (refs)
+        table->refs = refs;
+    uint8_t *queued = realloc(table->queued, capacity);
+    if (queued)
+        table->queued = queued;
+    uint32_t *free_ids = realloc(table->free_ids, capacity * sizeof(uint32_t));
+    if (free_ids)
+        table->free_ids = free_ids;
+    uint32_t *pending = realloc(table->pending, capacity * sizeof(uint32_t));
+    if (pending)
+        table->pending = pending;
+    // slots stay at most half full so probes end quickly
+    uint32_t *slots = calloc(capacity * 2, sizeof(uint32_t));
+    if (!styles || !refs || !queued || !free_ids || !pending || !slots) {
+        free(slots);
+        return -1;
+    }
+
+    memset(table->refs + table->capacity, 0, (capacity - table->capacity) * sizeof(uint32_t));
+    memset(table->queued + table->capacity, 0, capacity - table->capacity);
+    free(table->slots);
+    table->slots = slots;
+    table->slot_mask = capacity * 2 - 1;
+    table->capacity = capacity;
+
+    // free ids are the ones neither referenced nor waiting in pending
+    for (size_t id = 0; id < table->count; id++) {
+        if (id != STYLE_DEFAULT_ID && table->refs[id] == 0 && !table->queued[id])
+            continue;
+        size_t slot = style_hash(&table->styles[id]) & table->slot_mask;
+        while (table->slots[slot])
+            slot = (slot + 1) & table->slot_mask;
+        table->slots[slot] = (uint32_t)id + 1;
+    }
+    return 0;
+}
+
+int style_table_init(StyleTable *table) {
+    if (!table)
+        return -1;
+
+    memset(table, 0, sizeof(*table));
+    if (style_table_grow(table, STYLE_INITIAL_CAPACITY) != 0) {
+        style_table_free(table);
+        return -1;
+    }
+
+    // default style occupies id zero for the lifetime of the table
+    table->styles[STYLE_DEFAULT_ID] = (Style){0};
+    table->count = 1;
+    size_t slot = style_hash(&table->styles[STYLE_DEFAULT_ID]) & table->slot_mask;
+    table->slots[slot] = STYLE_DEFAULT_ID + 1;
+    return 0;
+}
+
+void style_table_free(StyleTable *table) {
+    if (!table)
+        return;
+    free(table->styles);
+    free(table->refs);
+    free(table->queued);
+    free(table->slots);
+    free(table->free_ids);
+    free(table->pending);
+    memset(table, 0, sizeof(*table));
+}
+
+uint32_t style_table_intern(StyleTable *table, const Style *style) {
+    size_t slot = style_hash(style) & table->slot_mask;
+    while (table->slots[slot]) {
+        uint32_t id = table->slots[slot] - 1;
+        if (style_equal(&table->styles[id], style))
+            return id;
+        slot = (slot + 1) & table->slot_mask;
+    }
+
+    // reuse a recycled id before handing out a new one
+    uint32_t id;
+    if (table->free_count > 0) {
+        id = table->free_ids[--table->free_count];
+    } else {
+        if (table->count == table->capacity) {
+            if (table->capacity >= STYLE_MAX_IDS || style_table_grow(table, table->capacity * 2) != 0)
+                return STYLE_DEFAULT_ID;
+            // growing rehashed everything so find the empty slot again
+            slot = style_hash(style) & table->slot_mask;
+            while (table->slots[slot])
+                slot = (slot + 1) & table->slot_mask;
+        }
+        id = (uint32_t)table->count++;
+    }
+
+    table->styles[id] = *style;
+    table->refs[id] = 0;
+    table->slots[slot] = id + 1;
+
+    // an id nobody acquires is collected like any released one
+    style_table_retire(table, id);
+    return id;
+}
+
+void style_table_retire(StyleTable *table, uint32_t id) {
+    if (table->queued[id])
+        return;
+    table->queued[id] = 1;
+    table->pending[table->pending_count++] = id;
+}
+
+// remove an id from the hash shifting later probes back into the hole
+static void style_table_unlink(StyleTable *table, uint32_t id) {
+    size_t mask = table->slot_mask;
+    size_t slot = style_hash(&table->styles[id]) & mask;
+    while (table->slots[slot] != id + 1)
+        slot = (slot + 1) & mask;
+
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask; table->slots[next]; next = (next + 1) & mask) {
+        size_t home = style_hash(&table->styles[table->slots[next] - 1]) & mask;
+        // move the entry when its home does not lie between the hole and its slot
+        bool between = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!between) {
+            table->slots[hole] = table->slots[next];
+            hole = next;
+        }
+    }
+    table->slots[hole] = 0;
+}
+
+void style_table_collect(StyleTable *table) {
+    for (size_t i = 0; i < table->pending_count; i++) {
+        uint32_t id = table->pending[i];
+        table->queued[id] = 0;
+        if (table->refs[id] != 0)
+            continue;
+        style_table_unlink(table, id);
+        table->free_ids[table->free_count++] = id;
+    }
+    table->pending_count = 0;
+}
@@ -1,171 +1,155 @@
-#include <terminal.h>
-
-#include <stdlib.h>
-
-#include <text.h>
-
-#define CURSOR_BLINK_INTERVAL 0.5
-#define CURSOR_INPUT_PAUSE 0.15
-
-static void terminal_handle_control_char(TerminalState *term, uint8_t byte);
-
-int terminal_init(TerminalState *term, float initial_scale) {
-    if (!term)
-        return -1;
-
-    // reset terminal fields to defaults
-    term->grid = NULL;
-    term->text_scale = initial_scale;
-    term->cursor_visible = true;
-    term->last_toggle = 0.0;
-    term->last_input_time = 0.0;
-    term->cursor_row = 0;
-    term->cursor_col = 0;
-    term->scroll_top = 0;
-    term->scroll_bottom = 0;
-    esc_parser_init(&term->parser);
-
-    // configure base metrics before allocating grid
-    text_set_base_scale(term->text_scale);
-    x_spacing = glyph_width * term->text_scale;
-    y_spacing = glyph_height * term->text_scale;
-
-    // allocate backing grid filled with spaces
-    term->grid = text_setup_grid();
-    if (!term->grid)
-        return -1;
-
-    term->scroll_top = 0;
-    term->scroll_bottom = grid_y_size - 1;
-    return 0;
-}
-
-void terminal_free(TerminalState *term) {
-    if (!term)
-        return;
-    // release dynamic grid buffer
-    free(term->grid);
-    term->grid = NULL;
-}
-
-bool terminal_resize(TerminalState *term, int width, int height) {
-    if (!term || !term->grid)
-        return false;
-
-    // rebuild grid to match new resolution
-    int *new_grid = text_resize_grid(term->grid, width, height, &term->text_scale, &term->cursor_row,
-                               &term->cursor_col, &term->scroll_top, &term->scroll_bottom);
-    if (!new_grid)
-        return false;
-
-    term->grid = new_grid;
-    return true;
-}
-
-void terminal_process_data(TerminalState *term, const uint8_t *data, size_t len) {
-    if (!term || !term->grid || !data)
-        return;
-
-    // parse escape sequences and printable bytes
-    for (size_t i = 0; i < len; i++) {
-        uint8_t byte = data[i];
-
-        if (esc_parser_process(&term->parser, byte, &term->cursor_row, &term->cursor_col, term->grid,
-                               grid_x_size, grid_y_size, &term->scroll_top, &term->scroll_bottom)) {
-            continue;
-        }
-
-        terminal_handle_control_char(term, byte);
-    }
-}
-
-void terminal_on_input_activity(TerminalState *term, double now) {
-    if (!term)
-        return;
-    // keep cursor visible while receiving data
-    term->cursor_visible = true;
-    term->last_toggle = now;
-    term->last_input_time = now;
-}
-
-void terminal_update_cursor(TerminalState *term, double now) {
-    if (!term)
-        return;
-
-    // toggle cursor when idle 
-    if (now - term->last_input_time < CURSOR_INPUT_PAUSE) {
-        term->cursor_visible = true;
-        term->last_toggle = now;
-    } else if (now - term->last_toggle >= CURSOR_BLINK_INTERVAL) {
-        term->cursor_visible = !term->cursor_visible;
-        term->last_toggle = now;
-    }
-}
-
-void terminal_render(const TerminalState *term, GLuint shader_program, const vec3 fg_color,
-                     const vec3 bg_color) {
-    if (!term || !term->grid)
-        return;
-
-    // draw each glyph and cursor overlay
-    for (int y = 0; y < grid_y_size; y++) {
-        int draw_y = grid_y_size - 1 - y;
-
-        for (int x = 0; x < grid_x_size; x++) {
-            char c = (char)term->grid[y * grid_x_size + x];
-            float xpos = margin_x + x * x_spacing;
-            float ypos = margin_y * 1.25f + draw_y * y_spacing;
-
-            if (term->cursor_visible && y == term->cursor_row && x == term->cursor_col) {
-                text_render_cursor(shader_program, term->text_scale, draw_y, x, fg_color, bg_color, c);
-            } else {
-                text_render_char(shader_program, c, xpos, ypos, term->text_scale, fg_color);
-            }
-        }
-    }
-}
-
-static void terminal_handle_control_char(TerminalState *term, uint8_t byte) {
-    switch (byte) {
-    case '\r':
-        // return carriage to column zero
-        term->cursor_col = 0;
-        break;
-    case '\n':
-        term->cursor_col = 0;
-        term->cursor_row++;
-        if (term->cursor_row > term->scroll_bottom) {
-            // scroll region upward when leaving bottom
-            term_scroll_region_up(term->grid, grid_x_size, term->scroll_top, term->scroll_bottom);
-            term->cursor_row = term->scroll_bottom;
-        }
-        break;
-    case '\b':
-        if (term->cursor_col > 0)
-            term->cursor_col--;
-        break;
-    case '\x7F':
-        if (term->cursor_col > 0) {
-            term->cursor_col--;
-            term->grid[term->cursor_row * grid_x_size + term->cursor_col] = ' ';
-        }
-        break;
-    default:
-        if (byte >= 32 && byte <= 126) {
-            // place printable character and advance cursor
-            term->grid[term->cursor_row * grid_x_size + term->cursor_col] = byte;
-            term->cursor_col++;
-            if (term->cursor_col >= grid_x_size) {
-                term->cursor_col = 0;
-                term->cursor_row++;
-                if (term->cursor_row > term->scroll_bottom) {
-                    // scroll when reaching end of region
-                    term_scroll_region_up(term->grid, grid_x_size, term->scroll_top, term->scroll_bottom);
-                    term->cursor_row = term->scroll_bottom;
-                }
-            }
-        }
-        break;
-    }
-}
-
+#include <terminal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <text.h>
+
+#define CURSOR_BLINK_INTERVAL 0.5
+#define CURSOR_INPUT_PAUSE 0.15
+// history rows kept unless TERMITE_SCROLLBACK says otherwise, zero turns it off
+#define SCROLLBACK_DEFAULT_LINES 100000
+// memory history may hold whatever the line count, past it deflated blocks spill to disk
+#define SCROLLBACK_MAX_BYTES (64 * 1024 * 1024)
+// newest rows left uncompressed so scrolling back a little never inflates
+#define SCROLLBACK_HOT_BYTES (1024 * 1024)
+
+// mark the cell under the cursor after a blink or visibility change
+static void terminal_damage_cursor(TerminalState *term) {
+    Screen *screen = &term->screen;
+    screen_damage_mark(&screen->damage, screen->cursor_row, screen->cursor_col, screen->cursor_col + 1);
+}
+
+int terminal_init(TerminalState *term, float initial_scale) {
+    if (!term)
+        return -1;
+
+    // reset terminal fields to defaults
+    term->text_scale = initial_scale;
+    term->cursor_visible = true;
+    term->last_toggle = 0.0;
+    term->last_input_time = 0.0;
+    esc_parser_init(&term->parser);
+
+    // configure base metrics before allocating grid
+    text_set_base_scale(term->text_scale);
+    text_set_spacing(term->text_scale);
+    text_setup_grid();
+
+    // allocate backing rows filled with spaces
+    if (screen_init(&term->screen, grid_x_size, grid_y_size) != 0)
+        return -1;
+
+    // rows scrolled off the top are kept in pages of history
+    const char *lines = getenv("TERMITE_SCROLLBACK");
+    size_t max_lines = lines ? (size_t)strtoul(lines, NULL, 10) : SCROLLBACK_DEFAULT_LINES;
+    if (scrollback_init(&term->history, &term->screen.styles, max_lines, SCROLLBACK_MAX_BYTES) != 0)
+        return -1;
+    if (max_lines > 0) {
+        term->screen.history = &term->history;
+        // TERMITE_SCROLLBACK_SPILL=0 keeps deflated blocks in memory and drops them at the cap
+        const char *spill = getenv("TERMITE_SCROLLBACK_SPILL");
+        if (scrollback_start_cold(&term->history, SCROLLBACK_HOT_BYTES, !spill || strcmp(spill, "0") != 0) != 0)
+            fprintf(stderr, "Failed to start the compressed scrollback, keeping history in memory\n");
+    }
+
+    // optionally record the parsed operation stream for debugging
+    const char *trace_path = getenv("TERMITE_OP_TRACE");
+    if (trace_path && *trace_path)
+        term->screen.trace = fopen(trace_path, "w");
+    return 0;
+}
+
+void terminal_free(TerminalState *term) {
+    if (!term)
+        return;
+    // release history before the style table its rows reference
+    scrollback_free(&term->history);
+    // release row storage and operation queue
+    screen_free(&term->screen);
+    if (term->screen.trace) {
+        fclose(term->screen.trace);
+        term->screen.trace = NULL;
+    }
+}
+
+bool terminal_resize(TerminalState *term, int width, int height) {
+    if (!term || !term->screen.cells)
+        return false;
+
+    // rescale metrics then rebuild rows to match new resolution
+    if (!text_resize_grid(width, height, &term->text_scale))
+        return false;
+    return screen_resize(&term->screen, grid_x_size, grid_y_size) == 0;
+}
+
+void terminal_process_data(TerminalState *term, const uint8_t *data, size_t len) {
+    if (!term || !term->screen.cells || !data)
+        return;
+
+    // parse escape sequences and printable bytes as one block
+    esc_parser_feed(&term->parser, data, len, &term->screen);
+}
+
+void terminal_on_input_activity(TerminalState *term, double now) {
+    if (!term)
+        return;
+    // keep cursor visible while receiving data
+    if (!term->cursor_visible)
+        terminal_damage_cursor(term);
+    term->cursor_visible = true;
+    term->last_toggle = now;
+    term->last_input_time = now;
+}
+
+bool terminal_update_cursor(TerminalState *term, double now) {
+    if (!term)
+        return false;
+
+    bool was_visible = term->cursor_visible;
+
+    // toggle cursor when idle 
+    if (now - term->last_input_time < CURSOR_INPUT_PAUSE) {
+        term->cursor_visible = true;
+        term->last_toggle = now;
+    } else if (now - term->last_toggle >= CURSOR_BLINK_INTERVAL) {
+        term->cursor_visible = !term->cursor_visible;
+        term->last_toggle = now;
+    }
+
+    if (term->cursor_visible == was_visible)
+        return false;
+    terminal_damage_cursor(term);
+    return true;
+}
+
+double terminal_next_cursor_deadline(const TerminalState *term, double now) {
+    if (!term)
+        return now;
+
+    // blinking resumes once recent input activity has settled
+    if (now - term->last_input_time < CURSOR_INPUT_PAUSE)
+        return term->last_input_time + CURSOR_INPUT_PAUSE;
+    return term->last_toggle + CURSOR_BLINK_INTERVAL;
+}
+
+const ScreenDamage *terminal_damage(const TerminalState *term) {
+    if (!term || !term->screen.cells)
+        return NULL;
+    return &term->screen.damage;
+}
+
+void terminal_clear_damage(TerminalState *term) {
+    if (!term || !term->screen.cells)
+        return;
+    screen_damage_clear(&term->screen.damage);
+}
+
+void terminal_render(const TerminalState *term, Renderer *renderer, const vec3 fg_color, const vec3 bg_color) {
+    if (!term || !term->screen.cells)
+        return;
+
+    // redraw damaged rows and the cursor cells into the retained frame
+    renderer_draw_grid(renderer, &term->screen, term->cursor_visible, term->text_scale, fg_color, bg_color);
+}
@@ -1,309 +1,217 @@
-#include <glad/glad.h>
-#include <cglm/cglm.h>
-#include <ft2build.h>
-#include FT_FREETYPE_H
-#include <shader.h>
-#include <stdlib.h>
-#include <string.h>
-
-struct Character {
-	unsigned int TextureID;  // glyph texture id
-	ivec2 Size;       // glyph size in pixels
-	ivec2 Bearing;    // offset from baseline to top left
-	unsigned int Advance;    // advance to next glyph
-};
-
-struct Character Characters[128];
-
-unsigned int VBO;
-unsigned int VAO;
-
-int glyph_width;
-int glyph_height;
-
-int ascent;
-
-int x_resolution = 1280;
-int y_resolution = 720;
-
-float x_spacing;
-float y_spacing;
-float margin_x = 10.0f;
-float margin_y = 10.0f;
-
-int grid_x_size;
-int grid_y_size;
-
-static const int base_x_resolution = 1280;
-static const int base_y_resolution = 720;
-static const float base_margin_x = 10.0f;
-static const float base_margin_y = 10.0f;
-static float base_text_scale = 0.35f;
-
-void text_set_base_scale(float scale) {
-	base_text_scale = scale;
-}
-
-int *text_setup_grid(void) {
-	// allocate 2d grid mapping positions to glyph values
-	// grid needs to be freed by caller
-	// layout uses grid[row * cols + col]
-
-	grid_x_size = (int)((x_resolution - 2.0f * margin_x) / x_spacing);
-	if (grid_x_size < 1)
-		grid_x_size = 1;
-	grid_y_size = (int)((y_resolution - margin_y) / y_spacing);
-	if (grid_y_size < 1)
-		grid_y_size = 1;
-
-	int *grid = malloc((size_t)grid_x_size * (size_t)grid_y_size * sizeof(int));
-	if (!grid)
-		return NULL;
-
-	// fill grid with spaces
-	for (int y = 0; y < grid_y_size; y++) {
-		for (int x = 0; x < grid_x_size; x++) {
-			grid[y * grid_x_size + x] = ' ';
-		}
-	}
-
-	return grid;
-}
-
-
-int text_setup_characters(void) {
-  
-	// prepare quad buffers before uploading glyphs
-	initialize_VBO_VAO(&VBO, &VAO);
-	
-	FT_Library ft;
-	if (FT_Init_FreeType(&ft))
-	{
-		printf("ERROR::FREETYPE: Could not init FreeType Library\n");
-		return -1;
-	}
-
-	FT_Face face;
-	if (FT_New_Face(ft, "../fonts/JetBrainsMono-Bold.ttf", 0, &face))
-	{
-		printf("ERROR::FREETYPE: Failed to load font\n"); 
-		return -1;
-	}
-
-	FT_Set_Pixel_Sizes(face, 0, 48);
-	if (FT_Load_Char(face, 'X', FT_LOAD_RENDER))
-	{
-		printf("ERROR::FREETYTPE: Failed to load Glyph");
-		return -1;
-	}
-
-
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte alignment restriction
-  
-	for (unsigned char c = 0; c < 128; c++)
-	{
-		// load character glyph 
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-		{
-			printf("ERROR::FREETYTPE: Failed to load Glyph\n");
-			continue;
-		}
-
-		// generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-		glTexImage2D(
-			GL_TEXTURE_2D,
-			0,
-			GL_RED,
-			face->glyph->bitmap.width,
-			face->glyph->bitmap.rows,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			face->glyph->bitmap.buffer
-		);
-
-		glyph_width  = face->glyph->advance.x >> 6; // divide advance by 64
-		glyph_height = face->size->metrics.height >> 6; // compute ascent plus descent
-		ascent = face->size->metrics.ascender >> 6;
-
-
-		// set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// now store character for later use
-		struct Character character = {
-			texture,
-			{ face->glyph->bitmap.width, face->glyph->bitmap.rows },   // size
-			{ face->glyph->bitmap_left, face->glyph->bitmap_top },     // bearing
-			(unsigned int)(face->glyph->advance.x)                // advance 
-		};
-
-		Characters[(unsigned char)c] = character;
-	}
-
-	// free resources once glyph processing is done
-	FT_Done_Face(face);
-	FT_Done_FreeType(ft);
-	
-	return 0;
-}
-
-void text_render_char(GLuint shaderProgram, char character, float x, float y, float scale, vec3 color)
-{
-  // activate render state for character
-	glUseProgram(shaderProgram);
-	glUniform3f(glGetUniformLocation(shaderProgram, "textColor"), color[0], color[1], color[2]);
-	glUniform1i(glGetUniformLocation(shaderProgram, "solid"), 0); 
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(VAO);
-
-	struct Character ch = Characters[(unsigned char)character];
-
-	float xpos = x + ch.Bearing[0] * scale;
-	float ypos = y - (ch.Size[1] - ch.Bearing[1]) * scale;
-
-	float w = ch.Size[0] * scale;
-	float h = ch.Size[1] * scale;
-	// update vbo for each character
-	float vertices[6][4] = {
-		{ xpos,     ypos + h,   0.0f, 0.0f },            
-		{ xpos,     ypos,       0.0f, 1.0f },
-		{ xpos + w, ypos,       1.0f, 1.0f },
-
-		{ xpos,     ypos + h,   0.0f, 0.0f },
-		{ xpos + w, ypos,       1.0f, 1.0f },
-		{ xpos + w, ypos + h,   1.0f, 0.0f }           
-	};
-	// render glyph texture over quad
-	glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-	// update content of vbo memory
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	// render quad
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	// now advance cursor for next glyph
-	x += (ch.Advance >> 6) * scale; // convert from 1/64th pixels to pixels
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
-}
-
-
-void text_render_cursor(GLuint shaderProgram, float text_scale,  int row, int col, vec3 fg, vec3 bg, char c) {
-    float x = margin_x + col * x_spacing;
-    float baseline = margin_y * 1.25f + row * y_spacing;
-
-    struct Character reference = Characters[(unsigned char)'X'];
-    float extra = (y_spacing - reference.Size[1] * text_scale) * 0.5f;
-    float y_bottom = baseline - (reference.Size[1] - reference.Bearing[1]) * text_scale - extra;
-    float y_top = y_bottom + y_spacing;
-    float w = x_spacing;
-
-    vec3 cursor_fg = { bg[0], bg[1], bg[2] };
-    vec3 cursor_bg = { fg[0], fg[1], fg[2] };
-
-    glUseProgram(shaderProgram);
-    glUniform3f(glGetUniformLocation(shaderProgram, "textColor"), cursor_bg[0], cursor_bg[1], cursor_bg[2]);
-    glUniform1i(glGetUniformLocation(shaderProgram, "solid"), 1);
-
-    float vertices[6][4] = {
-        { x,     y_bottom,   0.0f, 0.0f },
-        { x,     y_top,      0.0f, 1.0f },
-        { x+w,   y_top,      1.0f, 1.0f },
-
-        { x,     y_bottom,   0.0f, 0.0f },
-        { x+w,   y_top,      1.0f, 1.0f },
-        { x+w,   y_bottom,   1.0f, 0.0f }
-    };
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glUniform1i(glGetUniformLocation(shaderProgram, "solid"), 0);
-    text_render_char(shaderProgram, c, x, baseline, text_scale, cursor_fg);
-}
-
-int *text_resize_grid(int *grid, int new_width, int new_height, float *text_scale, int *cursor_row, int *cursor_col, int *scroll_top, int *scroll_bottom) {
-    if (new_width <= 0 || new_height <= 0 || glyph_width == 0 || glyph_height == 0)
-        return grid;
-
-    float width_ratio = (float)new_width / (float)base_x_resolution;
-    float height_ratio = (float)new_height / (float)base_y_resolution;
-
-    float new_scale = base_text_scale * height_ratio;
-    if (new_scale < 0.01f)
-        new_scale = 0.01f;
-
-    x_resolution = new_width;
-    y_resolution = new_height;
-
-    margin_x = base_margin_x * width_ratio;
-    margin_y = base_margin_y * height_ratio;
-
-    x_spacing = glyph_width * new_scale;
-    y_spacing = glyph_height * new_scale;
-
-    if (x_spacing < 1.0f)
-        x_spacing = 1.0f;
-    if (y_spacing < 1.0f)
-        y_spacing = 1.0f;
-
-    int old_cols = grid_x_size;
-    int old_rows = grid_y_size;
-
-    grid_x_size = (int)((x_resolution - 2.0f * margin_x) / x_spacing);
-    if (grid_x_size < 1)
-        grid_x_size = 1;
-    grid_y_size = (int)((y_resolution - margin_y) / y_spacing);
-    if (grid_y_size < 1)
-        grid_y_size = 1;
-
-    size_t total_cells = (size_t)grid_x_size * (size_t)grid_y_size;
-    int *new_grid = malloc(total_cells * sizeof(int));
-    if (!new_grid)
-        return grid;
-
-    for (size_t idx = 0; idx < total_cells; idx++)
-        new_grid[idx] = ' ';
-
-    int copy_rows = old_rows < grid_y_size ? old_rows : grid_y_size;
-    int copy_cols = old_cols < grid_x_size ? old_cols : grid_x_size;
-
-    for (int y = 0; y < copy_rows; y++) {
-        memcpy(new_grid + y * grid_x_size,
-               grid + y * old_cols,
-               (size_t)copy_cols * sizeof(int));
-    }
-
-    free(grid);
-
-    if (*cursor_row >= grid_y_size)
-        *cursor_row = grid_y_size - 1;
-    if (*cursor_row < 0)
-        *cursor_row = 0;
-    if (*cursor_col >= grid_x_size)
-        *cursor_col = grid_x_size - 1;
-    if (*cursor_col < 0)
-        *cursor_col = 0;
-
-    if (*scroll_top < 0)
-        *scroll_top = 0;
-    if (*scroll_top >= grid_y_size)
-        *scroll_top = grid_y_size - 1;
-    if (*scroll_bottom < *scroll_top)
-        *scroll_bottom = *scroll_top;
-    if (*scroll_bottom >= grid_y_size)
-        *scroll_bottom = grid_y_size - 1;
-
-    *text_scale = new_scale;
-    return new_grid;
-}
-
+#include <glad/glad.h>
+#include <cglm/cglm.h>
+#include <shader.h>
+#include <text.h>
+#include <cell_glyph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+GlyphCache glyph_cache;
+uint32_t glyph_pixel_size = 48;
+
+// face every glyph is rasterized from
+static int text_face = -1;
+// size the next glyph bucket is rasterized for
+static uint32_t target_pixel_size = 48;
+// on screen size cell glyphs are drawn for in every glyph mode
+static uint32_t cell_pixel_size = 48;
+
+int glyph_width;
+int glyph_height;
+
+int ascent;
+
+int x_resolution = 1280;
+int y_resolution = 720;
+
+float x_spacing;
+float y_spacing;
+float margin_x = 10.0f;
+float margin_y = 10.0f;
+
+int grid_x_size;
+int grid_y_size;
+
+static const int base_x_resolution = 1280;
+static const int base_y_resolution = 720;
+static const float base_margin_x = 10.0f;
+static const float base_margin_y = 10.0f;
+static float base_text_scale = 0.35f;
+// size cell metrics are measured at before scaling
+static const uint32_t base_pixel_size = 48;
+
+// font size in pixels a text scale covers on screen
+static uint32_t text_screen_pixel_size(float scale) {
+	long size = lroundf((float)base_pixel_size * scale);
+	return size < 4 ? 4 : (uint32_t)size;
+}
+
+// glyphs are rasterized at the size they cover on screen
+// distance fields are rasterized once at the base size and scaled
+static uint32_t text_pixel_size(float scale) {
+	if (glyph_cache.mode == GLYPH_MODE_SDF)
+		return base_pixel_size;
+	return text_screen_pixel_size(scale);
+}
+
+void text_set_base_scale(float scale) {
+	base_text_scale = scale;
+	glyph_pixel_size = text_pixel_size(scale);
+	target_pixel_size = glyph_pixel_size;
+	cell_pixel_size = text_screen_pixel_size(scale);
+}
+
+float text_glyph_scale(float text_scale) {
+	return text_scale * (float)base_pixel_size / (float)glyph_pixel_size;
+}
+
+void text_set_spacing(float scale) {
+	// whole pixel cells keep rows aligned when the frame is shifted by whole rows
+	x_spacing = fmaxf(roundf(glyph_width * scale), 1.0f);
+	y_spacing = fmaxf(roundf(glyph_height * scale), 1.0f);
+}
+
+void text_setup_grid(void) {
+	// derive grid dimensions from current spacing and margins
+	grid_x_size = (int)((x_resolution - 2.0f * margin_x) / x_spacing);
+	if (grid_x_size < 1)
+		grid_x_size = 1;
+	grid_y_size = (int)((y_resolution - margin_y) / y_spacing);
+	if (grid_y_size < 1)
+		grid_y_size = 1;
+}
+
+
+int text_setup_characters(void (*wake)(void)) {
+	if (glyph_cache_init(&glyph_cache, GLYPH_CACHE_DEFAULT_BUDGET, wake) != 0)
+		return -1;
+
+	// TERMITE_GLYPHS=sdf selects distance field glyphs
+	const char *glyph_mode = getenv("TERMITE_GLYPHS");
+	if (glyph_mode && strcmp(glyph_mode, "sdf") == 0)
+		glyph_cache.mode = GLYPH_MODE_SDF;
+
+	text_face = glyph_cache_add_face(&glyph_cache, "../fonts/JetBrainsMono-Bold.ttf");
+	if (text_face < 0) {
+		glyph_cache_free(&glyph_cache);
+		return -1;
+	}
+
+	// cell size comes from the face metrics and the advance of a reference glyph
+	GlyphKey reference_key = { 'X', (uint16_t)text_face, 0, base_pixel_size };
+	const Glyph *reference = glyph_cache_lookup(&glyph_cache, reference_key);
+	const FT_Size_Metrics *metrics = glyph_cache_metrics(&glyph_cache, (uint16_t)text_face, base_pixel_size);
+	if (!metrics || !reference)
+	{
+		printf("ERROR::FREETYTPE: Failed to load Glyph\n");
+		text_free_characters();
+		return -1;
+	}
+
+	glyph_width  = reference->advance >> 6; // divide advance by 64
+	glyph_height = metrics->height >> 6; // compute ascent plus descent
+	ascent = metrics->ascender >> 6;
+	return 0;
+}
+
+void text_free_characters(void) {
+	glyph_cache_free(&glyph_cache);
+	text_face = -1;
+}
+
+// rasterize a new size in the background while the current one stays in use
+static void text_request_pixel_size(uint32_t pixel_size) {
+	if (pixel_size == target_pixel_size)
+		return;
+	target_pixel_size = pixel_size;
+	if (text_face >= 0)
+		glyph_cache_prepare_size(&glyph_cache, glyph_pixel_size, pixel_size);
+}
+
+bool text_poll_glyphs(void) {
+	if (text_face < 0)
+		return false;
+
+	// switch buckets only once every glyph on screen exists at the new size
+	bool changed = glyph_cache_poll(&glyph_cache);
+	if (target_pixel_size != glyph_pixel_size && glyph_cache_size_ready(&glyph_cache, target_pixel_size)) {
+		uint32_t previous = glyph_pixel_size;
+		glyph_pixel_size = target_pixel_size;
+		glyph_cache_release_size(&glyph_cache, previous);
+		changed = true;
+	}
+	return changed;
+}
+
+const Glyph *text_lookup_glyph(uint32_t codepoint, uint32_t style) {
+	// the single face has no separate bold or italic variants yet
+	(void)style;
+	GlyphKey key = { codepoint, (uint16_t)text_face, 0, glyph_pixel_size };
+	return glyph_cache_lookup(&glyph_cache, key);
+}
+
+uint32_t text_find_glyph(uint32_t codepoint, uint32_t style, bool *cell) {
+	// keys match the lookups above so a hit is the glyph they would return
+	*cell = cell_glyph_covers(codepoint) && text_face >= 0;
+	if (*cell) {
+		GlyphKey key = { codepoint, GLYPH_FACE_CUSTOM, 0, cell_pixel_size };
+		return glyph_cache_find(&glyph_cache, &key);
+	}
+	(void)style;
+	GlyphKey key = { codepoint, (uint16_t)text_face, 0, glyph_pixel_size };
+	return glyph_cache_find(&glyph_cache, &key);
+}
+
+const Glyph *text_lookup_cell_glyph(uint32_t codepoint) {
+	if (!cell_glyph_covers(codepoint) || text_face < 0)
+		return NULL;
+
+	GlyphKey key = { codepoint, GLYPH_FACE_CUSTOM, 0, cell_pixel_size };
+	const Glyph *glyph = glyph_cache_peek(&glyph_cache, key);
+	if (glyph)
+		return glyph;
+
+	// drawn at the cell size in pixels and stretched over the exact cell
+	int width = (int)lroundf((float)glyph_width * (float)cell_pixel_size / (float)base_pixel_size);
+	int height = (int)lroundf((float)glyph_height * (float)cell_pixel_size / (float)base_pixel_size);
+	if (width < 1 || height < 1)
+		return NULL;
+	uint8_t *pixels = malloc((size_t)width * height);
+	if (!pixels)
+		return NULL;
+	cell_glyph_render(codepoint, width, height, pixels);
+
+	Glyph cell = { .width = (uint16_t)width, .height = (uint16_t)height, .advance = (int32_t)width << 6 };
+	glyph = glyph_cache_put(&glyph_cache, key, cell, pixels);
+	free(pixels);
+	return glyph;
+}
+
+bool text_resize_grid(int new_width, int new_height, float *text_scale) {
+    if (new_width <= 0 || new_height <= 0 || glyph_width == 0 || glyph_height == 0)
+        return false;
+
+    float width_ratio = (float)new_width / (float)base_x_resolution;
+    float height_ratio = (float)new_height / (float)base_y_resolution;
+
+    float new_scale = base_text_scale * height_ratio;
+    if (new_scale < 0.01f)
+        new_scale = 0.01f;
+
+    x_resolution = new_width;
+    y_resolution = new_height;
+
+    margin_x = base_margin_x * width_ratio;
+    margin_y = base_margin_y * height_ratio;
+
+    text_set_spacing(new_scale);
+    text_request_pixel_size(text_pixel_size(new_scale));
+    cell_pixel_size = text_screen_pixel_size(new_scale);
+
+    text_setup_grid();
+
+    *text_scale = new_scale;
+    return true;
+}
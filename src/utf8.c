@@ -0,0 +1,145 @@
+#include <utf8.h>
+
+#include <cell_kernel.h>
+
+void utf8_decoder_init(Utf8Decoder *decoder) {
+    decoder->codepoint = 0;
+    decoder->min = 0;
+    decoder->needed = 0;
+}
+
+// return true when every sequence in the block is complete and needs no range checks
+static bool utf8_block_simple(const Utf8Masks *masks) {
+    if (masks->control | masks->special)
+        return false;
+
+    // each lead predicts the continuation bytes that must follow it
+    uint64_t lead = masks->high & ~masks->cont;
+    uint64_t expected = (lead << 1) | (masks->lead3 << 2) | (masks->lead4 << 3);
+    return expected == masks->cont;
+}
+
+// store a finished codepoint replacing overlong surrogate and out of range values
+static size_t utf8_emit(uint32_t codepoint, uint32_t min, uint32_t *out) {
+    if (codepoint < min || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF)
+        codepoint = UTF8_REPLACEMENT;
+    // encoded c1 controls are not printable
+    if (codepoint >= 0x80 && codepoint < 0xA0)
+        return 0;
+    *out = codepoint;
+    return 1;
+}
+
+size_t utf8_decode_text(Utf8Decoder *decoder, const uint8_t *data, size_t len, uint32_t *out, size_t out_cap,
+                        size_t *out_len) {
+    size_t i = 0;
+    size_t n = 0;
+    size_t scalar_until = 0;
+
+    while (i < len && n < out_cap) {
+        // validate whole blocks at once when no sequence is open
+        if (decoder->needed == 0 && i >= scalar_until && len - i >= UTF8_BLOCK) {
+            Utf8Masks masks;
+            cell_classify_utf8(data + i, &masks);
+
+            // plain ascii goes back to the zero copy path
+            if (masks.high == 0 && masks.control == 0)
+                break;
+
+            if (out_cap - n >= UTF8_BLOCK && utf8_block_simple(&masks)) {
+                const uint8_t *p = data + i;
+                const uint8_t *end = p + UTF8_BLOCK;
+                while (p < end) {
+                    uint8_t b = *p;
+                    if (b < 0x80) {
+                        out[n++] = b;
+                        p += 1;
+                    } else if (b < 0xE0) {
+                        out[n++] = ((uint32_t)(b & 0x1F) << 6) | (p[1] & 0x3F);
+                        p += 2;
+                    } else if (b < 0xF0) {
+                        out[n++] = ((uint32_t)(b & 0x0F) << 12) | ((uint32_t)(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+                        p += 3;
+                    } else {
+                        out[n++] = ((uint32_t)(b & 0x07) << 18) | ((uint32_t)(p[1] & 0x3F) << 12) |
+                                   ((uint32_t)(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+                        p += 4;
+                    }
+                }
+                i += UTF8_BLOCK;
+                continue;
+            }
+
+            // decode this block byte by byte before trying the fast path again
+            scalar_until = i + UTF8_BLOCK;
+        }
+
+        uint8_t b = data[i];
+        if (decoder->needed > 0) {
+            if ((b & 0xC0) == 0x80) {
+                decoder->codepoint = (decoder->codepoint << 6) | (b & 0x3F);
+                i++;
+                if (--decoder->needed == 0)
+                    n += utf8_emit(decoder->codepoint, decoder->min, out + n);
+                continue;
+            }
+            // interrupted sequence is replaced and the byte is examined again
+            decoder->needed = 0;
+            out[n++] = UTF8_REPLACEMENT;
+            continue;
+        }
+
+        if (b < 0x80) {
+            if (b < 0x20 || b == 0x7F)
+                break;
+            out[n++] = b;
+        } else if (b >= 0xC2 && b <= 0xDF) {
+            decoder->codepoint = b & 0x1F;
+            decoder->min = 0x80;
+            decoder->needed = 1;
+        } else if (b >= 0xE0 && b <= 0xEF) {
+            decoder->codepoint = b & 0x0F;
+            decoder->min = 0x800;
+            decoder->needed = 2;
+        } else if (b >= 0xF0 && b <= 0xF4) {
+            decoder->codepoint = b & 0x07;
+            decoder->min = 0x10000;
+            decoder->needed = 3;
+        } else {
+            // stray continuation or a byte that never starts a sequence
+            out[n++] = UTF8_REPLACEMENT;
+        }
+        i++;
+    }
+
+    *out_len = n;
+    return i;
+}
+
+size_t utf8_encode(uint32_t codepoint, char out[4]) {
+    if (codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+            return utf8_encode(UTF8_REPLACEMENT, out);
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    if (codepoint <= 0x10FFFF) {
+        out[0] = (char)(0xF0 | (codepoint >> 18));
+        out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+        out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[3] = (char)(0x80 | (codepoint & 0x3F));
+        return 4;
+    }
+    return utf8_encode(UTF8_REPLACEMENT, out);
+}
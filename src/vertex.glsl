@@ -1,11 +1,68 @@
-#version 330 core
-layout (location = 0) in vec4 vertex; // <vec2 pos, vec2 tex>
-out vec2 TexCoords;
-
-uniform mat4 projection;
-
-void main()
-{
-    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
-    TexCoords = vertex.zw;
-}  
+#version 330 core
+layout (location = 0) in uvec2 cell;       // column and row
+layout (location = 1) in uvec4 atlasRect;  // x y w h in atlas texels
+layout (location = 2) in ivec2 bearing;    // offset from baseline to top left
+layout (location = 3) in vec4 cellColor;
+layout (location = 4) in uint cellFlags;
+
+out vec2 TexCoords;
+flat out vec3 textColor;
+flat out uint flags;
+flat out float page;
+
+uniform mat4 projection;
+uniform sampler2DArray text;
+uniform vec2 origin;      // baseline of bottom left cell
+uniform vec2 cell_size;
+uniform float scale;
+uniform int grid_rows;
+uniform vec2 solid_span;  // bottom offset and height of solid blocks
+uniform vec2 underline;   // bottom offset and height of underline bars
+uniform vec2 strike;      // bottom offset and height of strikethrough bars
+
+void main()
+{
+    // expand triangle strip corners from vertex id
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pen = origin + vec2(cell.x, grid_rows - 1 - int(cell.y)) * cell_size;
+    vec2 pos;
+
+    if ((cellFlags & 1u) != 0u) {
+        // solid blocks span atlasRect.z cells, decorations keep only their band
+        vec2 span = solid_span;
+        if ((cellFlags & 4u) != 0u)
+            span = underline;
+        else if ((cellFlags & 8u) != 0u)
+            span = vec2(underline.x - 2.0 * underline.y, 3.0 * underline.y);
+        else if ((cellFlags & 16u) != 0u)
+            span = vec2(underline.x - 2.5 * underline.y, 4.0 * underline.y);
+        else if ((cellFlags & 32u) != 0u)
+            span = strike;
+        float width = cell_size.x * float(max(atlasRect.z, 1u));
+        pos = pen + vec2(0.0, span.x) + corner * vec2(width, span.y);
+        // decorations are shaped from pixel offsets inside the band
+        TexCoords = corner * vec2(width, span.y);
+    } else if ((cellFlags & 64u) != 0u) {
+        // cell glyphs cover the cell exactly and shared edges round the same way
+        vec2 edge = vec2(cell.x, grid_rows - 1 - int(cell.y)) + corner;
+        pos = floor(origin + vec2(0.0, solid_span.x) + edge * cell_size + 0.5);
+        // sample texel centers so edges never blend with the atlas padding
+        vec2 size = vec2(atlasRect.zw);
+        TexCoords = (vec2(atlasRect.xy) + 0.5 + vec2(corner.x, 1.0 - corner.y) * (size - 1.0)) / vec2(textureSize(text, 0).xy);
+    } else {
+        vec2 size = vec2(atlasRect.zw);
+        // whole pixel origins keep glyphs rasterized at cell size sharp
+        vec2 base = floor(pen + vec2(bearing.x, bearing.y - size.y) * scale + 0.5);
+        pos = base + corner * size * scale;
+        // italic slants the quad around the baseline
+        if ((cellFlags & 2u) != 0u)
+            pos.x += (pos.y - pen.y) * 0.2;
+        // glyph rows are stored top down inside the atlas
+        TexCoords = (vec2(atlasRect.xy) + vec2(corner.x, 1.0 - corner.y) * size) / vec2(textureSize(text, 0).xy);
+    }
+
+    gl_Position = projection * vec4(pos, 0.0, 1.0);
+    textColor = cellColor.rgb;
+    flags = cellFlags & 0xFFFFu;
+    page = float(cellFlags >> 16);
+}
@@ -0,0 +1,123 @@
+#include <work_pool.h>
+
+#include <string.h>
+#include <unistd.h>
+
+// take items of the current batch until none are left
+static void work_pool_drain(WorkPool *pool) {
+    size_t index;
+    while ((index = atomic_fetch_add_explicit(&pool->next, 1, memory_order_relaxed)) < pool->count)
+        pool->fn(pool->ctx, index);
+}
+
+static void *work_pool_main(void *arg) {
+    WorkPool *pool = arg;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->stop)
+            break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work_pool_drain(pool);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int work_pool_start(WorkPool *pool, size_t threads) {
+    if (!pool)
+        return -1;
+
+    memset(pool, 0, sizeof(*pool));
+    if (threads > WORK_POOL_MAX_THREADS)
+        threads = WORK_POOL_MAX_THREADS;
+    if (threads == 0)
+        return 0;
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0)
+        return -1;
+    if (pthread_cond_init(&pool->work, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    if (pthread_cond_init(&pool->done, NULL) != 0) {
+        pthread_cond_destroy(&pool->work);
+        pthread_mutex_destroy(&pool->lock);
+        return -1;
+    }
+    pool->running = true;
+
+    // keep whatever threads did start
+    for (size_t i = 0; i < threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, work_pool_main, pool) != 0)
+            break;
+        pool->thread_count++;
+    }
+    return 0;
+}
+
+void work_pool_run(WorkPool *pool, size_t count, work_pool_fn fn, void *ctx) {
+    if (count == 0)
+        return;
+
+    // a single item or no workers is not worth a wake up
+    if (!pool || !pool->running || pool->thread_count == 0 || count == 1) {
+        for (size_t i = 0; i < count; i++)
+            fn(ctx, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->count = count;
+    atomic_store_explicit(&pool->next, 0, memory_order_relaxed);
+    pool->busy = pool->thread_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    work_pool_drain(pool);
+
+    // the lock hands every write of the workers over to the caller
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void work_pool_stop(WorkPool *pool) {
+    if (!pool || !pool->running)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->thread_count; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    memset(pool, 0, sizeof(*pool));
+}
+
+size_t work_pool_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 1)
+        return 0;
+    // past a handful of threads memory bandwidth rather than cores limits the work
+    if (cpus > 8)
+        cpus = 8;
+    return (size_t)cpus - 1;
+}